@@ -0,0 +1,67 @@
+/* bigint library - bigdec.h
+   Decimal big integers: function declarations / public interface.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGDEC_H_
+#define _BIGDEC_H_
+
+#include "bigint.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* A bigdec stores its magnitude in base 10^9 digits, in little-endian order,
+   and the sign separately. Reading and writing decimal strings is linear
+   time, so this is the type to use when a calculation is mostly I/O. */
+struct _bigdec {
+    uint32_t digits;
+    int32_t sign;
+    uint32_t num[];
+};
+typedef struct _bigdec * bigdec_tp;
+
+inline bigdec_tp bigdec_dup(bigdec_tp n);
+inline void bigdec_free(bigdec_tp n);
+
+inline bigdec_tp bigdec_from_int(int64_t i);
+inline char *bigdec_to_string(bigdec_tp n);
+inline bigdec_tp bigdec_from_string(const char *c);
+inline bigdec_tp bigdec_from_bigint(bigint_tp n);
+inline bigint_tp bigdec_to_bigint(bigdec_tp n);
+
+inline int bigdec_sgn(bigdec_tp n);
+inline int bigdec_cmp(bigdec_tp n, bigdec_tp m);
+
+inline bigdec_tp bigdec_flipsign(bigdec_tp n);
+
+inline bigdec_tp bigdec_add(bigdec_tp n, bigdec_tp m);
+inline bigdec_tp bigdec_add_inplace(bigdec_tp n, bigdec_tp m);
+inline bigdec_tp bigdec_sub(bigdec_tp n, bigdec_tp m);
+inline bigdec_tp bigdec_sub_inplace(bigdec_tp n, bigdec_tp m);
+
+inline bigdec_tp bigdec_mul(bigdec_tp n, bigdec_tp m);
+inline bigdec_tp bigdec_mul32(bigdec_tp n, int32_t m);
+inline bigdec_tp bigdec_mul32_inplace(bigdec_tp n, int32_t m);
+
+inline bigdec_tp _bigdec_new(uint32_t digits);
+inline bigdec_tp _bigdec_realloc(bigdec_tp n, uint32_t digits);
+inline void _bigdec_crop(bigdec_tp n);
+inline int _bigdec_cmp_mag(const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn);
+inline bigdec_tp _bigdec_add_signed_inplace(bigdec_tp n, const uint32_t *m, uint32_t m_digits, int m_sign);
+inline uint32_t _bigdec_limbs_add_to(uint32_t *r, uint32_t rn, const uint32_t *a, uint32_t an);
+inline uint32_t _bigdec_limbs_sub_from(uint32_t *r, uint32_t rn, const uint32_t *a, uint32_t an);
+inline uint32_t _bigdec_limbs_addmul1(uint32_t *r, const uint32_t *a, uint32_t n, uint32_t m);
+inline void _bigdec_mul_basecase(uint32_t *r, const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn);
+inline void _bigdec_mul_mag(uint32_t *r, const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn);
+inline bigint_tp _bigdec_to_bigint_mag(const uint32_t *num, uint32_t digits, bigint_tp *powers);
+inline bigdec_tp _bigdec_from_bigint_mag(const uint32_t *num, uint32_t digits, bigdec_tp *powers);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#include "bigdec_impl.h"
+
+#endif /* _BIGDEC_H_ */
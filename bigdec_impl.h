@@ -0,0 +1,472 @@
+/* bigint library - bigdec_impl.h
+   Decimal big integers: function definitions (all inline).
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGDEC_IMPL_H_
+#define _BIGDEC_IMPL_H_
+
+#include "bigdec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BIGDEC_BASE 1000000000
+#define BIGDEC_BASE_DIGITS 9
+
+#define BIGDEC_MUL_KARATSUBA_THRESHOLD_DEFAULT 32
+#ifndef BIGDEC_MUL_KARATSUBA_THRESHOLD
+# define BIGDEC_MUL_KARATSUBA_THRESHOLD BIGDEC_MUL_KARATSUBA_THRESHOLD_DEFAULT
+#endif
+/* below these sizes (in digits of the source number), radix conversion
+   is done digit by digit rather than by divide and conquer */
+#define BIGDEC_TO_BIGINT_THRESHOLD_DEFAULT 32
+#ifndef BIGDEC_TO_BIGINT_THRESHOLD
+# define BIGDEC_TO_BIGINT_THRESHOLD BIGDEC_TO_BIGINT_THRESHOLD_DEFAULT
+#endif
+#define BIGDEC_FROM_BIGINT_THRESHOLD_DEFAULT 32
+#ifndef BIGDEC_FROM_BIGINT_THRESHOLD
+# define BIGDEC_FROM_BIGINT_THRESHOLD BIGDEC_FROM_BIGINT_THRESHOLD_DEFAULT
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+_BIGINT_INLINE bigdec_tp _bigdec_new(uint32_t digits)
+{
+    bigdec_tp res = (bigdec_tp)malloc(sizeof(struct _bigdec) + digits * sizeof(uint32_t));
+    res->digits = digits;
+    res->sign = 1;
+    return res;
+}
+
+_BIGINT_INLINE bigdec_tp _bigdec_realloc(bigdec_tp n, uint32_t digits)
+{
+    n = (bigdec_tp)realloc(n, sizeof(struct _bigdec) + digits * sizeof(uint32_t));
+    n->digits = digits;
+    return n;
+}
+
+_BIGINT_INLINE void bigdec_free(bigdec_tp n)
+{
+    free(n);
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_dup(bigdec_tp n)
+{
+    bigdec_tp res = _bigdec_new(n->digits);
+    res->sign = n->sign;
+    memcpy(res->num, n->num, n->digits * sizeof(uint32_t));
+    return res;
+}
+
+_BIGINT_INLINE void _bigdec_crop(bigdec_tp n)
+{
+    // no leading zeros, and zero is positive
+    while (n->digits > 1 && n->num[n->digits-1] == 0)
+        n->digits--;
+    if (n->digits == 1 && n->num[0] == 0)
+        n->sign = 1;
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_from_int(int64_t i)
+{
+    bigdec_tp res = _bigdec_new(3);
+    uint64_t mag = i < 0 ? -(uint64_t)i : (uint64_t)i;
+    res->sign = i < 0 ? -1 : 1;
+    for (int k = 0; k < 3; ++k) {
+        res->num[k] = mag % BIGDEC_BASE;
+        mag /= BIGDEC_BASE;
+    }
+    _bigdec_crop(res);
+    return res;
+}
+
+_BIGINT_INLINE int bigdec_sgn(bigdec_tp n)
+{
+    return n->sign;
+}
+
+_BIGINT_INLINE int _bigdec_cmp_mag(const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn)
+{
+    while (an > 1 && a[an-1] == 0) an--;
+    while (bn > 1 && b[bn-1] == 0) bn--;
+    if (an != bn) return an > bn ? 1 : -1;
+    for (uint32_t i = an; i-- > 0; ) {
+        if (a[i] > b[i]) return 1;
+        else if (a[i] < b[i]) return -1;
+    }
+    return 0;
+}
+
+_BIGINT_INLINE int bigdec_cmp(bigdec_tp n, bigdec_tp m)
+{
+    if (n->sign != m->sign) return n->sign;
+    return n->sign * _bigdec_cmp_mag(n->num, n->digits, m->num, m->digits);
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_flipsign(bigdec_tp n)
+{
+    n->sign = -n->sign;
+    _bigdec_crop(n);
+    return n;
+}
+
+_BIGINT_INLINE uint32_t _bigdec_limbs_add_to(uint32_t *r, uint32_t rn, const uint32_t *a, uint32_t an)
+{
+    // r += a in base 10^9, where rn >= an. Returns the carry out of r.
+    uint32_t carry = 0;
+    uint32_t i;
+    for (i = 0; i < an; ++i) {
+        uint32_t sum = r[i] + a[i] + carry;
+        carry = sum >= BIGDEC_BASE;
+        r[i] = carry ? sum - BIGDEC_BASE : sum;
+    }
+    for (; carry != 0 && i < rn; ++i) {
+        uint32_t sum = r[i] + carry;
+        carry = sum >= BIGDEC_BASE;
+        r[i] = carry ? sum - BIGDEC_BASE : sum;
+    }
+    return carry;
+}
+
+_BIGINT_INLINE uint32_t _bigdec_limbs_sub_from(uint32_t *r, uint32_t rn, const uint32_t *a, uint32_t an)
+{
+    // r -= a in base 10^9, where rn >= an. Returns the borrow out of r.
+    uint32_t borrow = 0;
+    uint32_t i;
+    for (i = 0; i < an; ++i) {
+        uint32_t sub = a[i] + borrow;
+        borrow = r[i] < sub;
+        r[i] = borrow ? r[i] + BIGDEC_BASE - sub : r[i] - sub;
+    }
+    for (; borrow != 0 && i < rn; ++i) {
+        borrow = r[i] == 0;
+        r[i] = borrow ? BIGDEC_BASE - 1 : r[i] - 1;
+    }
+    return borrow;
+}
+
+_BIGINT_INLINE uint32_t _bigdec_limbs_addmul1(uint32_t *r, const uint32_t *a, uint32_t n, uint32_t m)
+{
+    // r[0..n) += a[0..n) * m in base 10^9, m < 10^9. Returns the high digit.
+    uint64_t carry = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint64_t val = (uint64_t)a[i] * m + r[i] + carry;
+        r[i] = val % BIGDEC_BASE;
+        carry = val / BIGDEC_BASE;
+    }
+    return carry;
+}
+
+_BIGINT_INLINE void _bigdec_mul_basecase(uint32_t *r, const uint32_t *a, uint32_t an,
+                                         const uint32_t *b, uint32_t bn)
+{
+    memset(r, 0, an * sizeof(uint32_t));
+    for (uint32_t j = 0; j < bn; ++j)
+        r[an+j] = _bigdec_limbs_addmul1(r + j, a, an, b[j]);
+}
+
+_BIGINT_INLINE void _bigdec_mul_mag(uint32_t *r, const uint32_t *a, uint32_t an,
+                                    const uint32_t *b, uint32_t bn)
+{
+    // r[0..an+bn) = a * b, an >= bn >= 1 - the same scheme as _bigint_mul_mag
+    if (bn < BIGDEC_MUL_KARATSUBA_THRESHOLD || bn < 4) {
+        _bigdec_mul_basecase(r, a, an, b, bn);
+        return;
+    }
+
+    uint32_t h = (an + 1) / 2;
+    if (bn <= h) {
+        uint32_t *tmp = (uint32_t *)malloc(2 * bn * sizeof(uint32_t));
+        memset(r, 0, (an + bn) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < an; i += bn) {
+            uint32_t len = an - i < bn ? an - i : bn;
+            _bigdec_mul_mag(tmp, b, bn, a + i, len);
+            _bigdec_limbs_add_to(r + i, an + bn - i, tmp, bn + len);
+        }
+        free(tmp);
+        return;
+    }
+
+    uint32_t *sa = (uint32_t *)malloc((4 * h + 4) * sizeof(uint32_t));
+    uint32_t *sb = sa + h + 1;
+    uint32_t *z1 = sb + h + 1;
+
+    memcpy(sa, a, h * sizeof(uint32_t));
+    sa[h] = _bigdec_limbs_add_to(sa, h, a + h, an - h);
+    memcpy(sb, b, h * sizeof(uint32_t));
+    sb[h] = _bigdec_limbs_add_to(sb, h, b + h, bn - h);
+    _bigdec_mul_mag(z1, sa, h + 1, sb, h + 1);
+
+    _bigdec_mul_mag(r, a, h, b, h);
+    _bigdec_mul_mag(r + 2*h, a + h, an - h, b + h, bn - h);
+
+    _bigdec_limbs_sub_from(z1, 2*h + 2, r, 2*h);
+    _bigdec_limbs_sub_from(z1, 2*h + 2, r + 2*h, an + bn - 2*h);
+    uint32_t z1_len = 2*h + 2 < an + bn - h ? 2*h + 2 : an + bn - h;
+    _bigdec_limbs_add_to(r + h, an + bn - h, z1, z1_len);
+
+    free(sa);
+}
+
+_BIGINT_INLINE bigdec_tp _bigdec_add_signed_inplace(bigdec_tp n, const uint32_t *m, uint32_t m_digits, int m_sign)
+{
+    // n += m_sign * m, where m doesn't point into n
+    uint32_t n_digits = n->digits;
+    if (n->sign == m_sign) {
+        uint32_t digits = (n_digits > m_digits ? n_digits : m_digits) + 1;
+        n = _bigdec_realloc(n, digits);
+        memset(&n->num[n_digits], 0, (digits - n_digits) * sizeof(uint32_t));
+        _bigdec_limbs_add_to(n->num, digits, m, m_digits);
+    } else if (_bigdec_cmp_mag(n->num, n_digits, m, m_digits) >= 0) {
+        _bigdec_limbs_sub_from(n->num, n_digits, m, m_digits);
+    } else {
+        // |m| > |n|, so the result is m - n with the sign of m
+        n = _bigdec_realloc(n, m_digits);
+        memset(&n->num[n_digits], 0, (m_digits - n_digits) * sizeof(uint32_t));
+        uint32_t borrow = 0;
+        for (uint32_t i = 0; i < m_digits; ++i) {
+            uint32_t sub = n->num[i] + borrow;
+            borrow = m[i] < sub;
+            n->num[i] = borrow ? m[i] + BIGDEC_BASE - sub : m[i] - sub;
+        }
+        n->sign = m_sign;
+    }
+    _bigdec_crop(n);
+    return n;
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_add_inplace(bigdec_tp n, bigdec_tp m)
+{
+    if (n == m) return bigdec_mul32_inplace(n, 2);
+    return _bigdec_add_signed_inplace(n, m->num, m->digits, m->sign);
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_add(bigdec_tp n, bigdec_tp m)
+{
+    bigdec_tp res = bigdec_dup(n);
+    return _bigdec_add_signed_inplace(res, m->num, m->digits, m->sign);
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_sub_inplace(bigdec_tp n, bigdec_tp m)
+{
+    if (n == m) {
+        bigdec_free(n);
+        return bigdec_from_int(0);
+    }
+    return _bigdec_add_signed_inplace(n, m->num, m->digits, -m->sign);
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_sub(bigdec_tp n, bigdec_tp m)
+{
+    bigdec_tp res = bigdec_dup(n);
+    return _bigdec_add_signed_inplace(res, m->num, m->digits, -m->sign);
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_mul32_inplace(bigdec_tp n, int32_t m)
+{
+    uint32_t m_u = m < 0 ? -(uint32_t)m : (uint32_t)m;
+    uint64_t carry = 0;
+    for (uint32_t i = 0; i < n->digits; ++i) {
+        uint64_t val = (uint64_t)n->num[i] * m_u + carry;
+        n->num[i] = val % BIGDEC_BASE;
+        carry = val / BIGDEC_BASE;
+    }
+    // the carry can be up to two digits
+    while (carry != 0) {
+        n = _bigdec_realloc(n, n->digits + 1);
+        n->num[n->digits-1] = carry % BIGDEC_BASE;
+        carry /= BIGDEC_BASE;
+    }
+    if (m < 0) n->sign = -n->sign;
+    _bigdec_crop(n);
+    return n;
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_mul32(bigdec_tp n, int32_t m)
+{
+    bigdec_tp res = bigdec_dup(n);
+    return bigdec_mul32_inplace(res, m);
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_mul(bigdec_tp n, bigdec_tp m)
+{
+    bigdec_tp res = _bigdec_new(n->digits + m->digits);
+    if (n->digits >= m->digits)
+        _bigdec_mul_mag(res->num, n->num, n->digits, m->num, m->digits);
+    else
+        _bigdec_mul_mag(res->num, m->num, m->digits, n->num, n->digits);
+    res->sign = n->sign * m->sign;
+    _bigdec_crop(res);
+    return res;
+}
+
+_BIGINT_INLINE char *bigdec_to_string(bigdec_tp n)
+{
+    char *s = (char *)malloc(2 + BIGDEC_BASE_DIGITS * n->digits);
+    char *p = s;
+    if (n->sign < 0) *(p++) = '-';
+
+    // the top digit without leading zeros...
+    char buf[BIGDEC_BASE_DIGITS];
+    int len = 0;
+    uint32_t top = n->num[n->digits-1];
+    do {
+        buf[len++] = '0' + top % 10;
+        top /= 10;
+    } while (top != 0);
+    while (len > 0)
+        *(p++) = buf[--len];
+
+    // ...and all the others with
+    for (uint32_t i = n->digits - 1; i-- > 0; ) {
+        uint32_t val = n->num[i];
+        for (int k = BIGDEC_BASE_DIGITS - 1; k >= 0; --k) {
+            p[k] = '0' + val % 10;
+            val /= 10;
+        }
+        p += BIGDEC_BASE_DIGITS;
+    }
+    *p = '\0';
+    return s;
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_from_string(const char *c)
+{
+    int sign = 1;
+    if (*c == '-') {
+        sign = -1;
+        c++;
+    }
+    size_t len = strlen(c);
+    for (size_t i = 0; i < len; ++i)
+        if (c[i] < '0' || c[i] > '9') return NULL; // error!
+    if (len == 0) return bigdec_from_int(0);
+
+    uint32_t digits = (len + BIGDEC_BASE_DIGITS - 1) / BIGDEC_BASE_DIGITS;
+    bigdec_tp res = _bigdec_new(digits);
+    // chunks of nine characters, starting from the end
+    const char *end = c + len;
+    for (uint32_t i = 0; i < digits; ++i) {
+        const char *start = end - c > BIGDEC_BASE_DIGITS ? end - BIGDEC_BASE_DIGITS : c;
+        uint32_t val = 0;
+        for (const char *p = start; p < end; ++p)
+            val = val * 10 + (*p - '0');
+        res->num[i] = val;
+        end = start;
+    }
+    res->sign = sign;
+    _bigdec_crop(res);
+    return res;
+}
+
+_BIGINT_INLINE bigint_tp _bigdec_to_bigint_mag(const uint32_t *num, uint32_t digits, bigint_tp *powers)
+{
+    // Converts the magnitude num[0..digits) by splitting it in two:
+    // hi * 10^(9 k) + lo, with k a power of two so that we can reuse the
+    // powers (powers[j] = 10^(9 * 2^j), computed as needed).
+    if (digits < BIGDEC_TO_BIGINT_THRESHOLD || digits < 2) {
+        bigint_tp res = bigint_from_int(0);
+        for (uint32_t i = digits; i-- > 0; ) {
+            res = bigint_mul32u_inplace(res, BIGDEC_BASE);
+            res = bigint_add32_inplace(res, num[i]);
+        }
+        return res;
+    }
+
+    int j = 0;
+    while ((2u << j) < digits) ++j;
+    uint32_t k = 1u << j;
+    for (int i = 0; i <= j; ++i)
+        if (powers[i] == NULL)
+            powers[i] = i == 0 ? bigint_from_int(BIGDEC_BASE) : bigint_mul(powers[i-1], powers[i-1]);
+
+    bigint_tp hi = _bigdec_to_bigint_mag(num + k, digits - k, powers);
+    bigint_tp lo = _bigdec_to_bigint_mag(num, k, powers);
+    lo = bigint_addmul_inplace(lo, hi, powers[j]);
+    bigint_free(hi);
+    return lo;
+}
+
+_BIGINT_INLINE bigint_tp bigdec_to_bigint(bigdec_tp n)
+{
+    bigint_tp powers[32] = {0};
+    bigint_tp res = _bigdec_to_bigint_mag(n->num, n->digits, powers);
+    for (int j = 0; j < 32; ++j)
+        if (powers[j] != NULL) bigint_free(powers[j]);
+    if (n->sign < 0) res = bigint_flipsign(res);
+    return res;
+}
+
+_BIGINT_INLINE bigdec_tp _bigdec_from_bigint_mag(const uint32_t *num, uint32_t digits, bigdec_tp *powers)
+{
+    // The same the other way around: hi * 2^(32 k) + lo, where
+    // powers[j] = 2^(32 * 2^j) in decimal.
+    if (digits < BIGDEC_FROM_BIGINT_THRESHOLD || digits < 2) {
+        // 32 bits need a bit more than one decimal digit
+        bigdec_tp res = _bigdec_new(digits + digits / 8 + 2);
+        uint32_t used = 1;
+        res->num[0] = 0;
+        for (uint32_t i = digits; i-- > 0; ) {
+            // res = res * 2^32 + num[i]
+            uint64_t carry = num[i];
+            for (uint32_t l = 0; l < used; ++l) {
+                uint64_t val = ((uint64_t)res->num[l] << BIGINT_WIDTH_BITS) + carry;
+                res->num[l] = val % BIGDEC_BASE;
+                carry = val / BIGDEC_BASE;
+            }
+            while (carry != 0) {
+                res->num[used++] = carry % BIGDEC_BASE;
+                carry /= BIGDEC_BASE;
+            }
+        }
+        res->digits = used;
+        _bigdec_crop(res);
+        return res;
+    }
+
+    int j = 0;
+    while ((2u << j) < digits) ++j;
+    uint32_t k = 1u << j;
+    if (powers[0] == NULL) {
+        powers[0] = _bigdec_new(2);
+        powers[0]->num[0] = (1ull << BIGINT_WIDTH_BITS) % BIGDEC_BASE;
+        powers[0]->num[1] = (1ull << BIGINT_WIDTH_BITS) / BIGDEC_BASE;
+    }
+    for (int i = 1; i <= j; ++i)
+        if (powers[i] == NULL)
+            powers[i] = bigdec_mul(powers[i-1], powers[i-1]);
+
+    bigdec_tp hi = _bigdec_from_bigint_mag(num + k, digits - k, powers);
+    bigdec_tp lo = _bigdec_from_bigint_mag(num, k, powers);
+    bigdec_tp res = bigdec_mul(hi, powers[j]);
+    res = _bigdec_add_signed_inplace(res, lo->num, lo->digits, 1);
+    bigdec_free(hi);
+    bigdec_free(lo);
+    return res;
+}
+
+_BIGINT_INLINE bigdec_tp bigdec_from_bigint(bigint_tp n)
+{
+    int sign = bigint_sgn(n);
+    if (sign < 0) n = bigint_neg_into(NULL, n);
+
+    bigdec_tp powers[32] = {0};
+    bigdec_tp res = _bigdec_from_bigint_mag(n->num, _bigint_mag_digits(n), powers);
+    for (int j = 0; j < 32; ++j)
+        if (powers[j] != NULL) bigdec_free(powers[j]);
+
+    if (sign < 0) {
+        bigint_free(n);
+        res = bigdec_flipsign(res);
+    }
+    return res;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _BIGDEC_IMPL_H_ */
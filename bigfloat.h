@@ -0,0 +1,63 @@
+/* bigint library - bigfloat.h
+   Binary floating point numbers: function declarations / public interface.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGFLOAT_H_
+#define _BIGFLOAT_H_
+
+#include "bigint.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* A bigfloat is mant * 2^exp, where mant has at most prec bits. Every
+   operation rounds its exact result to nearest (ties to even); binary
+   operations work to the larger precision of their operands. */
+struct _bigfloat {
+    bigint_tp mant;
+    int64_t exp;
+    uint32_t prec;
+};
+typedef struct _bigfloat * bigfloat_tp;
+
+inline bigfloat_tp bigfloat_dup(bigfloat_tp f);
+inline void bigfloat_free(bigfloat_tp f);
+
+inline bigfloat_tp bigfloat_from_int(int64_t i, uint32_t prec);
+inline bigfloat_tp bigfloat_from_bigint(bigint_tp mant, int64_t exp, uint32_t prec);
+inline char *bigfloat_to_string(bigfloat_tp f, uint32_t digits);
+
+inline int bigfloat_sgn(bigfloat_tp f);
+inline int bigfloat_cmp(bigfloat_tp f, bigfloat_tp g);
+
+inline bigfloat_tp bigfloat_flipsign(bigfloat_tp f);
+
+inline bigfloat_tp bigfloat_add(bigfloat_tp f, bigfloat_tp g);
+inline bigfloat_tp bigfloat_sub(bigfloat_tp f, bigfloat_tp g);
+inline bigfloat_tp bigfloat_mul(bigfloat_tp f, bigfloat_tp g);
+inline bigfloat_tp bigfloat_div(bigfloat_tp f, bigfloat_tp g);
+inline bigfloat_tp bigfloat_recip(bigfloat_tp f);
+inline bigfloat_tp bigfloat_sqrt(bigfloat_tp f);
+
+inline bigfloat_tp _bigfloat_new(bigint_tp mant, int64_t exp, uint32_t prec);
+inline uint64_t _bigfloat_bits(bigint_tp m);
+inline uint64_t _bigfloat_top_bits(bigint_tp m, uint64_t bits, int k);
+inline bigint_tp _bigfloat_shift_round(bigint_tp m, uint64_t k);
+inline bigint_tp _bigfloat_mag(bigint_tp m);
+inline bigfloat_tp _bigfloat_addsub(bigfloat_tp f, bigfloat_tp g, int sign, uint32_t prec);
+inline bigfloat_tp _bigfloat_mul_prec(bigfloat_tp f, bigfloat_tp g, uint32_t prec);
+inline bigfloat_tp _bigfloat_recip_approx(bigint_tp d, uint32_t bits);
+inline bigfloat_tp _bigfloat_rsqrt_approx(bigint_tp n, uint32_t bits);
+inline bigint_tp _bigfloat_divrem_mag(bigint_tp n, bigint_tp d, int *inexact);
+inline bigint_tp _bigfloat_sqrtrem_mag(bigint_tp n, int *inexact);
+inline bigint_tp _bigfloat_pow10(uint32_t k);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#include "bigfloat_impl.h"
+
+#endif /* _BIGFLOAT_H_ */
@@ -0,0 +1,522 @@
+/* bigint library - bigfloat_impl.h
+   Binary floating point numbers: function definitions (all inline).
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGFLOAT_IMPL_H_
+#define _BIGFLOAT_IMPL_H_
+
+#include "bigfloat.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* from these sizes (in digits of the divisor, or of the number under the
+   square root) on, division and square roots go through Newton iterations,
+   which only need multiplications, instead of schoolbook methods */
+#define BIGFLOAT_DIV_NEWTON_THRESHOLD_DEFAULT 1024
+#ifndef BIGFLOAT_DIV_NEWTON_THRESHOLD
+# define BIGFLOAT_DIV_NEWTON_THRESHOLD BIGFLOAT_DIV_NEWTON_THRESHOLD_DEFAULT
+#endif
+#define BIGFLOAT_SQRT_NEWTON_THRESHOLD_DEFAULT 32
+#ifndef BIGFLOAT_SQRT_NEWTON_THRESHOLD
+# define BIGFLOAT_SQRT_NEWTON_THRESHOLD BIGFLOAT_SQRT_NEWTON_THRESHOLD_DEFAULT
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+_BIGINT_INLINE uint64_t _bigfloat_bits(bigint_tp m)
+{
+    // number of significant bits of m >= 0
+    uint32_t digits = _bigint_mag_digits(m);
+    uint32_t top = m->num[digits-1];
+    uint64_t bits = (uint64_t)BIGINT_WIDTH_BITS * (digits - 1);
+    while (top != 0) {
+        bits++;
+        top >>= 1;
+    }
+    return bits;
+}
+
+_BIGINT_INLINE uint64_t _bigfloat_top_bits(bigint_tp m, uint64_t bits, int k)
+{
+    // the top k < 64 bits of m >= 0, which has the given number of bits
+    uint64_t res = 0;
+    for (int i = 0; i < k; ++i) {
+        int64_t pos = (int64_t)bits - 1 - i;
+        uint32_t bit = pos >= 0 ? (m->num[pos / BIGINT_WIDTH_BITS] >> (pos % BIGINT_WIDTH_BITS)) & 1 : 0;
+        res = (res << 1) | bit;
+    }
+    return res;
+}
+
+_BIGINT_INLINE bigint_tp _bigfloat_mag(bigint_tp m)
+{
+    // |m|, as a new number
+    return bigint_sgn(m) < 0 ? bigint_neg_into(NULL, m) : bigint_dup(m);
+}
+
+_BIGINT_INLINE bigint_tp _bigfloat_shift_round(bigint_tp m, uint64_t k)
+{
+    // m / 2^k for m >= 0, rounded to nearest, ties to even (consumes m)
+    if (k == 0) return m;
+    if (k > _bigfloat_bits(m)) {
+        // m < 2^(k-1), less than half
+        bigint_free(m);
+        return bigint_from_int(0);
+    }
+    uint64_t pos = k - 1;
+    uint32_t digit = pos / BIGINT_WIDTH_BITS;
+    int half = 0, sticky = 0;
+    if (digit < m->digits) {
+        half = (m->num[digit] >> (pos % BIGINT_WIDTH_BITS)) & 1;
+        sticky = (m->num[digit] & ((1u << (pos % BIGINT_WIDTH_BITS)) - 1)) != 0;
+        for (uint32_t i = 0; i < digit && !sticky; ++i)
+            sticky = m->num[i] != 0;
+    }
+    // k fits in the number, but not necessarily in bigint_shift's int32_t
+    for (; k > INT32_MAX; k -= INT32_MAX)
+        m = bigint_shift(m, -INT32_MAX);
+    m = bigint_shift(m, -(int32_t)k);
+    if (half && (sticky || (m->num[0] & 1)))
+        m = bigint_add32_inplace(m, 1);
+    return m;
+}
+
+_BIGINT_INLINE bigfloat_tp _bigfloat_new(bigint_tp mant, int64_t exp, uint32_t prec)
+{
+    // rounds mant * 2^exp to prec bits (takes ownership of mant)
+    bigfloat_tp res = (bigfloat_tp)malloc(sizeof(struct _bigfloat));
+    res->prec = prec;
+    if (bigint_cmp32(mant, 0) == 0) {
+        res->mant = mant;
+        res->exp = 0;
+        return res;
+    }
+
+    int sign = bigint_sgn(mant);
+    if (sign < 0) mant = bigint_flipsign(mant);
+    uint64_t bits = _bigfloat_bits(mant);
+    if (bits > prec) {
+        mant = _bigfloat_shift_round(mant, bits - prec);
+        exp += bits - prec;
+        if (_bigfloat_bits(mant) > prec) {
+            // rounded up to the next power of two
+            mant = bigint_shift(mant, -1);
+            exp++;
+        }
+    }
+    if (sign < 0) mant = bigint_flipsign(mant);
+    res->mant = mant;
+    res->exp = exp;
+    return res;
+}
+
+_BIGINT_INLINE void bigfloat_free(bigfloat_tp f)
+{
+    bigint_free(f->mant);
+    free(f);
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_dup(bigfloat_tp f)
+{
+    bigfloat_tp res = (bigfloat_tp)malloc(sizeof(struct _bigfloat));
+    *res = *f;
+    res->mant = bigint_dup(f->mant);
+    return res;
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_from_int(int64_t i, uint32_t prec)
+{
+    return _bigfloat_new(bigint_from_int(i), 0, prec);
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_from_bigint(bigint_tp mant, int64_t exp, uint32_t prec)
+{
+    return _bigfloat_new(bigint_dup(mant), exp, prec);
+}
+
+_BIGINT_INLINE int bigfloat_sgn(bigfloat_tp f)
+{
+    return bigint_sgn(f->mant);
+}
+
+_BIGINT_INLINE int bigfloat_cmp(bigfloat_tp f, bigfloat_tp g)
+{
+    int f_zero = bigint_cmp32(f->mant, 0) == 0;
+    int g_zero = bigint_cmp32(g->mant, 0) == 0;
+    if (f_zero || g_zero) {
+        if (f_zero && g_zero) return 0;
+        return f_zero ? -bigfloat_sgn(g) : bigfloat_sgn(f);
+    }
+    int sign = bigfloat_sgn(f);
+    if (sign != bigfloat_sgn(g)) return sign;
+
+    // compare the position of the top bits first...
+    bigint_tp m = _bigfloat_mag(f->mant);
+    bigint_tp n = _bigfloat_mag(g->mant);
+    int64_t f_top = f->exp + _bigfloat_bits(m);
+    int64_t g_top = g->exp + _bigfloat_bits(n);
+    int res;
+    if (f_top != g_top) {
+        res = f_top > g_top ? sign : -sign;
+    } else {
+        // ...and then line them up
+        int64_t exp = f->exp < g->exp ? f->exp : g->exp;
+        m = bigint_shift(m, f->exp - exp);
+        n = bigint_shift(n, g->exp - exp);
+        res = sign * bigint_cmp(m, n);
+    }
+    bigint_free(m);
+    bigint_free(n);
+    return res;
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_flipsign(bigfloat_tp f)
+{
+    f->mant = bigint_flipsign(f->mant);
+    return f;
+}
+
+_BIGINT_INLINE bigfloat_tp _bigfloat_addsub(bigfloat_tp f, bigfloat_tp g, int sign, uint32_t prec)
+{
+    // f + sign * g, rounded to prec bits
+    bigint_tp m = bigint_dup(f->mant);
+    bigint_tp n = sign < 0 ? bigint_neg_into(NULL, g->mant) : bigint_dup(g->mant);
+    int64_t m_exp = f->exp, n_exp = g->exp;
+    if (bigint_cmp32(n, 0) == 0) {
+        bigint_free(n);
+        return _bigfloat_new(m, m_exp, prec);
+    } else if (bigint_cmp32(m, 0) == 0) {
+        bigint_free(m);
+        return _bigfloat_new(n, n_exp, prec);
+    }
+
+    // make m the one with the higher top bit
+    bigint_tp m_mag = _bigfloat_mag(m), n_mag = _bigfloat_mag(n);
+    uint64_t m_bits = _bigfloat_bits(m_mag), n_bits = _bigfloat_bits(n_mag);
+    bigint_free(m_mag);
+    bigint_free(n_mag);
+    if (n_exp + (int64_t)n_bits > m_exp + (int64_t)m_bits) {
+        bigint_tp t = m; m = n; n = t;
+        int64_t te = m_exp; m_exp = n_exp; n_exp = te;
+        uint64_t tb = m_bits; m_bits = n_bits; n_bits = tb;
+    }
+
+    // If n lies entirely below the last bit of m with a few guard bits, all
+    // it can do is nudge m off a tie, so an extra bit standing in for it
+    // rounds the same way. This keeps 1 + 2^-1000000 cheap.
+    uint32_t guard = m_bits < (uint64_t)prec + 3 ? prec + 3 - m_bits : 0;
+    if (n_exp + (int64_t)n_bits < m_exp - guard) {
+        int n_sign = bigint_sgn(n);
+        bigint_free(n);
+        m = bigint_shift(m, guard + 1);
+        m = bigint_add32_inplace(m, n_sign);
+        return _bigfloat_new(m, m_exp - guard - 1, prec);
+    }
+
+    // otherwise the exact sum isn't much longer than the operands
+    int64_t exp = m_exp < n_exp ? m_exp : n_exp;
+    m = bigint_shift(m, m_exp - exp);
+    n = bigint_shift(n, n_exp - exp);
+    m = bigint_add_inplace(m, n);
+    bigint_free(n);
+    return _bigfloat_new(m, exp, prec);
+}
+
+_BIGINT_INLINE bigfloat_tp _bigfloat_mul_prec(bigfloat_tp f, bigfloat_tp g, uint32_t prec)
+{
+    return _bigfloat_new(bigint_mul(f->mant, g->mant), f->exp + g->exp, prec);
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_add(bigfloat_tp f, bigfloat_tp g)
+{
+    return _bigfloat_addsub(f, g, 1, f->prec > g->prec ? f->prec : g->prec);
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_sub(bigfloat_tp f, bigfloat_tp g)
+{
+    return _bigfloat_addsub(f, g, -1, f->prec > g->prec ? f->prec : g->prec);
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_mul(bigfloat_tp f, bigfloat_tp g)
+{
+    return _bigfloat_mul_prec(f, g, f->prec > g->prec ? f->prec : g->prec);
+}
+
+_BIGINT_INLINE bigfloat_tp _bigfloat_recip_approx(bigint_tp d, uint32_t bits)
+{
+    // 1/d for d > 0, to about the given number of bits
+    uint64_t d_bits = _bigfloat_bits(d);
+    // start with 32 bits or so from machine division...
+    uint64_t top = _bigfloat_top_bits(d, d_bits, 32);
+    bigfloat_tp x = _bigfloat_new(bigint_from_int(((uint64_t)1 << 63) / top), -31 - (int64_t)d_bits, 64);
+    bigfloat_tp one = bigfloat_from_int(1, 2);
+
+    // ...and double that with every step of x += x (1 - d x)
+    uint32_t correct = 28;
+    while (correct < bits) {
+        correct = 2 * correct - 2 < bits ? 2 * correct - 2 : bits;
+        uint32_t wp = correct + 16;
+        bigfloat_tp df = _bigfloat_new(bigint_dup(d), 0, wp);
+        bigfloat_tp e = _bigfloat_mul_prec(df, x, wp);
+        bigfloat_tp t = _bigfloat_addsub(one, e, -1, wp);
+        bigfloat_free(e);
+        e = _bigfloat_mul_prec(x, t, wp);
+        bigfloat_free(t);
+        t = _bigfloat_addsub(x, e, 1, wp);
+        bigfloat_free(x);
+        bigfloat_free(e);
+        bigfloat_free(df);
+        x = t;
+    }
+    bigfloat_free(one);
+    return x;
+}
+
+_BIGINT_INLINE bigfloat_tp _bigfloat_rsqrt_approx(bigint_tp n, uint32_t bits)
+{
+    // 1/sqrt(n) for n > 0, to about the given number of bits
+    uint64_t n_bits = _bigfloat_bits(n);
+    // n ~ top * 2^(n_bits - k), with an even power of two
+    int k = (n_bits & 1) ? 61 : 62;
+    uint64_t top = _bigfloat_top_bits(n, n_bits, k);
+    uint64_t s = top, s_next = (top + 1) / 2;
+    while (s_next < s) {
+        s = s_next;
+        s_next = (s + top / s) / 2;
+    }
+    int64_t exp = -62 - ((int64_t)n_bits - k) / 2;
+    bigfloat_tp y = _bigfloat_new(bigint_from_int(((uint64_t)1 << 62) / s), exp, 64);
+    bigfloat_tp one = bigfloat_from_int(1, 2);
+
+    // y += y (1 - n y^2) / 2
+    uint32_t correct = 28;
+    while (correct < bits) {
+        correct = 2 * correct - 2 < bits ? 2 * correct - 2 : bits;
+        uint32_t wp = correct + 16;
+        bigfloat_tp nf = _bigfloat_new(bigint_dup(n), 0, wp);
+        bigfloat_tp t = _bigfloat_mul_prec(y, y, wp);
+        bigfloat_tp u = _bigfloat_mul_prec(nf, t, wp);
+        bigfloat_free(t);
+        t = _bigfloat_addsub(one, u, -1, wp);
+        bigfloat_free(u);
+        u = _bigfloat_mul_prec(y, t, wp);
+        u->exp--;
+        bigfloat_free(t);
+        t = _bigfloat_addsub(y, u, 1, wp);
+        bigfloat_free(y);
+        bigfloat_free(u);
+        bigfloat_free(nf);
+        y = t;
+    }
+    bigfloat_free(one);
+    return y;
+}
+
+_BIGINT_INLINE bigint_tp _bigfloat_divrem_mag(bigint_tp n, bigint_tp d, int *inexact)
+{
+    // floor(n / d) for n >= 0, d > 0; *inexact tells whether it was exact
+    bigint_tp q, r;
+    if (_bigint_mag_digits(d) < BIGFLOAT_DIV_NEWTON_THRESHOLD) {
+        q = bigint_divrem(n, d, &r);
+    } else {
+        // multiply by the reciprocal, and then fix up the last bit or so
+        uint64_t q_bits = _bigfloat_bits(n) - _bigfloat_bits(d) + 1;
+        bigfloat_tp x = _bigfloat_recip_approx(d, q_bits + 4);
+        q = bigint_mul(n, x->mant);
+        q = bigint_shift(q, x->exp);
+        bigfloat_free(x);
+
+        r = bigint_dup(n);
+        r = bigint_submul_inplace(r, q, d);
+        while (bigint_sgn(r) < 0) {
+            q = bigint_add32_inplace(q, -1);
+            r = bigint_add_inplace(r, d);
+        }
+        while (bigint_cmp(r, d) >= 0) {
+            q = bigint_add32_inplace(q, 1);
+            r = bigint_sub_inplace(r, d);
+        }
+    }
+    *inexact = bigint_cmp32(r, 0) != 0;
+    bigint_free(r);
+    return q;
+}
+
+_BIGINT_INLINE bigint_tp _bigfloat_sqrtrem_mag(bigint_tp n, int *inexact)
+{
+    // floor(sqrt(n)) for n >= 0; *inexact tells whether it was exact
+    uint64_t n_bits = _bigfloat_bits(n);
+    bigint_tp s;
+    if (n_bits == 0) {
+        *inexact = 0;
+        return bigint_from_int(0);
+    } else if (_bigint_mag_digits(n) < BIGFLOAT_SQRT_NEWTON_THRESHOLD) {
+        // Newton's method on the integers, from above
+        s = bigint_shift(bigint_from_int(1), (n_bits + 1) / 2);
+        for (;;) {
+            bigint_tp next = bigint_div(n, s);
+            next = bigint_add_inplace(next, s);
+            next = bigint_shift(next, -1);
+            if (bigint_cmp(next, s) >= 0) {
+                bigint_free(next);
+                break;
+            }
+            bigint_free(s);
+            s = next;
+        }
+    } else {
+        // sqrt(n) = n / sqrt(n), which only needs multiplications
+        bigfloat_tp y = _bigfloat_rsqrt_approx(n, (n_bits + 1) / 2 + 4);
+        s = bigint_mul(n, y->mant);
+        s = bigint_shift(s, y->exp);
+        bigfloat_free(y);
+    }
+
+    // fix up the last bit or so: we need 0 <= n - s^2 <= 2s
+    bigint_tp two = bigint_from_int(2);
+    bigint_tp r = bigint_dup(n);
+    r = bigint_submul_inplace(r, s, s);
+    while (bigint_sgn(r) < 0) {
+        // (s-1)^2 = s^2 - 2(s-1) - 1
+        s = bigint_add32_inplace(s, -1);
+        r = bigint_addmul_inplace(r, s, two);
+        r = bigint_add32_inplace(r, 1);
+    }
+    for (;;) {
+        bigint_tp two_s = bigint_mul32(s, 2);
+        int done = bigint_cmp(r, two_s) <= 0;
+        bigint_free(two_s);
+        if (done) break;
+        r = bigint_submul_inplace(r, s, two);
+        r = bigint_add32_inplace(r, -1);
+        s = bigint_add32_inplace(s, 1);
+    }
+    bigint_free(two);
+    *inexact = bigint_cmp32(r, 0) != 0;
+    bigint_free(r);
+    return s;
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_div(bigfloat_tp f, bigfloat_tp g)
+{
+    if (bigint_cmp32(g->mant, 0) == 0) return NULL;
+    uint32_t prec = f->prec > g->prec ? f->prec : g->prec;
+    if (bigint_cmp32(f->mant, 0) == 0) return bigfloat_from_int(0, prec);
+
+    int sign = bigfloat_sgn(f) * bigfloat_sgn(g);
+    bigint_tp n = _bigfloat_mag(f->mant);
+    bigint_tp d = _bigfloat_mag(g->mant);
+    // scale so that the quotient has prec + 2 or 3 bits: then the rounding
+    // is decided by those and whether there's a remainder
+    int64_t shift = (int64_t)prec + 3 + _bigfloat_bits(d) - _bigfloat_bits(n);
+    if (shift > 0) n = bigint_shift(n, shift);
+    else d = bigint_shift(d, -shift);
+
+    int inexact;
+    bigint_tp q = _bigfloat_divrem_mag(n, d, &inexact);
+    bigint_free(n);
+    bigint_free(d);
+    q = bigint_shift(q, 1);
+    q = bigint_add32_inplace(q, inexact);
+    if (sign < 0) q = bigint_flipsign(q);
+    return _bigfloat_new(q, f->exp - g->exp - shift - 1, prec);
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_recip(bigfloat_tp f)
+{
+    bigfloat_tp one = bigfloat_from_int(1, f->prec);
+    bigfloat_tp res = bigfloat_div(one, f);
+    bigfloat_free(one);
+    return res;
+}
+
+_BIGINT_INLINE bigfloat_tp bigfloat_sqrt(bigfloat_tp f)
+{
+    if (bigint_cmp32(f->mant, 0) == 0) return bigfloat_from_int(0, f->prec);
+    if (bigfloat_sgn(f) < 0) return NULL;
+
+    // as with division: prec + 2 or 3 bits and a remainder, and an even
+    // exponent so that we can halve it
+    int64_t shift = 2 * ((int64_t)f->prec + 3) - _bigfloat_bits(f->mant);
+    if (shift < 0) shift = 0;
+    if ((f->exp - shift) & 1) shift++;
+    bigint_tp n = bigint_shift(bigint_dup(f->mant), shift);
+
+    int inexact;
+    bigint_tp s = _bigfloat_sqrtrem_mag(n, &inexact);
+    bigint_free(n);
+    s = bigint_shift(s, 1);
+    s = bigint_add32_inplace(s, inexact);
+    return _bigfloat_new(s, (f->exp - shift) / 2 - 1, f->prec);
+}
+
+_BIGINT_INLINE bigint_tp _bigfloat_pow10(uint32_t k)
+{
+    bigint_tp res = bigint_from_int(1);
+    bigint_tp p = bigint_from_int(10);
+    while (k != 0) {
+        if (k & 1) {
+            bigint_tp t = bigint_mul(res, p);
+            bigint_free(res);
+            res = t;
+        }
+        k >>= 1;
+        if (k != 0) {
+            bigint_tp t = bigint_mul(p, p);
+            bigint_free(p);
+            p = t;
+        }
+    }
+    bigint_free(p);
+    return res;
+}
+
+_BIGINT_INLINE char *bigfloat_to_string(bigfloat_tp f, uint32_t digits)
+{
+    // fixed point with the given number of digits after the point,
+    // rounded to nearest (ties to even)
+    int sign = bigfloat_sgn(f);
+    bigint_tp p10 = _bigfloat_pow10(digits);
+    bigint_tp m = _bigfloat_mag(f->mant);
+    bigint_tp d = bigint_mul(m, p10);
+    bigint_free(m);
+    bigint_free(p10);
+    if (f->exp >= 0) {
+        for (int64_t e = f->exp; e > 0; e -= INT32_MAX)
+            d = bigint_shift(d, e > INT32_MAX ? INT32_MAX : (int32_t)e);
+    } else {
+        d = _bigfloat_shift_round(d, -(uint64_t)f->exp);
+    }
+
+    int negative = sign < 0 && bigint_cmp32(d, 0) != 0;
+    char *num = bigint_to_string(d);
+    bigint_free(d);
+    size_t len = strlen(num);
+    // at least one digit before the point
+    size_t pad = len <= digits ? digits + 1 - len : 0;
+
+    char *s = (char *)malloc(len + pad + 3);
+    char *p = s;
+    if (negative) *(p++) = '-';
+    memset(p, '0', pad);
+    memcpy(p + pad, num, len);
+    p += pad + len;
+    free(num);
+    if (digits > 0) {
+        memmove(p - digits + 1, p - digits, digits);
+        *(p - digits) = '.';
+        p++;
+    }
+    *p = '\0';
+    return s;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _BIGFLOAT_IMPL_H_ */
@@ -4,5 +4,16 @@
    Copyright 2020 Thomas Jollans - see COPYING */
 
 #define _BIGINT_INLINE extern inline
+// mmap() and friends, for bigint_disk
+#define _DEFAULT_SOURCE
 
 #include "bigint_impl.h"
+#include "bigdec_impl.h"
+#include "bigq_impl.h"
+#include "bigfloat_impl.h"
+#include "bigint_prime_impl.h"
+#include "bigrns_impl.h"
+#include "bigint_dag_impl.h"
+#ifdef __SIZEOF_INT128__
+#include "bigint_disk_impl.h"
+#endif
@@ -5,7 +5,9 @@
 #ifndef _BIGINT_H_
 #define _BIGINT_H_
 
+#include <stddef.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -14,16 +16,66 @@ extern "C"
 
 struct _bigint {
     uint32_t digits;
+#ifdef BIGINT_REFCOUNT
+    uint32_t refs;
+#endif
     uint32_t num[];
 };
 typedef struct _bigint * bigint_tp;
 
+/* division by a single digit d with a precomputed reciprocal */
+struct _bigint_limb_inv {
+    uint32_t d;     // d shifted left until its top bit is set
+    uint32_t v;     // floor((2^64 - 1) / d) - 2^32 for the shifted d
+    int shift;
+};
+
+/* arithmetic modulo an odd number m in Montgomery form, where x is
+   represented by x R mod m with R = 2^(32 n) */
+struct _bigint_mont {
+    bigint_tp m;
+    uint32_t n;         // digits of m
+    uint32_t minv;      // -1/m mod 2^32
+    uint32_t *tmp;      // room for a product
+};
+
+/* precomputed powers of g mod m for bigint_fixed_base_pow */
+struct _bigint_fixed_base {
+    struct _bigint_mont mont;
+    bigint_tp g;
+    uint32_t max_bits;  // longest exponent the tables cover
+    uint32_t h, v;      // rows and blocks of the comb
+    uint32_t a, b;      // bits per row and per block
+    uint32_t *table;    // v tables of 2^h numbers, in Montgomery form
+};
+typedef struct _bigint_fixed_base * bigint_fixed_base_tp;
+
+#define BIGINT_INTERN_SEGMENTS 64
+
+struct _bigint_intern_entry {
+    uint64_t hash;
+    bigint_tp n;
+    struct _bigint_intern_entry *next;
+};
+struct _bigint_intern_segment {
+    pthread_mutex_t lock;
+    uint32_t n_buckets;
+    uint32_t count;
+    struct _bigint_intern_entry **buckets;
+};
+struct _bigint_intern {
+    struct _bigint_intern_segment segments[BIGINT_INTERN_SEGMENTS];
+};
+typedef struct _bigint_intern * bigint_intern_tp;
+
 inline bigint_tp bigint_dup(bigint_tp n);
 inline void bigint_free(bigint_tp n);
 
 inline bigint_tp bigint_from_int(int64_t i);
 inline char *bigint_to_string(bigint_tp n);
 inline bigint_tp bigint_from_string(const char *c);
+inline char *bigint_to_str_base(bigint_tp n, int base);
+inline bigint_tp bigint_from_str_base(const char *c, int base);
 
 inline int bigint_sgn(bigint_tp n);
 inline int bigint_cmp32(bigint_tp n, int32_t m);
@@ -36,24 +88,110 @@ inline bigint_tp bigint_add(bigint_tp n, bigint_tp m);
 inline bigint_tp bigint_add_inplace(bigint_tp n, bigint_tp m);
 inline bigint_tp bigint_add32(bigint_tp n, int32_t m);
 inline bigint_tp bigint_add32_inplace(bigint_tp n, int32_t m);
+inline bigint_tp bigint_sub(bigint_tp n, bigint_tp m);
+inline bigint_tp bigint_sub_inplace(bigint_tp n, bigint_tp m);
+inline bigint_tp bigint_rsub_inplace(bigint_tp n, bigint_tp m);
+inline bigint_tp bigint_sub32(bigint_tp n, int32_t m);
+inline bigint_tp bigint_sub32_inplace(bigint_tp n, int32_t m);
+inline bigint_tp bigint_neg_into(bigint_tp r, bigint_tp n);
 
 inline bigint_tp bigint_mul(bigint_tp n, bigint_tp m);
 inline bigint_tp bigint_mul32(bigint_tp n, int32_t m);
 inline bigint_tp bigint_mul32_inplace(bigint_tp n, int32_t m);
 inline bigint_tp bigint_mul32u(bigint_tp n, uint32_t m);
 inline bigint_tp bigint_mul32u_inplace(bigint_tp n, uint32_t m);
+inline bigint_tp bigint_addmul_inplace(bigint_tp n, bigint_tp a, bigint_tp b);
+inline bigint_tp bigint_submul_inplace(bigint_tp n, bigint_tp a, bigint_tp b);
 
 inline bigint_tp bigint_div(bigint_tp n, bigint_tp d);
+inline bigint_tp bigint_divrem(bigint_tp n, bigint_tp d, bigint_tp *remainder);
 inline bigint_tp bigint_div32(bigint_tp numerator, int32_t denominator, int32_t *remainder);
 inline bigint_tp bigint_div32_inplace(bigint_tp numerator, int32_t denominator, int32_t *remainder);
+inline bigint_tp bigint_divrem_1(bigint_tp n, uint32_t d, uint32_t k, uint32_t *rems);
+inline bigint_tp bigint_divrem_1_inplace(bigint_tp n, uint32_t d, uint32_t k, uint32_t *rems);
+inline bigint_tp bigint_mod(bigint_tp n, bigint_tp d);
+inline bigint_tp bigint_mod_inplace(bigint_tp n, bigint_tp d);
+inline int bigint_mod_many(bigint_tp n, const uint32_t *moduli, uint32_t k, uint32_t *out);
 
 inline bigint_tp bigint_sqrt(bigint_tp n);
+inline bigint_tp bigint_gcd(bigint_tp n, bigint_tp m);
+inline bigint_tp bigint_powmod(bigint_tp b, bigint_tp e, bigint_tp m);
+
+inline bigint_fixed_base_tp bigint_fixed_base_new(bigint_tp g, bigint_tp m, uint32_t max_bits, uint32_t h, uint32_t v);
+inline void bigint_fixed_base_free(bigint_fixed_base_tp fb);
+inline bigint_tp bigint_fixed_base_pow(bigint_fixed_base_tp fb, bigint_tp e);
+inline unsigned char *bigint_fixed_base_to_bytes(bigint_fixed_base_tp fb, size_t *size);
+inline bigint_fixed_base_tp bigint_fixed_base_from_bytes(const unsigned char *buf, size_t size);
+
+inline uint64_t bigint_hash(bigint_tp n);
+inline uint64_t bigint_hash_seed(bigint_tp n, uint64_t seed);
+
+inline bigint_intern_tp bigint_intern_new(void);
+inline void bigint_intern_free(bigint_intern_tp t);
+inline bigint_tp bigint_intern(bigint_intern_tp t, bigint_tp n);
 
 inline bigint_tp _bigint_new(uint32_t digits);
 inline bigint_tp _bigint_realloc(bigint_tp n, uint32_t digits);
+inline bigint_tp _bigint_copy(bigint_tp n);
+inline bigint_tp _bigint_unshare(bigint_tp n);
 inline void _bigint_crop(bigint_tp n);
-inline bigint_tp _bigint_find_quotient(bigint_tp n, bigint_tp d, bigint_tp overestimate, bigint_tp underestimate);
+inline uint32_t _bigint_mag_digits(bigint_tp n);
+inline void _bigint_limb_inv_init(struct _bigint_limb_inv *inv, uint32_t d);
+inline uint32_t _bigint_div_limb_preinv(uint32_t *r, uint32_t u, const struct _bigint_limb_inv *inv);
+inline void _bigint_limbs_divrem_1(uint32_t *q, const uint32_t *a, uint32_t n,
+                                   const struct _bigint_limb_inv *inv, uint32_t k, uint32_t *rems);
+inline uint32_t _bigint_limbs_mod_1(const uint32_t *a, uint32_t n, const struct _bigint_limb_inv *inv);
+inline uint32_t _bigint_mod_1(bigint_tp n, uint32_t d);
+inline uint32_t _bigint_limbs_sub(uint32_t *r, const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn);
+inline bigint_tp _bigint_put_top(bigint_tp n, uint32_t top);
+inline uint32_t _bigint_limbs_add_to(uint32_t *r, uint32_t rn, const uint32_t *a, uint32_t an);
+inline uint32_t _bigint_limbs_sub_from(uint32_t *r, uint32_t rn, const uint32_t *a, uint32_t an);
+inline uint32_t _bigint_limbs_addmul1(uint32_t *r, const uint32_t *a, uint32_t n, uint32_t m);
+inline uint32_t _bigint_limbs_submul1(uint32_t *r, const uint32_t *a, uint32_t n, uint32_t m);
+inline void _bigint_mul_basecase(uint32_t *r, const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn);
+inline void _bigint_sqr_basecase(uint32_t *r, const uint32_t *a, uint32_t n);
+inline void _bigint_mul_mag(uint32_t *r, const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn);
+inline void _bigint_sqr_mag(uint32_t *r, const uint32_t *a, uint32_t n);
+inline uint32_t _bigint_mul_digits(uint32_t *r, bigint_tp n, bigint_tp m);
+inline bigint_tp _bigint_add_digits_inplace(bigint_tp n, const uint32_t *m, uint32_t m_digits, int m_sign);
+inline bigint_tp _bigint_addmul_mag_inplace(bigint_tp n, bigint_tp a, bigint_tp b, int sign);
+inline void _bigint_divrem_mag(uint32_t *q, uint32_t *r, const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn);
+inline int32_t _bigint_recip_bits(bigint_tp d);
+inline bigint_tp _bigint_recip_refine(bigint_tp d, bigint_tp x);
+inline bigint_tp _bigint_recip(bigint_tp d);
+inline bigint_tp _bigint_divrem_recip(bigint_tp n, bigint_tp d, bigint_tp inv, bigint_tp *r);
+inline void _bigint_mod_mag(uint32_t *r, const uint32_t *x, uint32_t xn, bigint_tp d);
+inline void _bigint_mod_many_leaf(uint32_t r, const uint32_t *moduli, uint32_t k, uint32_t *out);
+inline bigint_tp _bigint_mod_tree_build(bigint_tp *tree, uint32_t node, const uint32_t *prods, uint32_t lo, uint32_t hi);
+inline void _bigint_mod_tree_descend(bigint_tp *tree, uint32_t node, const uint32_t *x, uint32_t xn,
+                                     const uint32_t *group, uint32_t lo, uint32_t hi,
+                                     const uint32_t *moduli, uint32_t *out);
+inline int _bigint_limbs_cmp(const uint32_t *a, const uint32_t *b, uint32_t n);
+inline void _bigint_mont_init(struct _bigint_mont *mont, bigint_tp m);
+inline void _bigint_mont_free(struct _bigint_mont *mont);
+inline void _bigint_mont_redc(const struct _bigint_mont *mont, uint32_t *r, uint32_t *t);
+inline void _bigint_mont_mul(struct _bigint_mont *mont, uint32_t *r, const uint32_t *a, const uint32_t *b);
+inline void _bigint_mont_add(const struct _bigint_mont *mont, uint32_t *r, const uint32_t *a, const uint32_t *b);
+inline void _bigint_mont_sub(const struct _bigint_mont *mont, uint32_t *r, const uint32_t *a, const uint32_t *b);
+inline void _bigint_mont_half(const struct _bigint_mont *mont, uint32_t *r);
+inline void _bigint_mont_to(struct _bigint_mont *mont, uint32_t *r, bigint_tp x);
+inline bigint_tp _bigint_mont_from(struct _bigint_mont *mont, const uint32_t *a);
+inline void _bigint_mont_pow(struct _bigint_mont *mont, uint32_t *r, const uint32_t *a, bigint_tp e);
+inline uint32_t *_bigint_fixed_base_entry(bigint_fixed_base_tp fb, uint32_t s, uint32_t i);
+inline void _bigint_fixed_base_fill(bigint_fixed_base_tp fb, uint32_t max_bits, uint32_t h, uint32_t v);
+inline void _bigint_fixed_base_put(unsigned char **p, const uint32_t *words, size_t count);
+inline void _bigint_fixed_base_get(const unsigned char **p, uint32_t *words, size_t count);
+inline uint32_t _bigint_char_value(int c);
+inline uint32_t _bigint_str_base_chunk(int base, uint32_t *chars);
+inline void _bigint_to_base_pow2(char *s, size_t len, const uint32_t *num, uint32_t digits, int bits);
+inline int _bigint_from_base_pow2(uint32_t *num, uint32_t digits, const char *c, size_t len, int bits);
+inline void _bigint_str_base_powers(uint32_t big, int j, bigint_tp *powers, bigint_tp *invs);
+inline bigint_tp _bigint_from_base_mag(const uint32_t *num, uint32_t digits, uint32_t big, bigint_tp *powers);
+inline void _bigint_to_base_mag(char *s, size_t width, bigint_tp n, int base, bigint_tp *powers, bigint_tp *invs);
 inline bigint_tp _bigint_find_sqrt(bigint_tp n, bigint_tp overestimate, bigint_tp underestimate);
+inline uint32_t _bigint_cropped_digits(bigint_tp n);
+inline uint64_t _bigint_hash_mix(uint64_t a, uint64_t b);
+inline void _bigint_intern_grow(struct _bigint_intern_segment *seg);
 
 #ifdef __cplusplus
 } // extern "C"
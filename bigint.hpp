@@ -0,0 +1,541 @@
+/* bigint library - bigint.hpp
+   C++ interface: a class that owns a bigint_tp.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGINT_HPP_
+#define _BIGINT_HPP_
+
+#include "bigint.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+class bigint;
+
+namespace bigint_detail {
+
+struct add_op {};
+struct sub_op {};
+struct mul_op {};
+struct div_op {};
+struct mod_op {};
+
+template <class Op, class L, class R> class expr;
+
+template <class T> struct is_expr : std::false_type {};
+template <class Op, class L, class R> struct is_expr<expr<Op, L, R>> : std::true_type {};
+
+template <class T> struct is_operand
+    : std::integral_constant<bool, std::is_same<T, bigint>::value || is_expr<T>::value> {};
+
+// Expressions keep bigints by reference and sub-expressions by value.
+template <class T> struct stored { typedef T type; };
+template <> struct stored<bigint> { typedef const bigint &type; };
+
+template <class L, class R, class T = void>
+using enable_if_operands = typename std::enable_if<
+    is_operand<L>::value && is_operand<R>::value, T>::type;
+
+template <class R, class T = void>
+using enable_if_operand = typename std::enable_if<is_operand<R>::value, T>::type;
+
+} // namespace bigint_detail
+
+/* Arbitrary precision integer.
+
+   Arithmetic between lvalues is lazy: a + b, a * b etc. return small
+   expression objects holding references to their operands, which are only
+   evaluated when assigned to a bigint. The evaluation works in the storage
+   of the result as far as possible, so that a*b + c, x += y*z and
+   (a*b) % m don't create any intermediate numbers. As always with expression
+   templates, don't keep expressions around in auto variables beyond the
+   lifetime of their operands.
+
+   When the left operand is an rvalue, its storage is reused directly.
+
+   A moved-from bigint may only be assigned to or destroyed. */
+class bigint
+{
+public:
+    bigint() : n_(bigint_from_int(0)) {}
+    template <class I, class = typename std::enable_if<std::is_integral<I>::value>::type>
+    bigint(I i) : n_(from_integral(i)) {}
+    explicit bigint(const char *s) : n_(bigint_from_string(s))
+    {
+        if (n_ == nullptr) throw std::invalid_argument("bigint: invalid number");
+    }
+    explicit bigint(const std::string &s) : bigint(s.c_str()) {}
+
+    bigint(const bigint &other) : n_(bigint_dup(other.n_)) {}
+    bigint(bigint &&other) noexcept : n_(other.n_) { other.n_ = nullptr; }
+
+    template <class Op, class L, class R>
+    bigint(const bigint_detail::expr<Op, L, R> &e) : n_(e.eval().release()) {}
+
+    ~bigint() { if (n_ != nullptr) bigint_free(n_); }
+
+    // take ownership of a bigint_tp from the C interface
+    static bigint adopt(bigint_tp n)
+    {
+        return bigint(n, adopt_tag());
+    }
+
+    bigint &operator=(const bigint &other)
+    {
+        if (this != &other) reset(bigint_dup(other.n_));
+        return *this;
+    }
+
+    bigint &operator=(bigint &&other) noexcept
+    {
+        std::swap(n_, other.n_);
+        return *this;
+    }
+
+    template <class Op, class L, class R>
+    bigint &operator=(const bigint_detail::expr<Op, L, R> &e)
+    {
+        // evaluate first: e may refer to *this
+        reset(e.eval().release());
+        return *this;
+    }
+
+    void swap(bigint &other) noexcept { std::swap(n_, other.n_); }
+
+    bigint_tp get() const { return n_; }
+
+    bigint_tp release()
+    {
+        bigint_tp n = n_;
+        n_ = nullptr;
+        return n;
+    }
+
+    int sgn() const { return bigint_cmp32(n_, 0); }
+
+    std::string to_string() const
+    {
+        char *s = bigint_to_string(n_);
+        std::string res(s);
+        free(s);
+        return res;
+    }
+
+    // compound assignment - these are where the actual work happens
+
+    bigint &operator+=(const bigint &m)
+    {
+        if (&m == this) n_ = bigint_mul32_inplace(n_, 2);
+        else n_ = bigint_add_inplace(n_, m.n_);
+        return *this;
+    }
+
+    bigint &operator-=(const bigint &m)
+    {
+        n_ = bigint_sub_inplace(n_, m.n_);
+        return *this;
+    }
+
+    bigint &operator*=(const bigint &m)
+    {
+        reset(bigint_mul(n_, m.n_));
+        return *this;
+    }
+
+    bigint &operator/=(const bigint &m)
+    {
+        bigint_tp q = bigint_div(n_, m.n_);
+        if (q == nullptr) throw std::domain_error("bigint: division by zero");
+        reset(q);
+        return *this;
+    }
+
+    bigint &operator%=(const bigint &m)
+    {
+        if (bigint_cmp32(m.n_, 0) == 0) throw std::domain_error("bigint: division by zero");
+        if (&m == this) reset(bigint_from_int(0));
+        else n_ = bigint_mod_inplace(n_, m.n_);
+        return *this;
+    }
+
+    template <class Op, class L, class R>
+    bigint &operator+=(const bigint_detail::expr<Op, L, R> &e)
+    {
+        if (e.uses(*this)) return *this += bigint(e);
+        add_expr(Op(), e, false);
+        return *this;
+    }
+
+    template <class Op, class L, class R>
+    bigint &operator-=(const bigint_detail::expr<Op, L, R> &e)
+    {
+        if (e.uses(*this)) return *this -= bigint(e);
+        add_expr(Op(), e, true);
+        return *this;
+    }
+
+    template <class Op, class L, class R>
+    bigint &operator*=(const bigint_detail::expr<Op, L, R> &e) { return *this *= bigint(e); }
+
+    template <class Op, class L, class R>
+    bigint &operator/=(const bigint_detail::expr<Op, L, R> &e) { return *this /= bigint(e); }
+
+    template <class Op, class L, class R>
+    bigint &operator%=(const bigint_detail::expr<Op, L, R> &e) { return *this %= bigint(e); }
+
+    bigint &operator+=(int64_t m)
+    {
+        if (m < INT32_MIN || m > INT32_MAX) return *this += bigint(m);
+        n_ = bigint_add32_inplace(n_, (int32_t)m);
+        return *this;
+    }
+
+    bigint &operator-=(int64_t m)
+    {
+        if (m < INT32_MIN || m > INT32_MAX) return *this -= bigint(m);
+        n_ = bigint_sub32_inplace(n_, (int32_t)m);
+        return *this;
+    }
+
+    bigint &operator*=(int64_t m)
+    {
+        if (m <= INT32_MIN || m > INT32_MAX) return *this *= bigint(m);
+        n_ = bigint_mul32_inplace(n_, (int32_t)m);
+        return *this;
+    }
+
+    bigint &operator/=(int64_t m)
+    {
+        if (m <= INT32_MIN || m > INT32_MAX) return *this /= bigint(m);
+        if (m == 0) throw std::domain_error("bigint: division by zero");
+        n_ = bigint_div32_inplace(n_, (int32_t)m, nullptr);
+        return *this;
+    }
+
+    bigint &operator%=(int64_t m)
+    {
+        if (m <= INT32_MIN || m > INT32_MAX) return *this %= bigint(m);
+        if (m == 0) throw std::domain_error("bigint: division by zero");
+        // only the remainder is needed, so don't write the quotient into n_
+        int64_t rem = _bigint_mod_1(n_, m < 0 ? -(uint32_t)m : (uint32_t)m);
+        reset(bigint_from_int(bigint_sgn(n_) < 0 ? -rem : rem));
+        return *this;
+    }
+
+    bigint &operator<<=(int32_t shift)
+    {
+        n_ = bigint_shift(n_, shift);
+        return *this;
+    }
+
+    bigint &operator>>=(int32_t shift)
+    {
+        n_ = bigint_shift(n_, -shift);
+        return *this;
+    }
+
+    bigint &negate()
+    {
+        n_ = bigint_flipsign(n_);
+        return *this;
+    }
+
+private:
+    template <class I>
+    static bigint_tp from_integral(I i)
+    {
+        if (std::is_unsigned<I>::value && (uint64_t)i > INT64_MAX) {
+            bigint_tp n = bigint_shift(bigint_from_int((int64_t)(i >> 1)), 1);
+            return bigint_add32_inplace(n, i & 1);
+        }
+        return bigint_from_int((int64_t)i);
+    }
+
+    struct adopt_tag {};
+    bigint(bigint_tp n, adopt_tag) : n_(n) {}
+
+    void reset(bigint_tp n)
+    {
+        if (n_ != nullptr) bigint_free(n_);
+        n_ = n;
+    }
+
+    // *this += e or *this -= e, taking sums apart so that every term is
+    // added in place
+    template <class L, class R>
+    void add_expr(bigint_detail::add_op, const bigint_detail::expr<bigint_detail::add_op, L, R> &e, bool subtract)
+    {
+        add_term(e.lhs(), subtract);
+        add_term(e.rhs(), subtract);
+    }
+
+    template <class L, class R>
+    void add_expr(bigint_detail::sub_op, const bigint_detail::expr<bigint_detail::sub_op, L, R> &e, bool subtract)
+    {
+        add_term(e.lhs(), subtract);
+        add_term(e.rhs(), !subtract);
+    }
+
+    template <class L, class R>
+    void add_expr(bigint_detail::mul_op, const bigint_detail::expr<bigint_detail::mul_op, L, R> &e, bool subtract);
+
+    template <class Op, class L, class R>
+    void add_expr(Op, const bigint_detail::expr<Op, L, R> &e, bool subtract)
+    {
+        add_term(bigint(e), subtract);
+    }
+
+    void add_term(const bigint &m, bool subtract)
+    {
+        if (subtract) *this -= m;
+        else *this += m;
+    }
+
+    template <class Op, class L, class R>
+    void add_term(const bigint_detail::expr<Op, L, R> &e, bool subtract)
+    {
+        add_expr(Op(), e, subtract);
+    }
+
+    bigint_tp n_;
+};
+
+namespace bigint_detail {
+
+// The value of an operand as a new bigint we can work on
+inline bigint value(const bigint &b) { return b; }
+template <class Op, class L, class R>
+bigint value(const expr<Op, L, R> &e) { return e.eval(); }
+
+// The value of an operand to read from: no copy for plain bigints
+inline const bigint &arg(const bigint &b) { return b; }
+template <class Op, class L, class R>
+bigint arg(const expr<Op, L, R> &e) { return e.eval(); }
+
+inline bool uses(const bigint &b, const bigint &target) { return &b == &target; }
+template <class Op, class L, class R>
+bool uses(const expr<Op, L, R> &e, const bigint &target) { return e.uses(target); }
+
+template <class Op, class L, class R>
+class expr
+{
+public:
+    expr(const L &l, const R &r) : l_(l), r_(r) {}
+
+    const L &lhs() const { return l_; }
+    const R &rhs() const { return r_; }
+
+    bool uses(const bigint &target) const
+    {
+        return bigint_detail::uses(l_, target) || bigint_detail::uses(r_, target);
+    }
+
+    bigint eval() const { return eval(Op()); }
+
+private:
+    // start with the left operand and apply the right one in place
+    bigint eval(add_op) const
+    {
+        bigint res = value(l_);
+        res += r_;
+        return res;
+    }
+
+    bigint eval(sub_op) const
+    {
+        bigint res = value(l_);
+        res -= r_;
+        return res;
+    }
+
+    bigint eval(mul_op) const
+    {
+        auto &&a = arg(l_);
+        auto &&b = arg(r_);
+        return bigint::adopt(bigint_mul(a.get(), b.get()));
+    }
+
+    bigint eval(div_op) const
+    {
+        auto &&a = arg(l_);
+        auto &&b = arg(r_);
+        bigint_tp q = bigint_div(a.get(), b.get());
+        if (q == nullptr) throw std::domain_error("bigint: division by zero");
+        return bigint::adopt(q);
+    }
+
+    bigint eval(mod_op) const
+    {
+        bigint res = value(l_);
+        res %= r_;
+        return res;
+    }
+
+    typename stored<L>::type l_;
+    typename stored<R>::type r_;
+};
+
+} // namespace bigint_detail
+
+template <class L, class R>
+void bigint::add_expr(bigint_detail::mul_op, const bigint_detail::expr<bigint_detail::mul_op, L, R> &e, bool subtract)
+{
+    // fused multiply-add
+    auto &&a = bigint_detail::arg(e.lhs());
+    auto &&b = bigint_detail::arg(e.rhs());
+    if (subtract) n_ = bigint_submul_inplace(n_, a.get(), b.get());
+    else n_ = bigint_addmul_inplace(n_, a.get(), b.get());
+}
+
+// Lazy operators between lvalues and expressions
+
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bigint_detail::expr<bigint_detail::add_op, L, R>>
+operator+(const L &l, const R &r) { return {l, r}; }
+
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bigint_detail::expr<bigint_detail::sub_op, L, R>>
+operator-(const L &l, const R &r) { return {l, r}; }
+
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bigint_detail::expr<bigint_detail::mul_op, L, R>>
+operator*(const L &l, const R &r) { return {l, r}; }
+
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bigint_detail::expr<bigint_detail::div_op, L, R>>
+operator/(const L &l, const R &r) { return {l, r}; }
+
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bigint_detail::expr<bigint_detail::mod_op, L, R>>
+operator%(const L &l, const R &r) { return {l, r}; }
+
+// Eager operators reusing an rvalue's storage
+
+template <class R>
+bigint_detail::enable_if_operand<R, bigint> operator+(bigint &&l, const R &r) { return std::move(l += r); }
+template <class R>
+bigint_detail::enable_if_operand<R, bigint> operator-(bigint &&l, const R &r) { return std::move(l -= r); }
+template <class R>
+bigint_detail::enable_if_operand<R, bigint> operator*(bigint &&l, const R &r) { return std::move(l *= r); }
+template <class R>
+bigint_detail::enable_if_operand<R, bigint> operator/(bigint &&l, const R &r) { return std::move(l /= r); }
+template <class R>
+bigint_detail::enable_if_operand<R, bigint> operator%(bigint &&l, const R &r) { return std::move(l %= r); }
+
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator+(const L &l, bigint &&r) { return std::move(r += l); }
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator-(const L &l, bigint &&r)
+{
+    if (bigint_detail::uses(l, r)) return std::move(bigint_detail::value(l) -= r);
+    return std::move(r.negate() += l);
+}
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator*(const L &l, bigint &&r) { return std::move(r *= l); }
+
+inline bigint operator+(bigint &&l, bigint &&r) { return std::move(l += r); }
+inline bigint operator-(bigint &&l, bigint &&r) { return std::move(l -= r); }
+inline bigint operator*(bigint &&l, bigint &&r) { return std::move(l *= r); }
+
+// Operators with machine integers
+
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator+(const L &l, int64_t r) { return std::move(bigint_detail::value(l) += r); }
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator-(const L &l, int64_t r) { return std::move(bigint_detail::value(l) -= r); }
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator*(const L &l, int64_t r) { return std::move(bigint_detail::value(l) *= r); }
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator/(const L &l, int64_t r) { return std::move(bigint_detail::value(l) /= r); }
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator%(const L &l, int64_t r) { return std::move(bigint_detail::value(l) %= r); }
+
+inline bigint operator+(bigint &&l, int64_t r) { return std::move(l += r); }
+inline bigint operator-(bigint &&l, int64_t r) { return std::move(l -= r); }
+inline bigint operator*(bigint &&l, int64_t r) { return std::move(l *= r); }
+inline bigint operator/(bigint &&l, int64_t r) { return std::move(l /= r); }
+inline bigint operator%(bigint &&l, int64_t r) { return std::move(l %= r); }
+
+template <class L>
+bigint_detail::enable_if_operand<L, bigint> operator-(const L &l) { return std::move(bigint_detail::value(l).negate()); }
+inline bigint operator-(bigint &&l) { return std::move(l.negate()); }
+
+inline bigint operator<<(const bigint &l, int32_t shift) { return std::move(bigint(l) <<= shift); }
+inline bigint operator<<(bigint &&l, int32_t shift) { return std::move(l <<= shift); }
+inline bigint operator>>(const bigint &l, int32_t shift) { return std::move(bigint(l) >>= shift); }
+inline bigint operator>>(bigint &&l, int32_t shift) { return std::move(l >>= shift); }
+
+// Comparisons
+
+namespace bigint_detail {
+
+template <class L, class R>
+int compare(const L &l, const R &r)
+{
+    auto &&a = arg(l);
+    auto &&b = arg(r);
+    return bigint_cmp(a.get(), b.get());
+}
+
+template <class L>
+int compare(const L &l, int64_t r)
+{
+    if (r < INT32_MIN || r > INT32_MAX) return compare(l, bigint(r));
+    return bigint_cmp32(arg(l).get(), (int32_t)r);
+}
+
+} // namespace bigint_detail
+
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bool> operator==(const L &l, const R &r) { return bigint_detail::compare(l, r) == 0; }
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bool> operator!=(const L &l, const R &r) { return bigint_detail::compare(l, r) != 0; }
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bool> operator<(const L &l, const R &r) { return bigint_detail::compare(l, r) < 0; }
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bool> operator<=(const L &l, const R &r) { return bigint_detail::compare(l, r) <= 0; }
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bool> operator>(const L &l, const R &r) { return bigint_detail::compare(l, r) > 0; }
+template <class L, class R>
+bigint_detail::enable_if_operands<L, R, bool> operator>=(const L &l, const R &r) { return bigint_detail::compare(l, r) >= 0; }
+
+template <class L>
+bigint_detail::enable_if_operand<L, bool> operator==(const L &l, int64_t r) { return bigint_detail::compare(l, r) == 0; }
+template <class L>
+bigint_detail::enable_if_operand<L, bool> operator!=(const L &l, int64_t r) { return bigint_detail::compare(l, r) != 0; }
+template <class L>
+bigint_detail::enable_if_operand<L, bool> operator<(const L &l, int64_t r) { return bigint_detail::compare(l, r) < 0; }
+template <class L>
+bigint_detail::enable_if_operand<L, bool> operator<=(const L &l, int64_t r) { return bigint_detail::compare(l, r) <= 0; }
+template <class L>
+bigint_detail::enable_if_operand<L, bool> operator>(const L &l, int64_t r) { return bigint_detail::compare(l, r) > 0; }
+template <class L>
+bigint_detail::enable_if_operand<L, bool> operator>=(const L &l, int64_t r) { return bigint_detail::compare(l, r) >= 0; }
+
+inline std::ostream &operator<<(std::ostream &os, const bigint &n)
+{
+    return os << n.to_string();
+}
+
+template <class Op, class L, class R>
+std::ostream &operator<<(std::ostream &os, const bigint_detail::expr<Op, L, R> &e)
+{
+    return os << e.eval();
+}
+
+inline void swap(bigint &a, bigint &b) noexcept { a.swap(b); }
+
+namespace std {
+template <> struct hash<bigint>
+{
+    size_t operator()(const bigint &n) const { return bigint_hash(n.get()); }
+};
+} // namespace std
+
+#endif /* _BIGINT_HPP_ */
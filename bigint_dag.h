@@ -0,0 +1,110 @@
+/* bigint library - bigint_dag.h
+   Expression graphs evaluated on several threads: function declarations /
+   public interface.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGINT_DAG_H_
+#define _BIGINT_DAG_H_
+
+#include "bigint.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* returned instead of a node when the operands aren't nodes of the dag */
+#define BIGINT_DAG_NONE ((uint32_t)-1)
+
+enum {
+    BIGINT_DAG_INPUT,
+    BIGINT_DAG_ADD,
+    BIGINT_DAG_SUB,
+    BIGINT_DAG_MUL,
+    BIGINT_DAG_DIV,
+    BIGINT_DAG_SQRT,
+    BIGINT_DAG_SHIFT
+};
+
+struct _bigint_dag_node {
+    int op;
+    uint32_t a, b;          // operands
+    int32_t shift;          // for BIGINT_DAG_SHIFT
+    int keep;               // the value is wanted after evaluation
+    uint32_t consumers;     // uses as an operand (x + x counts twice)
+    bigint_tp value;
+    // evaluation state
+    uint32_t pending;       // operands that haven't been evaluated yet
+    uint32_t uses_left;     // uses that haven't been evaluated yet
+    int thread;
+    uint32_t digits;        // of the result, for the profile
+    double start, seconds;
+};
+
+/* Nodes that are ready to run, for one thread. The thread takes the newest
+   one from the bottom; other threads steal the oldest from the top. */
+struct _bigint_dag_deque {
+    pthread_mutex_t lock;
+    uint32_t top, bottom;
+    uint32_t *nodes;
+};
+
+/* A bigint_dag is built up from inputs and operations on earlier nodes, and
+   evaluated once. Only the results nobody uses (and the nodes passed to
+   bigint_dag_keep()) are kept; everything else is freed as soon as the
+   last node using it is done. */
+struct _bigint_dag {
+    uint32_t count, capacity;
+    struct _bigint_dag_node *nodes;
+    int evaluated;
+    int failed;
+    // evaluation state
+    uint32_t *users;        // the nodes using node i are users[users_start[i]..users_start[i+1])
+    uint32_t *users_start;
+    struct _bigint_dag_deque *deques;
+    int threads;
+    int next_thread;
+    uint32_t remaining;     // nodes still to run
+    uint32_t ready;         // nodes waiting in the deques
+    uint32_t sleepers;      // threads waiting for work
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    double t0;
+};
+typedef struct _bigint_dag * bigint_dag_tp;
+
+inline bigint_dag_tp bigint_dag_new(void);
+inline void bigint_dag_free(bigint_dag_tp dag);
+
+inline uint32_t bigint_dag_input(bigint_dag_tp dag, bigint_tp n);
+inline uint32_t bigint_dag_add(bigint_dag_tp dag, uint32_t a, uint32_t b);
+inline uint32_t bigint_dag_sub(bigint_dag_tp dag, uint32_t a, uint32_t b);
+inline uint32_t bigint_dag_mul(bigint_dag_tp dag, uint32_t a, uint32_t b);
+inline uint32_t bigint_dag_div(bigint_dag_tp dag, uint32_t a, uint32_t b);
+inline uint32_t bigint_dag_sqrt(bigint_dag_tp dag, uint32_t a);
+inline uint32_t bigint_dag_shift(bigint_dag_tp dag, uint32_t a, int32_t shift);
+inline void bigint_dag_keep(bigint_dag_tp dag, uint32_t node);
+
+inline int bigint_dag_eval(bigint_dag_tp dag, int threads);
+inline bigint_tp bigint_dag_value(bigint_dag_tp dag, uint32_t node);
+inline void bigint_dag_profile(bigint_dag_tp dag, FILE *f);
+
+inline uint32_t _bigint_dag_node_new(bigint_dag_tp dag, int op, uint32_t a, uint32_t b, int32_t shift);
+inline int _bigint_dag_owned(bigint_dag_tp dag, uint32_t node);
+inline void _bigint_dag_release(bigint_dag_tp dag, uint32_t node);
+inline double _bigint_dag_now(void);
+inline void _bigint_dag_push(bigint_dag_tp dag, int thread, uint32_t node);
+inline uint32_t _bigint_dag_pop(bigint_dag_tp dag, int thread);
+inline void _bigint_dag_run(bigint_dag_tp dag, int thread, uint32_t node);
+inline void *_bigint_dag_worker(void *arg);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#include "bigint_dag_impl.h"
+
+#endif /* _BIGINT_DAG_H_ */
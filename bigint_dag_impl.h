@@ -0,0 +1,377 @@
+/* bigint library - bigint_dag_impl.h
+   Expression graphs evaluated on several threads: function definitions
+   (all inline).
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGINT_DAG_IMPL_H_
+#define _BIGINT_DAG_IMPL_H_
+
+#include "bigint_dag.h"
+#include "bigfloat.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+_BIGINT_INLINE bigint_dag_tp bigint_dag_new(void)
+{
+    bigint_dag_tp dag = (bigint_dag_tp)calloc(1, sizeof(struct _bigint_dag));
+    dag->capacity = 16;
+    dag->nodes = (struct _bigint_dag_node *)malloc(dag->capacity * sizeof(struct _bigint_dag_node));
+    return dag;
+}
+
+_BIGINT_INLINE void bigint_dag_free(bigint_dag_tp dag)
+{
+    for (uint32_t i = 0; i < dag->count; ++i)
+        if (dag->nodes[i].value != NULL) bigint_free(dag->nodes[i].value);
+    free(dag->nodes);
+    free(dag);
+}
+
+_BIGINT_INLINE uint32_t _bigint_dag_node_new(bigint_dag_tp dag, int op, uint32_t a, uint32_t b, int32_t shift)
+{
+    // a and b are nodes, or BIGINT_DAG_NONE where the operation doesn't
+    // have that operand
+    if (dag->evaluated) return BIGINT_DAG_NONE;
+    if (op != BIGINT_DAG_INPUT && a >= dag->count) return BIGINT_DAG_NONE;
+    if (b != BIGINT_DAG_NONE && b >= dag->count) return BIGINT_DAG_NONE;
+    if (op != BIGINT_DAG_INPUT && op != BIGINT_DAG_SQRT && op != BIGINT_DAG_SHIFT && b == BIGINT_DAG_NONE)
+        return BIGINT_DAG_NONE;
+
+    if (dag->count == dag->capacity) {
+        dag->capacity *= 2;
+        dag->nodes = (struct _bigint_dag_node *)realloc(dag->nodes,
+                                                         dag->capacity * sizeof(struct _bigint_dag_node));
+    }
+    struct _bigint_dag_node *node = &dag->nodes[dag->count];
+    memset(node, 0, sizeof(struct _bigint_dag_node));
+    node->op = op;
+    node->a = a;
+    node->b = b;
+    node->shift = shift;
+    if (op != BIGINT_DAG_INPUT) dag->nodes[a].consumers++;
+    if (b != BIGINT_DAG_NONE) dag->nodes[b].consumers++;
+    return dag->count++;
+}
+
+_BIGINT_INLINE uint32_t bigint_dag_input(bigint_dag_tp dag, bigint_tp n)
+{
+    uint32_t i = _bigint_dag_node_new(dag, BIGINT_DAG_INPUT, BIGINT_DAG_NONE, BIGINT_DAG_NONE, 0);
+    if (i != BIGINT_DAG_NONE) dag->nodes[i].value = bigint_dup(n);
+    return i;
+}
+
+_BIGINT_INLINE uint32_t bigint_dag_add(bigint_dag_tp dag, uint32_t a, uint32_t b)
+{
+    return _bigint_dag_node_new(dag, BIGINT_DAG_ADD, a, b, 0);
+}
+
+_BIGINT_INLINE uint32_t bigint_dag_sub(bigint_dag_tp dag, uint32_t a, uint32_t b)
+{
+    return _bigint_dag_node_new(dag, BIGINT_DAG_SUB, a, b, 0);
+}
+
+_BIGINT_INLINE uint32_t bigint_dag_mul(bigint_dag_tp dag, uint32_t a, uint32_t b)
+{
+    return _bigint_dag_node_new(dag, BIGINT_DAG_MUL, a, b, 0);
+}
+
+_BIGINT_INLINE uint32_t bigint_dag_div(bigint_dag_tp dag, uint32_t a, uint32_t b)
+{
+    return _bigint_dag_node_new(dag, BIGINT_DAG_DIV, a, b, 0);
+}
+
+_BIGINT_INLINE uint32_t bigint_dag_sqrt(bigint_dag_tp dag, uint32_t a)
+{
+    return _bigint_dag_node_new(dag, BIGINT_DAG_SQRT, a, BIGINT_DAG_NONE, 0);
+}
+
+_BIGINT_INLINE uint32_t bigint_dag_shift(bigint_dag_tp dag, uint32_t a, int32_t shift)
+{
+    return _bigint_dag_node_new(dag, BIGINT_DAG_SHIFT, a, BIGINT_DAG_NONE, shift);
+}
+
+_BIGINT_INLINE void bigint_dag_keep(bigint_dag_tp dag, uint32_t node)
+{
+    if (node < dag->count) dag->nodes[node].keep = 1;
+}
+
+_BIGINT_INLINE int _bigint_dag_owned(bigint_dag_tp dag, uint32_t node)
+{
+    // the only consumer of a value nobody wants afterwards may overwrite it
+    return dag->nodes[node].consumers == 1 && !dag->nodes[node].keep;
+}
+
+_BIGINT_INLINE void _bigint_dag_release(bigint_dag_tp dag, uint32_t node)
+{
+    // one use of node is done; free the value after the last one
+    struct _bigint_dag_node *n = &dag->nodes[node];
+    if (__atomic_sub_fetch(&n->uses_left, 1, __ATOMIC_ACQ_REL) == 0 && !n->keep && n->value != NULL) {
+        bigint_free(n->value);
+        n->value = NULL;
+    }
+}
+
+_BIGINT_INLINE double _bigint_dag_now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+_BIGINT_INLINE void _bigint_dag_push(bigint_dag_tp dag, int thread, uint32_t node)
+{
+    // count it first, so nobody goes to sleep while it's on its way
+    __atomic_add_fetch(&dag->ready, 1, __ATOMIC_SEQ_CST);
+    struct _bigint_dag_deque *d = &dag->deques[thread];
+    pthread_mutex_lock(&d->lock);
+    d->nodes[d->bottom++] = node;
+    pthread_mutex_unlock(&d->lock);
+
+    if (__atomic_load_n(&dag->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&dag->mutex);
+        pthread_cond_signal(&dag->wake);
+        pthread_mutex_unlock(&dag->mutex);
+    }
+}
+
+_BIGINT_INLINE uint32_t _bigint_dag_pop(bigint_dag_tp dag, int thread)
+{
+    // our own newest node, or else the oldest one of another thread
+    for (int k = 0; k < dag->threads; ++k) {
+        struct _bigint_dag_deque *d = &dag->deques[(thread + k) % dag->threads];
+        uint32_t node = BIGINT_DAG_NONE;
+        pthread_mutex_lock(&d->lock);
+        if (d->bottom > d->top) {
+            node = k == 0 ? d->nodes[--d->bottom] : d->nodes[d->top++];
+            if (d->bottom == d->top) d->bottom = d->top = 0;
+        }
+        pthread_mutex_unlock(&d->lock);
+        if (node != BIGINT_DAG_NONE) {
+            __atomic_sub_fetch(&dag->ready, 1, __ATOMIC_SEQ_CST);
+            return node;
+        }
+    }
+    return BIGINT_DAG_NONE;
+}
+
+_BIGINT_INLINE void _bigint_dag_run(bigint_dag_tp dag, int thread, uint32_t i)
+{
+    struct _bigint_dag_node *node = &dag->nodes[i];
+    int binary = node->b != BIGINT_DAG_NONE;
+    bigint_tp a = dag->nodes[node->a].value;
+    bigint_tp b = binary ? dag->nodes[node->b].value : NULL;
+    bigint_tp r = NULL;
+    // operands whose value went into the result
+    int used_a = 0, used_b = 0;
+    node->start = _bigint_dag_now();
+
+    if (a != NULL && (b != NULL || !binary)) {
+        int own_a = _bigint_dag_owned(dag, node->a);
+        int own_b = binary && _bigint_dag_owned(dag, node->b);
+        switch (node->op) {
+        case BIGINT_DAG_ADD:
+            if (own_a) r = bigint_add_inplace(a, b), used_a = 1;
+            else if (own_b) r = bigint_add_inplace(b, a), used_b = 1;
+            else r = bigint_add(a, b);
+            break;
+        case BIGINT_DAG_SUB:
+            if (own_a) r = bigint_sub_inplace(a, b), used_a = 1;
+            else if (own_b) r = bigint_rsub_inplace(b, a), used_b = 1;
+            else r = bigint_sub(a, b);
+            break;
+        case BIGINT_DAG_MUL:
+            r = bigint_mul(a, b);
+            break;
+        case BIGINT_DAG_DIV:
+            r = bigint_div(a, b);
+            break;
+        case BIGINT_DAG_SQRT:
+            if (bigint_sgn(a) >= 0) {
+                int inexact;
+                r = _bigfloat_sqrtrem_mag(a, &inexact);
+            }
+            break;
+        case BIGINT_DAG_SHIFT:
+            r = bigint_shift(own_a ? a : bigint_dup(a), node->shift);
+            used_a = own_a;
+            break;
+        }
+    }
+    if (r == NULL) __atomic_store_n(&dag->failed, 1, __ATOMIC_RELAXED);
+    node->value = r;
+    node->digits = r == NULL ? 0 : r->digits;
+    node->thread = thread;
+    node->seconds = _bigint_dag_now() - node->start;
+    node->start -= dag->t0;
+
+    if (used_a) dag->nodes[node->a].value = NULL;
+    else _bigint_dag_release(dag, node->a);
+    if (used_b) dag->nodes[node->b].value = NULL;
+    else if (binary) _bigint_dag_release(dag, node->b);
+
+    // the users of this node might be ready now
+    for (uint32_t k = dag->users_start[i]; k < dag->users_start[i+1]; ++k) {
+        uint32_t u = dag->users[k];
+        if (__atomic_sub_fetch(&dag->nodes[u].pending, 1, __ATOMIC_ACQ_REL) == 0)
+            _bigint_dag_push(dag, thread, u);
+    }
+
+    if (__atomic_sub_fetch(&dag->remaining, 1, __ATOMIC_SEQ_CST) == 0) {
+        pthread_mutex_lock(&dag->mutex);
+        pthread_cond_broadcast(&dag->wake);
+        pthread_mutex_unlock(&dag->mutex);
+    }
+}
+
+_BIGINT_INLINE void *_bigint_dag_worker(void *arg)
+{
+    bigint_dag_tp dag = (bigint_dag_tp)arg;
+    int thread = __atomic_fetch_add(&dag->next_thread, 1, __ATOMIC_RELAXED);
+    for (;;) {
+        uint32_t i = _bigint_dag_pop(dag, thread);
+        if (i != BIGINT_DAG_NONE) {
+            _bigint_dag_run(dag, thread, i);
+            continue;
+        }
+        // nothing to do: wait for a push, or for the end
+        pthread_mutex_lock(&dag->mutex);
+        __atomic_add_fetch(&dag->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&dag->ready, __ATOMIC_SEQ_CST) == 0 &&
+               __atomic_load_n(&dag->remaining, __ATOMIC_SEQ_CST) > 0)
+            pthread_cond_wait(&dag->wake, &dag->mutex);
+        __atomic_sub_fetch(&dag->sleepers, 1, __ATOMIC_SEQ_CST);
+        int done = __atomic_load_n(&dag->remaining, __ATOMIC_SEQ_CST) == 0;
+        pthread_mutex_unlock(&dag->mutex);
+        if (done) break;
+    }
+    return NULL;
+}
+
+_BIGINT_INLINE int bigint_dag_eval(bigint_dag_tp dag, int threads)
+{
+    // Runs every operation, on up to the given number of threads (including
+    // the calling one). Independent nodes run in parallel; a value with a
+    // single use that isn't kept is updated in place where possible.
+    // Returns -1 if anything failed (division by zero, square root of a
+    // negative number, or a second evaluation), 0 otherwise.
+    if (dag->evaluated) return -1;
+    dag->evaluated = 1;
+    if (threads < 1) threads = 1;
+    uint32_t count = dag->count;
+
+    // who uses each node
+    dag->users_start = (uint32_t *)calloc(count + 1, sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; ++i)
+        dag->users_start[i+1] = dag->users_start[i] + dag->nodes[i].consumers;
+    dag->users = (uint32_t *)malloc((dag->users_start[count] + 1) * sizeof(uint32_t));
+    uint32_t *fill = (uint32_t *)malloc((count + 1) * sizeof(uint32_t));
+    memcpy(fill, dag->users_start, count * sizeof(uint32_t));
+    dag->remaining = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        struct _bigint_dag_node *node = &dag->nodes[i];
+        node->uses_left = node->consumers;
+        if (node->consumers == 0) node->keep = 1;
+        if (node->op == BIGINT_DAG_INPUT) continue;
+        dag->users[fill[node->a]++] = i;
+        node->pending = 1;
+        // the inputs are there already
+        if (dag->nodes[node->a].op == BIGINT_DAG_INPUT) node->pending--;
+        if (node->b != BIGINT_DAG_NONE) {
+            dag->users[fill[node->b]++] = i;
+            node->pending++;
+            if (dag->nodes[node->b].op == BIGINT_DAG_INPUT) node->pending--;
+        }
+        dag->remaining++;
+    }
+    free(fill);
+
+    dag->threads = threads;
+    dag->next_thread = 0;
+    dag->ready = 0;
+    dag->sleepers = 0;
+    dag->deques = (struct _bigint_dag_deque *)calloc(threads, sizeof(struct _bigint_dag_deque));
+    for (int t = 0; t < threads; ++t) {
+        dag->deques[t].nodes = (uint32_t *)malloc((count + 1) * sizeof(uint32_t));
+        pthread_mutex_init(&dag->deques[t].lock, NULL);
+    }
+    pthread_mutex_init(&dag->mutex, NULL);
+    pthread_cond_init(&dag->wake, NULL);
+    dag->t0 = _bigint_dag_now();
+
+    // deal out the nodes that can start straight away
+    int t = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (dag->nodes[i].op != BIGINT_DAG_INPUT && dag->nodes[i].pending == 0) {
+            _bigint_dag_push(dag, t, i);
+            t = (t + 1) % threads;
+        }
+    }
+
+    if (dag->remaining > 0) {
+        pthread_t *workers = NULL;
+        int started = 0;
+        if (threads > 1) {
+            workers = (pthread_t *)malloc((threads - 1) * sizeof(pthread_t));
+            // if we can't have all the threads, the others steal their work
+            while (started < threads - 1 &&
+                   pthread_create(&workers[started], NULL, _bigint_dag_worker, dag) == 0)
+                started++;
+        }
+        _bigint_dag_worker(dag);
+        for (int i = 0; i < started; ++i)
+            pthread_join(workers[i], NULL);
+        free(workers);
+    }
+
+    pthread_mutex_destroy(&dag->mutex);
+    pthread_cond_destroy(&dag->wake);
+    for (int i = 0; i < threads; ++i) {
+        free(dag->deques[i].nodes);
+        pthread_mutex_destroy(&dag->deques[i].lock);
+    }
+    free(dag->deques);
+    free(dag->users);
+    free(dag->users_start);
+    dag->deques = NULL;
+    dag->users = dag->users_start = NULL;
+    return dag->failed ? -1 : 0;
+}
+
+_BIGINT_INLINE bigint_tp bigint_dag_value(bigint_dag_tp dag, uint32_t node)
+{
+    // the result at node after evaluation, or NULL if it failed or wasn't kept
+    if (!dag->evaluated || node >= dag->count || dag->nodes[node].value == NULL) return NULL;
+    return bigint_dup(dag->nodes[node].value);
+}
+
+_BIGINT_INLINE void bigint_dag_profile(bigint_dag_tp dag, FILE *f)
+{
+    // one line per operation: which thread ran it, when it started and how
+    // long it took (both in milliseconds), and how many digits it produced
+    const char *names[] = { "input", "add", "sub", "mul", "div", "sqrt", "shift" };
+    if (!dag->evaluated) return;
+    fprintf(f, "node\top\ta\tb\tthread\tstart\ttime\tdigits\n");
+    for (uint32_t i = 0; i < dag->count; ++i) {
+        const struct _bigint_dag_node *node = &dag->nodes[i];
+        if (node->op == BIGINT_DAG_INPUT) continue;
+        fprintf(f, "%u\t%s\t%u\t", i, names[node->op], node->a);
+        if (node->b != BIGINT_DAG_NONE) fprintf(f, "%u\t", node->b);
+        else if (node->op == BIGINT_DAG_SHIFT) fprintf(f, "%d\t", node->shift);
+        else fprintf(f, "-\t");
+        fprintf(f, "%d\t%.3f\t%.3f\t%u\n", node->thread, node->start * 1e3, node->seconds * 1e3, node->digits);
+    }
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _BIGINT_DAG_IMPL_H_ */
@@ -66,8 +66,7 @@ int main()
                 if (a == NULL || b == NULL)
                     fputs("ERROR: too few items in the stack\n", stderr);
                 else {
-                    b = bigint_flipsign(b);
-                    a = bigint_add_inplace(a, b);
+                    a = bigint_sub_inplace(a, b);
                     bigint_free(b);
                     push(&st, a);
                 }
@@ -0,0 +1,102 @@
+/* bigint library - bigint_disk.h
+   Numbers bigger than memory, kept in memory-mapped files: function
+   declarations / public interface.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGINT_DISK_H_
+#define _BIGINT_DISK_H_
+
+#include "bigint.h"
+#include "bigdec.h"
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* This uses open(), mmap() and madvise(), so it needs POSIX (define
+   _DEFAULT_SOURCE before including anything when compiling with -std=c11),
+   and a compiler with 128-bit integers. */
+#ifndef __SIZEOF_INT128__
+# error "bigint_disk.h needs unsigned __int128"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* A bigint_disk is a non-negative number kept in a file, which is also its
+   binary format: 32-bit digits, least significant first, in the machine's
+   byte order, without a header. The whole file is mapped, so the digits are
+   in n->num; the kernel reads them in and writes them back as needed.
+
+   The functions that take a budget keep the memory they allocate below
+   that many bytes (not counting the mapped files, which can always be
+   paged out) and put their temporary files next to the result. */
+struct _bigint_disk {
+    uint64_t digits;
+    int fd;
+    char *path;             // NULL for temporary files, which are deleted
+    uint32_t *num;
+};
+typedef struct _bigint_disk * bigint_disk_tp;
+
+inline bigint_disk_tp bigint_disk_new(const char *path, uint64_t digits);
+inline bigint_disk_tp bigint_disk_open(const char *path);
+inline void bigint_disk_free(bigint_disk_tp n);
+
+inline bigint_disk_tp bigint_disk_from_bigint(const char *path, bigint_tp n);
+inline bigint_tp bigint_disk_to_bigint(bigint_disk_tp n);
+
+inline bigint_disk_tp bigint_disk_read(const char *path, FILE *f);
+inline int bigint_disk_write(bigint_disk_tp n, FILE *f);
+inline bigint_disk_tp bigint_disk_read_decimal(const char *path, FILE *f, size_t budget);
+inline int bigint_disk_write_decimal(bigint_disk_tp n, FILE *f, size_t budget);
+
+inline bigint_disk_tp bigint_disk_mul(const char *path, bigint_disk_tp a, bigint_disk_tp b, size_t budget);
+
+/* one of the NTT primes p < 2^62, with Montgomery constants for 2^64 */
+struct _bigint_disk_prime {
+    uint64_t p;
+    uint64_t pinv;          // -1/p mod 2^64
+    uint64_t r2;            // 2^128 mod p
+    uint64_t one;           // 2^64 mod p
+    uint64_t g;             // a primitive root
+};
+
+inline bigint_disk_tp _bigint_disk_map(int fd, const char *path, uint64_t digits);
+inline bigint_disk_tp _bigint_disk_scratch(const char *like, uint64_t digits);
+inline bigint_disk_tp _bigint_disk_from_limbs(const char *path, const char *like, const uint32_t *num, uint64_t digits);
+inline int _bigint_disk_resize(bigint_disk_tp n, uint64_t digits);
+inline int _bigint_disk_crop(bigint_disk_tp n);
+inline void _bigint_disk_release(const void *p, uint64_t bytes);
+inline int _bigint_disk_add_inplace(bigint_disk_tp n, const uint32_t *a, uint64_t an, uint32_t base);
+
+inline uint64_t _bigint_disk_mulmod(uint64_t a, uint64_t b, uint64_t p);
+inline uint64_t _bigint_disk_powmod(uint64_t a, uint64_t e, uint64_t p);
+inline void _bigint_disk_prime_init(struct _bigint_disk_prime *pr, uint64_t p, uint64_t g);
+inline uint64_t _bigint_disk_mont_mul(uint64_t a, uint64_t b, uint64_t p, uint64_t pinv);
+inline uint64_t _bigint_disk_mont_pow(uint64_t a, uint64_t e, const struct _bigint_disk_prime *pr);
+inline void _bigint_disk_roots(uint64_t *roots, uint64_t len, uint64_t w, const struct _bigint_disk_prime *pr);
+inline void _bigint_disk_ntt(uint64_t *x, uint64_t len, const uint64_t *roots, uint64_t p, uint64_t pinv);
+inline void _bigint_disk_transform(uint64_t *x, uint64_t n1, uint64_t n2, uint64_t w, int inverse,
+                                   uint64_t *buf, uint64_t buf_size, const uint64_t *roots1,
+                                   const uint64_t *roots2, const struct _bigint_disk_prime *pr);
+inline bigint_disk_tp _bigint_disk_residues(const char *like, const uint32_t *a, uint64_t an,
+                                            const uint32_t *b, uint64_t bn, uint64_t n1, uint64_t n2,
+                                            uint64_t *buf, uint64_t buf_size, uint64_t *tables,
+                                            const struct _bigint_disk_prime *pr);
+inline bigint_disk_tp _bigint_disk_mul(const char *path, const char *like, const uint32_t *a, uint64_t an,
+                                       const uint32_t *b, uint64_t bn, uint32_t base, size_t budget);
+inline bigint_disk_tp _bigint_disk_to_dec(const char *like, const uint32_t *num, uint64_t digits,
+                                          bigint_disk_tp *powers, bigdec_tp *mem_powers, size_t budget);
+inline bigint_disk_tp _bigint_disk_from_dec(const char *path, const char *like, const uint32_t *num,
+                                            uint64_t digits, bigint_disk_tp *powers,
+                                            bigint_tp *mem_powers, size_t budget);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#include "bigint_disk_impl.h"
+
+#endif /* _BIGINT_DISK_H_ */
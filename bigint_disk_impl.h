@@ -0,0 +1,711 @@
+/* bigint library - bigint_disk_impl.h
+   Numbers bigger than memory, kept in memory-mapped files: function
+   definitions (all inline).
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGINT_DISK_IMPL_H_
+#define _BIGINT_DISK_IMPL_H_
+
+#include "bigint_disk.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+_BIGINT_INLINE bigint_disk_tp _bigint_disk_map(int fd, const char *path, uint64_t digits)
+{
+    // makes the file digits long (new parts are zero) and maps all of it;
+    // closes fd on failure
+    if (digits == 0) digits = 1;
+    void *num = MAP_FAILED;
+    if (ftruncate(fd, digits * sizeof(uint32_t)) == 0)
+        num = mmap(NULL, digits * sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (num == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    bigint_disk_tp n = (bigint_disk_tp)malloc(sizeof(struct _bigint_disk));
+    n->digits = digits;
+    n->fd = fd;
+    n->num = (uint32_t *)num;
+    n->path = NULL;
+    if (path != NULL) {
+        size_t len = strlen(path) + 1;
+        n->path = (char *)malloc(len);
+        memcpy(n->path, path, len);
+    }
+    return n;
+}
+
+_BIGINT_INLINE bigint_disk_tp bigint_disk_new(const char *path, uint64_t digits)
+{
+    // a new file, which starts out as zero
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return NULL;
+    return _bigint_disk_map(fd, path, digits);
+}
+
+_BIGINT_INLINE bigint_disk_tp bigint_disk_open(const char *path)
+{
+    // an existing file; a partial digit at the end is padded with zeros
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    bigint_disk_tp n = _bigint_disk_map(fd, path, ((uint64_t)st.st_size + 3) / 4);
+    if (n != NULL && _bigint_disk_crop(n) != 0) {
+        bigint_disk_free(n);
+        return NULL;
+    }
+    return n;
+}
+
+_BIGINT_INLINE void bigint_disk_free(bigint_disk_tp n)
+{
+    // the file stays, unless it was a temporary one
+    munmap(n->num, n->digits * sizeof(uint32_t));
+    close(n->fd);
+    free(n->path);
+    free(n);
+}
+
+_BIGINT_INLINE bigint_disk_tp _bigint_disk_scratch(const char *like, uint64_t digits)
+{
+    // a temporary file next to like. It is deleted straight away, so it
+    // disappears when it's closed.
+    size_t len = strlen(like);
+    char *name = (char *)malloc(len + 8);
+    memcpy(name, like, len);
+    memcpy(name + len, ".XXXXXX", 8);
+    int fd = mkstemp(name);
+    if (fd >= 0) unlink(name);
+    free(name);
+    if (fd < 0) return NULL;
+    return _bigint_disk_map(fd, NULL, digits);
+}
+
+_BIGINT_INLINE bigint_disk_tp _bigint_disk_from_limbs(const char *path, const char *like,
+                                                       const uint32_t *num, uint64_t digits)
+{
+    // a copy of num[0..digits) at path, or in a temporary file if path is NULL
+    bigint_disk_tp n = path != NULL ? bigint_disk_new(path, digits) : _bigint_disk_scratch(like, digits);
+    if (n == NULL) return NULL;
+    memcpy(n->num, num, digits * sizeof(uint32_t));
+    if (_bigint_disk_crop(n) != 0) {
+        bigint_disk_free(n);
+        return NULL;
+    }
+    return n;
+}
+
+_BIGINT_INLINE int _bigint_disk_resize(bigint_disk_tp n, uint64_t digits)
+{
+    // grows (with zeros) or shrinks the file and maps it again. On failure,
+    // n is left as it was.
+    if (digits == 0) digits = 1;
+    if (digits == n->digits) return 0;
+    if (ftruncate(n->fd, digits * sizeof(uint32_t)) != 0) return -1;
+    void *num = mmap(NULL, digits * sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED, n->fd, 0);
+    if (num == MAP_FAILED) {
+        if (ftruncate(n->fd, n->digits * sizeof(uint32_t)) != 0) {}
+        return -1;
+    }
+    munmap(n->num, n->digits * sizeof(uint32_t));
+    n->num = (uint32_t *)num;
+    n->digits = digits;
+    return 0;
+}
+
+_BIGINT_INLINE int _bigint_disk_crop(bigint_disk_tp n)
+{
+    uint64_t digits = n->digits;
+    while (digits > 1 && n->num[digits-1] == 0)
+        digits--;
+    return _bigint_disk_resize(n, digits);
+}
+
+_BIGINT_INLINE void _bigint_disk_release(const void *p, uint64_t bytes)
+{
+    // Drops the pages of p[0..bytes) we're done with from memory; they are
+    // written back first if they're dirty, and read in again if they're
+    // needed after all. Only pages entirely inside the range go.
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)p + page - 1) / page * page;
+    uintptr_t end = ((uintptr_t)p + bytes) / page * page;
+    if (end > start) madvise((void *)start, end - start, MADV_DONTNEED);
+}
+
+_BIGINT_INLINE int _bigint_disk_add_inplace(bigint_disk_tp n, const uint32_t *a, uint64_t an, uint32_t base)
+{
+    // n += a[0..an) in base 2^32 (base == 0) or in base 10^9
+    if (_bigint_disk_resize(n, (n->digits > an ? n->digits : an) + 1) != 0) return -1;
+    uint64_t carry = 0;
+    for (uint64_t i = 0; i < n->digits; ++i) {
+        if (i >= an && carry == 0) break;
+        uint64_t val = (uint64_t)n->num[i] + (i < an ? a[i] : 0) + carry;
+        if (base == 0) {
+            n->num[i] = (uint32_t)val;
+            carry = val >> BIGINT_WIDTH_BITS;
+        } else {
+            carry = val >= base;
+            n->num[i] = (uint32_t)(carry ? val - base : val);
+        }
+    }
+    return _bigint_disk_crop(n);
+}
+
+_BIGINT_INLINE bigint_disk_tp bigint_disk_from_bigint(const char *path, bigint_tp n)
+{
+    // NULL if n is negative
+    if (bigint_sgn(n) < 0) return NULL;
+    return _bigint_disk_from_limbs(path, NULL, n->num, _bigint_mag_digits(n));
+}
+
+_BIGINT_INLINE bigint_tp bigint_disk_to_bigint(bigint_disk_tp n)
+{
+    // NULL if n has too many digits for a bigint
+    if (n->digits >= UINT32_MAX) return NULL;
+    bigint_tp res = _bigint_new((uint32_t)n->digits + 1);
+    memcpy(res->num, n->num, n->digits * sizeof(uint32_t));
+    res->num[n->digits] = 0;
+    _bigint_crop(res);
+    return res;
+}
+
+_BIGINT_INLINE bigint_disk_tp bigint_disk_read(const char *path, FILE *f)
+{
+    // copies the binary format from f to a new file at path
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return NULL;
+    const size_t buf_size = 1 << 16;
+    char *buf = (char *)malloc(buf_size);
+    uint64_t bytes = 0;
+    size_t got;
+    int ok = 1;
+    while (ok && (got = fread(buf, 1, buf_size, f)) > 0) {
+        for (size_t done = 0; ok && done < got; ) {
+            ssize_t written = write(fd, buf + done, got - done);
+            ok = written > 0;
+            if (ok) done += written;
+        }
+        bytes += got;
+    }
+    free(buf);
+    if (!ok || ferror(f)) {
+        close(fd);
+        return NULL;
+    }
+
+    bigint_disk_tp n = _bigint_disk_map(fd, path, (bytes + 3) / 4);
+    if (n != NULL && _bigint_disk_crop(n) != 0) {
+        bigint_disk_free(n);
+        return NULL;
+    }
+    return n;
+}
+
+_BIGINT_INLINE int bigint_disk_write(bigint_disk_tp n, FILE *f)
+{
+    // the binary format, in pieces that are dropped from memory once written
+    const uint64_t piece = 1 << 14;
+    for (uint64_t i = 0; i < n->digits; i += piece) {
+        size_t len = n->digits - i < piece ? n->digits - i : piece;
+        if (fwrite(n->num + i, sizeof(uint32_t), len, f) != len) return -1;
+        _bigint_disk_release(n->num + i, len * sizeof(uint32_t));
+    }
+    return 0;
+}
+
+_BIGINT_INLINE uint64_t _bigint_disk_mulmod(uint64_t a, uint64_t b, uint64_t p)
+{
+    return (uint64_t)((_bigint_uint128_t)a * b % p);
+}
+
+_BIGINT_INLINE uint64_t _bigint_disk_powmod(uint64_t a, uint64_t e, uint64_t p)
+{
+    uint64_t res = 1;
+    for (; e != 0; e >>= 1) {
+        if (e & 1) res = _bigint_disk_mulmod(res, a, p);
+        a = _bigint_disk_mulmod(a, a, p);
+    }
+    return res;
+}
+
+_BIGINT_INLINE void _bigint_disk_prime_init(struct _bigint_disk_prime *pr, uint64_t p, uint64_t g)
+{
+    // 1/p mod 2^64 by Newton's method: p is its own inverse mod 8, and every
+    // step doubles the number of correct bits
+    uint64_t inv = p;
+    for (int i = 0; i < 5; ++i)
+        inv *= 2 - p * inv;
+    pr->p = p;
+    pr->pinv = 0 - inv;
+    pr->one = (0 - p) % p;
+    pr->r2 = _bigint_disk_mulmod(pr->one, pr->one, p);
+    pr->g = g;
+}
+
+_BIGINT_INLINE uint64_t _bigint_disk_mont_mul(uint64_t a, uint64_t b, uint64_t p, uint64_t pinv)
+{
+    // a b / 2^64 mod p for p < 2^62: nothing here overflows 128 bits
+    _bigint_uint128_t t = (_bigint_uint128_t)a * b;
+    uint64_t m = (uint64_t)t * pinv;
+    uint64_t u = (uint64_t)((t + (_bigint_uint128_t)m * p) >> 64);
+    return u >= p ? u - p : u;
+}
+
+_BIGINT_INLINE uint64_t _bigint_disk_mont_pow(uint64_t a, uint64_t e, const struct _bigint_disk_prime *pr)
+{
+    // in Montgomery form, like a
+    uint64_t res = pr->one;
+    for (; e != 0; e >>= 1) {
+        if (e & 1) res = _bigint_disk_mont_mul(res, a, pr->p, pr->pinv);
+        a = _bigint_disk_mont_mul(a, a, pr->p, pr->pinv);
+    }
+    return res;
+}
+
+_BIGINT_INLINE void _bigint_disk_roots(uint64_t *roots, uint64_t len, uint64_t w,
+                                       const struct _bigint_disk_prime *pr)
+{
+    // roots[i] = w^i for i < len / 2
+    for (uint64_t i = 0; i < len / 2; ++i)
+        roots[i] = i == 0 ? pr->one : _bigint_disk_mont_mul(roots[i-1], w, pr->p, pr->pinv);
+}
+
+_BIGINT_INLINE void _bigint_disk_ntt(uint64_t *x, uint64_t len, const uint64_t *roots, uint64_t p, uint64_t pinv)
+{
+    // In-place transform of x[0..len) in natural order, len a power of two.
+    // roots are the powers of a primitive len-th root of unity (the inverse
+    // one for the inverse transform, which isn't divided by len).
+    for (uint64_t i = 1, j = 0; i < len; ++i) {
+        uint64_t bit = len >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            uint64_t t = x[i];
+            x[i] = x[j];
+            x[j] = t;
+        }
+    }
+    for (uint64_t half = 1; half < len; half *= 2) {
+        uint64_t step = len / (2 * half);
+        for (uint64_t i = 0; i < len; i += 2 * half)
+            for (uint64_t j = 0; j < half; ++j) {
+                uint64_t u = x[i+j];
+                uint64_t v = _bigint_disk_mont_mul(x[i+j+half], roots[j*step], p, pinv);
+                x[i+j] = u + v >= p ? u + v - p : u + v;
+                x[i+j+half] = u >= v ? u - v : u + p - v;
+            }
+    }
+}
+
+_BIGINT_INLINE void _bigint_disk_transform(uint64_t *x, uint64_t n1, uint64_t n2, uint64_t w, int inverse,
+                                           uint64_t *buf, uint64_t buf_size, const uint64_t *roots1,
+                                           const uint64_t *roots2, const struct _bigint_disk_prime *pr)
+{
+    // The transform of x[0..n1 n2) by Bailey's four-step algorithm: x is an
+    // n1 x n2 matrix in row-major order; transform the columns, multiply
+    // element (k1, c) by w^(k1 c), transform the rows. Element k1 + n1 k2
+    // of the transform ends up at row k1, column k2, which doesn't matter
+    // for a convolution as long as the inverse transform (the same steps
+    // backwards, with w^-1) undoes it.
+    //
+    // Columns are copied to buf a panel at a time, as wide as buf allows,
+    // reading a contiguous piece of every row. Rows are transformed in place.
+    uint64_t p = pr->p, pinv = pr->pinv;
+    if (inverse) {
+        for (uint64_t r = 0; r < n1; ++r) {
+            _bigint_disk_ntt(x + r * n2, n2, roots2, p, pinv);
+            _bigint_disk_release(x + r * n2, n2 * sizeof(uint64_t));
+        }
+    }
+
+    if (n1 > 1) {
+        uint64_t width = buf_size / n1 < n2 ? buf_size / n1 : n2;
+        uint64_t wc = pr->one;      // w^c
+        for (uint64_t c0 = 0; c0 < n2; c0 += width) {
+            for (uint64_t r = 0; r < n1; ++r)
+                for (uint64_t c = 0; c < width; ++c)
+                    buf[c * n1 + r] = x[r * n2 + c0 + c];
+            for (uint64_t c = 0; c < width; ++c) {
+                uint64_t *col = buf + c * n1;
+                if (!inverse) _bigint_disk_ntt(col, n1, roots1, p, pinv);
+                uint64_t t = pr->one;
+                for (uint64_t k = 0; k < n1; ++k) {
+                    col[k] = _bigint_disk_mont_mul(col[k], t, p, pinv);
+                    t = _bigint_disk_mont_mul(t, wc, p, pinv);
+                }
+                if (inverse) _bigint_disk_ntt(col, n1, roots1, p, pinv);
+                wc = _bigint_disk_mont_mul(wc, w, p, pinv);
+            }
+            for (uint64_t r = 0; r < n1; ++r) {
+                for (uint64_t c = 0; c < width; ++c)
+                    x[r * n2 + c0 + c] = buf[c * n1 + r];
+                _bigint_disk_release(x + r * n2 + c0, width * sizeof(uint64_t));
+            }
+        }
+    }
+
+    if (!inverse) {
+        for (uint64_t r = 0; r < n1; ++r) {
+            _bigint_disk_ntt(x + r * n2, n2, roots2, p, pinv);
+            _bigint_disk_release(x + r * n2, n2 * sizeof(uint64_t));
+        }
+    }
+}
+
+_BIGINT_INLINE bigint_disk_tp _bigint_disk_residues(const char *like, const uint32_t *a, uint64_t an,
+                                                    const uint32_t *b, uint64_t bn, uint64_t n1, uint64_t n2,
+                                                    uint64_t *buf, uint64_t buf_size, uint64_t *tables,
+                                                    const struct _bigint_disk_prime *pr)
+{
+    // The cyclic convolution of a and b mod p, of length n1 n2, in a
+    // temporary file of 64-bit words. The result is multiplied by n1 n2 and
+    // in Montgomery form. tables has room for n1 + n2 roots.
+    uint64_t p = pr->p, pinv = pr->pinv;
+    uint64_t len = n1 * n2;
+    uint64_t w = _bigint_disk_mont_pow(_bigint_disk_mont_mul(pr->g, pr->r2, p, pinv), (p - 1) / len, pr);
+    uint64_t w_inv = _bigint_disk_mont_pow(w, len - 1, pr);
+    uint64_t *roots1 = tables, *roots1_inv = roots1 + n1 / 2;
+    uint64_t *roots2 = roots1_inv + n1 / 2, *roots2_inv = roots2 + n2 / 2;
+    _bigint_disk_roots(roots1, n1, _bigint_disk_mont_pow(w, n2, pr), pr);
+    _bigint_disk_roots(roots1_inv, n1, _bigint_disk_mont_pow(w_inv, n2, pr), pr);
+    _bigint_disk_roots(roots2, n2, _bigint_disk_mont_pow(w, n1, pr), pr);
+    _bigint_disk_roots(roots2_inv, n2, _bigint_disk_mont_pow(w_inv, n1, pr), pr);
+
+    // transform a, and b unless we're squaring
+    bigint_disk_tp t[2] = { NULL, NULL };
+    for (int i = 0; i < 2 && !(i == 1 && a == b && an == bn); ++i) {
+        const uint32_t *src = i == 0 ? a : b;
+        uint64_t n = i == 0 ? an : bn;
+        t[i] = _bigint_disk_scratch(like, 2 * len);
+        if (t[i] == NULL) {
+            if (i == 1) bigint_disk_free(t[0]);
+            return NULL;
+        }
+        uint64_t *x = (uint64_t *)t[i]->num;
+        for (uint64_t j = 0; j < n; ++j)
+            x[j] = _bigint_disk_mont_mul(src[j], pr->r2, p, pinv);
+        _bigint_disk_transform(x, n1, n2, w, 0, buf, buf_size, roots1, roots2, pr);
+    }
+
+    uint64_t *x = (uint64_t *)t[0]->num;
+    uint64_t *y = t[1] != NULL ? (uint64_t *)t[1]->num : x;
+    for (uint64_t j0 = 0; j0 < len; j0 += buf_size) {
+        uint64_t j1 = len - j0 < buf_size ? len : j0 + buf_size;
+        for (uint64_t j = j0; j < j1; ++j)
+            x[j] = _bigint_disk_mont_mul(x[j], y[j], p, pinv);
+        _bigint_disk_release(x + j0, (j1 - j0) * sizeof(uint64_t));
+    }
+    if (t[1] != NULL) bigint_disk_free(t[1]);
+
+    _bigint_disk_transform(x, n1, n2, w_inv, 1, buf, buf_size, roots1_inv, roots2_inv, pr);
+    return t[0];
+}
+
+_BIGINT_INLINE bigint_disk_tp _bigint_disk_mul(const char *path, const char *like, const uint32_t *a, uint64_t an,
+                                               const uint32_t *b, uint64_t bn, uint32_t base, size_t budget)
+{
+    // a b in base 2^32 (base == 0) or base 10^9, at path or in a temporary
+    // file next to like if path is NULL. Products that fit the budget are
+    // done in memory. The others are done modulo three primes p < 2^62 by
+    // NTT and put together by the Chinese remainder theorem: with up to 2^40
+    // coefficients below 2^104, that is exact.
+    if (an < bn) {
+        const uint32_t *t = a;
+        a = b;
+        b = t;
+        uint64_t tn = an;
+        an = bn;
+        bn = tn;
+    }
+    bigint_disk_tp r = path != NULL ? bigint_disk_new(path, an + bn) : _bigint_disk_scratch(like, an + bn);
+    if (r == NULL) return NULL;
+
+    if ((an + bn) * 16 <= budget && an + bn < UINT32_MAX / 2) {
+        if (base != 0)
+            _bigdec_mul_mag(r->num, a, (uint32_t)an, b, (uint32_t)bn);
+        else if (a == b && an == bn)
+            _bigint_sqr_mag(r->num, a, (uint32_t)an);
+        else
+            _bigint_mul_mag(r->num, a, (uint32_t)an, b, (uint32_t)bn);
+        if (_bigint_disk_crop(r) == 0) return r;
+        bigint_disk_free(r);
+        return NULL;
+    }
+
+    // at most an eighth of the budget for the panel buffer and a quarter for
+    // the n1 + n2 roots, which leaves room for the mapped pages in use
+    uint64_t buf_size = 1, len = 1;
+    while (buf_size * 2 * 32 <= budget)
+        buf_size *= 2;
+    while (len < an + bn)
+        len *= 2;
+    uint64_t n2 = len < buf_size ? len : buf_size, n1 = len / n2;
+    if (n1 > buf_size || len > (1ull << 40)) {
+        bigint_disk_free(r);
+        return NULL;
+    }
+
+    const uint64_t primes[3] = { 0x3fff840000000001ull, 0x3fffbe0000000001ull, 0x3fffc00000000001ull };
+    const uint64_t generators[3] = { 19, 3, 11 };
+    struct _bigint_disk_prime pr[3];
+    bigint_disk_tp res[3] = { NULL, NULL, NULL };
+    uint64_t *buf = (uint64_t *)malloc(buf_size * sizeof(uint64_t));
+    uint64_t *tables = (uint64_t *)malloc((n1 + n2) * sizeof(uint64_t));
+    int ok = 1;
+    for (int i = 0; ok && i < 3; ++i) {
+        _bigint_disk_prime_init(&pr[i], primes[i], generators[i]);
+        res[i] = _bigint_disk_residues(like, a, an, b, bn, n1, n2, buf, buf_size, tables, &pr[i]);
+        ok = res[i] != NULL;
+    }
+
+    if (ok) {
+        // Garner: c = r0 + p0 (t1 + p1 t2), which comes out right in 128-bit
+        // arithmetic. Constants that multiply are in Montgomery form.
+        uint64_t p0 = pr[0].p, p1 = pr[1].p, p2 = pr[2].p;
+        uint64_t len_inv[3];
+        for (int i = 0; i < 3; ++i)
+            len_inv[i] = _bigint_disk_powmod(len, pr[i].p - 2, pr[i].p);
+        uint64_t c1 = _bigint_disk_mulmod(_bigint_disk_powmod(p0, p1 - 2, p1), pr[1].one, p1);
+        uint64_t p0_mod2 = _bigint_disk_mulmod(p0, pr[2].one, p2);
+        uint64_t c2 = _bigint_disk_mulmod(_bigint_disk_powmod(_bigint_disk_mulmod(p0, p1, p2), p2 - 2, p2),
+                                          pr[2].one, p2);
+        _bigint_uint128_t p01 = (_bigint_uint128_t)p0 * p1, acc = 0;
+        const uint64_t *x0 = (uint64_t *)res[0]->num, *x1 = (uint64_t *)res[1]->num,
+                       *x2 = (uint64_t *)res[2]->num;
+        for (uint64_t k0 = 0; k0 < an + bn; k0 += buf_size) {
+            uint64_t k1 = an + bn - k0 < buf_size ? an + bn : k0 + buf_size;
+            for (uint64_t k = k0; k < k1; ++k) {
+                uint64_t r0 = _bigint_disk_mont_mul(x0[k], len_inv[0], p0, pr[0].pinv);
+                uint64_t r1 = _bigint_disk_mont_mul(x1[k], len_inv[1], p1, pr[1].pinv);
+                uint64_t r2 = _bigint_disk_mont_mul(x2[k], len_inv[2], p2, pr[2].pinv);
+                uint64_t t1 = _bigint_disk_mont_mul(r1 >= r0 ? r1 - r0 : r1 + p1 - r0, c1, p1, pr[1].pinv);
+                uint64_t s = r2 >= r0 ? r2 - r0 : r2 + p2 - r0;
+                uint64_t u = _bigint_disk_mont_mul(t1, p0_mod2, p2, pr[2].pinv);
+                uint64_t t2 = _bigint_disk_mont_mul(s >= u ? s - u : s + p2 - u, c2, p2, pr[2].pinv);
+                acc += r0 + (_bigint_uint128_t)p0 * t1 + p01 * t2;
+                if (base == 0) {
+                    r->num[k] = (uint32_t)acc;
+                    acc >>= BIGINT_WIDTH_BITS;
+                } else {
+                    r->num[k] = (uint32_t)(acc % base);
+                    acc /= base;
+                }
+            }
+            _bigint_disk_release(x0 + k0, (k1 - k0) * sizeof(uint64_t));
+            _bigint_disk_release(x1 + k0, (k1 - k0) * sizeof(uint64_t));
+            _bigint_disk_release(x2 + k0, (k1 - k0) * sizeof(uint64_t));
+            _bigint_disk_release(r->num + k0, (k1 - k0) * sizeof(uint32_t));
+        }
+    }
+
+    for (int i = 0; i < 3; ++i)
+        if (res[i] != NULL) bigint_disk_free(res[i]);
+    free(buf);
+    free(tables);
+    if (ok) ok = _bigint_disk_crop(r) == 0;
+    if (!ok) {
+        bigint_disk_free(r);
+        return NULL;
+    }
+    return r;
+}
+
+_BIGINT_INLINE bigint_disk_tp bigint_disk_mul(const char *path, bigint_disk_tp a, bigint_disk_tp b, size_t budget)
+{
+    // path mustn't be the file of a or b. NULL if the budget is too small
+    // (the product may have at most (budget / 32)^2 digits).
+    return _bigint_disk_mul(path, path, a->num, a->digits, b->num, b->digits, 0, budget);
+}
+
+_BIGINT_INLINE bigint_disk_tp _bigint_disk_to_dec(const char *like, const uint32_t *num, uint64_t digits,
+                                                  bigint_disk_tp *powers, bigdec_tp *mem_powers, size_t budget)
+{
+    // num[0..digits) in base 10^9, in a temporary file: split into
+    // hi 2^(32 k) + lo as in _bigdec_from_bigint_mag, with powers[j] =
+    // 2^(32 2^j) in decimal. Pieces that fit the budget are done in memory.
+    if (digits * 32 <= budget) {
+        bigdec_tp d = _bigdec_from_bigint_mag(num, (uint32_t)digits, mem_powers);
+        bigint_disk_tp res = _bigint_disk_from_limbs(NULL, like, d->num, d->digits);
+        bigdec_free(d);
+        return res;
+    }
+
+    int j = 0;
+    while ((2ull << j) < digits) ++j;
+    uint64_t k = 1ull << j;
+    for (int i = 0; i <= j; ++i) {
+        if (powers[i] != NULL) continue;
+        if (i == 0) {
+            uint32_t p0[2] = { (1ull << BIGINT_WIDTH_BITS) % BIGDEC_BASE, (1ull << BIGINT_WIDTH_BITS) / BIGDEC_BASE };
+            powers[0] = _bigint_disk_from_limbs(NULL, like, p0, 2);
+        } else {
+            powers[i] = _bigint_disk_mul(NULL, like, powers[i-1]->num, powers[i-1]->digits,
+                                         powers[i-1]->num, powers[i-1]->digits, BIGDEC_BASE, budget);
+        }
+        if (powers[i] == NULL) return NULL;
+    }
+
+    bigint_disk_tp hi = _bigint_disk_to_dec(like, num + k, digits - k, powers, mem_powers, budget);
+    bigint_disk_tp lo = hi != NULL ? _bigint_disk_to_dec(like, num, k, powers, mem_powers, budget) : NULL;
+    bigint_disk_tp res = NULL;
+    if (lo != NULL)
+        res = _bigint_disk_mul(NULL, like, hi->num, hi->digits, powers[j]->num, powers[j]->digits,
+                               BIGDEC_BASE, budget);
+    if (res != NULL && _bigint_disk_add_inplace(res, lo->num, lo->digits, BIGDEC_BASE) != 0) {
+        bigint_disk_free(res);
+        res = NULL;
+    }
+    if (hi != NULL) bigint_disk_free(hi);
+    if (lo != NULL) bigint_disk_free(lo);
+    return res;
+}
+
+_BIGINT_INLINE bigint_disk_tp _bigint_disk_from_dec(const char *path, const char *like, const uint32_t *num,
+                                                    uint64_t digits, bigint_disk_tp *powers,
+                                                    bigint_tp *mem_powers, size_t budget)
+{
+    // The other way around, as in _bigdec_to_bigint_mag: base 10^9 digits
+    // to a number at path (or a temporary file), with powers[j] =
+    // 10^(9 2^j) on disk.
+    if (digits * 32 <= budget) {
+        bigint_tp n = _bigdec_to_bigint_mag(num, (uint32_t)digits, mem_powers);
+        bigint_disk_tp res = _bigint_disk_from_limbs(path, like, n->num, _bigint_mag_digits(n));
+        bigint_free(n);
+        return res;
+    }
+
+    int j = 0;
+    while ((2ull << j) < digits) ++j;
+    uint64_t k = 1ull << j;
+    for (int i = 0; i <= j; ++i) {
+        if (powers[i] != NULL) continue;
+        if (i == 0) {
+            uint32_t p0 = BIGDEC_BASE;
+            powers[0] = _bigint_disk_from_limbs(NULL, like, &p0, 1);
+        } else {
+            powers[i] = _bigint_disk_mul(NULL, like, powers[i-1]->num, powers[i-1]->digits,
+                                         powers[i-1]->num, powers[i-1]->digits, 0, budget);
+        }
+        if (powers[i] == NULL) return NULL;
+    }
+
+    bigint_disk_tp hi = _bigint_disk_from_dec(NULL, like, num + k, digits - k, powers, mem_powers, budget);
+    bigint_disk_tp lo = hi != NULL ? _bigint_disk_from_dec(NULL, like, num, k, powers, mem_powers, budget) : NULL;
+    bigint_disk_tp res = NULL;
+    if (lo != NULL)
+        res = _bigint_disk_mul(path, like, hi->num, hi->digits, powers[j]->num, powers[j]->digits, 0, budget);
+    if (res != NULL && _bigint_disk_add_inplace(res, lo->num, lo->digits, 0) != 0) {
+        bigint_disk_free(res);
+        res = NULL;
+    }
+    if (hi != NULL) bigint_disk_free(hi);
+    if (lo != NULL) bigint_disk_free(lo);
+    return res;
+}
+
+_BIGINT_INLINE bigint_disk_tp bigint_disk_read_decimal(const char *path, FILE *f, size_t budget)
+{
+    // Reads the digits from f (with any white space around them) to a
+    // temporary file, since we need to know how many there are, then turns
+    // them into base 10^9 digits, and those into binary. NULL if there's
+    // anything else in f, or no digits at all.
+    bigint_disk_tp text = _bigint_disk_scratch(path, 1);
+    if (text == NULL) return NULL;
+    char buf[4096];
+    size_t used = 0;
+    uint64_t len = 0;
+    int c, state = 0, ok = 1;  // before, in, after the digits
+    while (ok && (c = getc(f)) != EOF) {
+        if (c >= '0' && c <= '9') {
+            ok = state < 2;
+            state = 1;
+            buf[used++] = (char)c;
+        } else {
+            ok = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+            if (state == 1) state = 2;
+        }
+        if (used == sizeof(buf)) {
+            ok = ok && write(text->fd, buf, used) == (ssize_t)used;
+            len += used;
+            used = 0;
+        }
+    }
+    if (ok && used > 0) {
+        ok = write(text->fd, buf, used) == (ssize_t)used;
+        len += used;
+    }
+    ok = ok && !ferror(f) && len > 0 && _bigint_disk_resize(text, (len + 3) / 4) == 0;
+
+    // nine characters to a digit, starting from the end
+    bigint_disk_tp dec = ok ? _bigint_disk_scratch(path, (len + BIGDEC_BASE_DIGITS - 1) / BIGDEC_BASE_DIGITS) : NULL;
+    if (dec != NULL) {
+        const char *start = (const char *)text->num, *end = start + len;
+        for (uint64_t i = 0; i < dec->digits; ++i) {
+            const char *from = end - start > BIGDEC_BASE_DIGITS ? end - BIGDEC_BASE_DIGITS : start;
+            uint32_t val = 0;
+            for (const char *p = from; p < end; ++p)
+                val = val * 10 + (*p - '0');
+            dec->num[i] = val;
+            end = from;
+        }
+        if (_bigint_disk_crop(dec) != 0) {
+            bigint_disk_free(dec);
+            dec = NULL;
+        }
+    }
+    bigint_disk_free(text);
+    if (dec == NULL) return NULL;
+
+    bigint_disk_tp powers[64] = {0};
+    bigint_tp mem_powers[32] = {0};
+    bigint_disk_tp res = _bigint_disk_from_dec(path, path, dec->num, dec->digits, powers, mem_powers, budget);
+    for (int j = 0; j < 64; ++j)
+        if (powers[j] != NULL) bigint_disk_free(powers[j]);
+    for (int j = 0; j < 32; ++j)
+        if (mem_powers[j] != NULL) bigint_free(mem_powers[j]);
+    bigint_disk_free(dec);
+    return res;
+}
+
+_BIGINT_INLINE int bigint_disk_write_decimal(bigint_disk_tp n, FILE *f, size_t budget)
+{
+    // converts n to base 10^9 in a temporary file, and prints that from the top
+    bigint_disk_tp powers[64] = {0};
+    bigdec_tp mem_powers[32] = {0};
+    bigint_disk_tp dec = _bigint_disk_to_dec(n->path, n->num, n->digits, powers, mem_powers, budget);
+    for (int j = 0; j < 64; ++j)
+        if (powers[j] != NULL) bigint_disk_free(powers[j]);
+    for (int j = 0; j < 32; ++j)
+        if (mem_powers[j] != NULL) bigdec_free(mem_powers[j]);
+    if (dec == NULL) return -1;
+
+    uint64_t i = dec->digits - 1;
+    int ok = fprintf(f, "%" PRIu32, dec->num[i]) >= 0;
+    while (ok && i-- > 0)
+        ok = fprintf(f, "%09" PRIu32, dec->num[i]) >= 0;
+    bigint_disk_free(dec);
+    return ok ? 0 : -1;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _BIGINT_DISK_IMPL_H_ */
@@ -0,0 +1,376 @@
+/* bigint library - bigint_fixed.hpp
+   C++ fixed-width integers: bigint_fixed<Bits> lives on the stack and can be
+   used in constant expressions.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGINT_FIXED_HPP_
+#define _BIGINT_FIXED_HPP_
+
+#include "bigint.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+/* Two's complement integer of Bits bits, stored in 32-bit digits in
+   little-endian order - the same layout as struct _bigint, but with a
+   fixed number of digits. Like the built-in integer types, arithmetic wraps
+   around on overflow. Division rounds to zero.
+
+   Every loop runs over a compile-time number of digits, so the compiler can
+   unroll them completely, and nothing ever allocates (except the
+   conversion to bigint_tp). */
+template <unsigned Bits>
+class bigint_fixed
+{
+    static_assert(Bits > 0 && Bits % BIGINT_WIDTH_BITS == 0,
+                  "bigint_fixed needs a whole number of 32-bit digits");
+
+public:
+    static constexpr unsigned digits = Bits / BIGINT_WIDTH_BITS;
+
+    uint32_t num[digits];
+
+    constexpr bigint_fixed() : num{} {}
+
+    constexpr bigint_fixed(int64_t i) : num{}
+    {
+        uint32_t ext = i < 0 ? (uint32_t)-1 : 0;
+        num[0] = (uint64_t)i & BIGINT_LOW_MASK;
+        for (unsigned k = 1; k < digits; ++k)
+            num[k] = k == 1 ? (uint32_t)((uint64_t)i >> BIGINT_WIDTH_BITS) : ext;
+    }
+
+    // from another width: sign-extends or keeps the lowest Bits bits
+    template <unsigned OtherBits>
+    constexpr explicit bigint_fixed(const bigint_fixed<OtherBits> &m) : num{}
+    {
+        uint32_t ext = m.sgn() < 0 ? (uint32_t)-1 : 0;
+        for (unsigned k = 0; k < digits; ++k)
+            num[k] = k < m.digits ? m.num[k] : ext;
+    }
+
+    // from a bigint_tp, keeping the lowest Bits bits
+    explicit bigint_fixed(bigint_tp n) : num{}
+    {
+        uint32_t ext = bigint_sgn(n) < 0 ? (uint32_t)-1 : 0;
+        for (unsigned k = 0; k < digits; ++k)
+            num[k] = k < n->digits ? n->num[k] : ext;
+    }
+
+    // a new bigint_tp, which the caller must free
+    bigint_tp to_bigint() const
+    {
+        bigint_tp res = _bigint_new(digits);
+        memcpy(res->num, num, sizeof(num));
+        _bigint_crop(res);
+        return res;
+    }
+
+    static constexpr bigint_fixed from_string(const char *c)
+    {
+        bigint_fixed res;
+        bool negative = false;
+        if (*c == '-') {
+            negative = true;
+            c++;
+        }
+        if (*c == '\0') throw std::invalid_argument("bigint_fixed: invalid number");
+        for (; *c; ++c) {
+            if (*c < '0' || *c > '9') throw std::invalid_argument("bigint_fixed: invalid number");
+            res.mul_digit(10);
+            res.add_digit(*c - '0');
+        }
+        return negative ? -res : res;
+    }
+
+    constexpr int sgn() const { return num[digits-1] & BIGINT_SIGN_BIT ? -1 : +1; }
+
+    constexpr bool is_zero() const
+    {
+        for (unsigned k = 0; k < digits; ++k)
+            if (num[k] != 0) return false;
+        return true;
+    }
+
+    // Arithmetic
+
+    constexpr bigint_fixed &operator+=(const bigint_fixed &m)
+    {
+        uint64_t carry = 0;
+        for (unsigned k = 0; k < digits; ++k) {
+            carry += (uint64_t)num[k] + m.num[k];
+            num[k] = carry;
+            carry >>= BIGINT_WIDTH_BITS;
+        }
+        return *this;
+    }
+
+    constexpr bigint_fixed &operator-=(const bigint_fixed &m)
+    {
+        uint64_t borrow = 0;
+        for (unsigned k = 0; k < digits; ++k) {
+            uint64_t diff = (uint64_t)num[k] - m.num[k] - borrow;
+            num[k] = diff;
+            borrow = (diff >> BIGINT_WIDTH_BITS) & 1;
+        }
+        return *this;
+    }
+
+    constexpr bigint_fixed &operator*=(const bigint_fixed &m)
+    {
+        // the low half of the two's complement product is the same as for
+        // the unsigned product, so no need to look at the signs
+        bigint_fixed res;
+        for (unsigned j = 0; j < digits; ++j) {
+            uint64_t carry = 0;
+            for (unsigned k = 0; k + j < digits; ++k) {
+                carry += (uint64_t)num[k] * m.num[j] + res.num[k+j];
+                res.num[k+j] = carry;
+                carry >>= BIGINT_WIDTH_BITS;
+            }
+        }
+        return *this = res;
+    }
+
+    constexpr bigint_fixed &operator/=(const bigint_fixed &m)
+    {
+        bigint_fixed r;
+        divmod(*this, m, *this, r);
+        return *this;
+    }
+
+    constexpr bigint_fixed &operator%=(const bigint_fixed &m)
+    {
+        bigint_fixed q;
+        divmod(*this, m, q, *this);
+        return *this;
+    }
+
+    constexpr bigint_fixed &operator<<=(unsigned shift)
+    {
+        if (shift >= Bits) return *this = bigint_fixed();
+        unsigned digit_shift = shift / BIGINT_WIDTH_BITS;
+        unsigned bit_shift = shift % BIGINT_WIDTH_BITS;
+        for (unsigned k = digits; k-- > 0; ) {
+            uint64_t hi = k >= digit_shift ? num[k-digit_shift] : 0;
+            uint64_t lo = k > digit_shift ? num[k-digit_shift-1] : 0;
+            num[k] = (((hi << BIGINT_WIDTH_BITS) | lo) << bit_shift) >> BIGINT_WIDTH_BITS;
+        }
+        return *this;
+    }
+
+    constexpr bigint_fixed &operator>>=(unsigned shift)
+    {
+        // arithmetic shift
+        uint32_t ext = sgn() < 0 ? (uint32_t)-1 : 0;
+        if (shift >= Bits) shift = Bits;
+        unsigned digit_shift = shift / BIGINT_WIDTH_BITS;
+        unsigned bit_shift = shift % BIGINT_WIDTH_BITS;
+        for (unsigned k = 0; k < digits; ++k) {
+            uint64_t lo = k + digit_shift < digits ? num[k+digit_shift] : ext;
+            uint64_t hi = k + digit_shift + 1 < digits ? num[k+digit_shift+1] : ext;
+            num[k] = ((hi << BIGINT_WIDTH_BITS) | lo) >> bit_shift;
+        }
+        return *this;
+    }
+
+    constexpr bigint_fixed &operator&=(const bigint_fixed &m)
+    {
+        for (unsigned k = 0; k < digits; ++k) num[k] &= m.num[k];
+        return *this;
+    }
+
+    constexpr bigint_fixed &operator|=(const bigint_fixed &m)
+    {
+        for (unsigned k = 0; k < digits; ++k) num[k] |= m.num[k];
+        return *this;
+    }
+
+    constexpr bigint_fixed &operator^=(const bigint_fixed &m)
+    {
+        for (unsigned k = 0; k < digits; ++k) num[k] ^= m.num[k];
+        return *this;
+    }
+
+    constexpr bigint_fixed operator~() const
+    {
+        bigint_fixed res = *this;
+        for (unsigned k = 0; k < digits; ++k) res.num[k] = ~res.num[k];
+        return res;
+    }
+
+    constexpr bigint_fixed operator-() const
+    {
+        bigint_fixed res = ~*this;
+        res.add_digit(1);
+        return res;
+    }
+
+    friend constexpr bigint_fixed operator+(bigint_fixed a, const bigint_fixed &b) { return a += b; }
+    friend constexpr bigint_fixed operator-(bigint_fixed a, const bigint_fixed &b) { return a -= b; }
+    friend constexpr bigint_fixed operator*(bigint_fixed a, const bigint_fixed &b) { return a *= b; }
+    friend constexpr bigint_fixed operator/(bigint_fixed a, const bigint_fixed &b) { return a /= b; }
+    friend constexpr bigint_fixed operator%(bigint_fixed a, const bigint_fixed &b) { return a %= b; }
+    friend constexpr bigint_fixed operator&(bigint_fixed a, const bigint_fixed &b) { return a &= b; }
+    friend constexpr bigint_fixed operator|(bigint_fixed a, const bigint_fixed &b) { return a |= b; }
+    friend constexpr bigint_fixed operator^(bigint_fixed a, const bigint_fixed &b) { return a ^= b; }
+    friend constexpr bigint_fixed operator<<(bigint_fixed a, unsigned shift) { return a <<= shift; }
+    friend constexpr bigint_fixed operator>>(bigint_fixed a, unsigned shift) { return a >>= shift; }
+
+    // Comparison
+
+    static constexpr int cmp(const bigint_fixed &a, const bigint_fixed &b)
+    {
+        int a_sign = a.sgn(), b_sign = b.sgn();
+        if (a_sign != b_sign) return a_sign;
+        for (unsigned k = digits; k-- > 0; ) {
+            if (a.num[k] > b.num[k]) return 1;
+            else if (a.num[k] < b.num[k]) return -1;
+        }
+        return 0;
+    }
+
+    friend constexpr bool operator==(const bigint_fixed &a, const bigint_fixed &b) { return cmp(a, b) == 0; }
+    friend constexpr bool operator!=(const bigint_fixed &a, const bigint_fixed &b) { return cmp(a, b) != 0; }
+    friend constexpr bool operator<(const bigint_fixed &a, const bigint_fixed &b) { return cmp(a, b) < 0; }
+    friend constexpr bool operator<=(const bigint_fixed &a, const bigint_fixed &b) { return cmp(a, b) <= 0; }
+    friend constexpr bool operator>(const bigint_fixed &a, const bigint_fixed &b) { return cmp(a, b) > 0; }
+    friend constexpr bool operator>=(const bigint_fixed &a, const bigint_fixed &b) { return cmp(a, b) >= 0; }
+
+    // Quotient and remainder at once. The remainder has the sign of n.
+    static constexpr void divmod(const bigint_fixed &n, const bigint_fixed &d,
+                                 bigint_fixed &quotient, bigint_fixed &remainder)
+    {
+        if (d.is_zero()) throw std::domain_error("bigint_fixed: division by zero");
+        int n_sign = n.sgn(), d_sign = d.sgn();
+        bigint_fixed u = n_sign < 0 ? -n : n;
+        bigint_fixed v = d_sign < 0 ? -d : d;
+        bigint_fixed q, r;
+        divmod_mag(u, v, q, r);
+        quotient = n_sign * d_sign < 0 ? -q : q;
+        remainder = n_sign < 0 ? -r : r;
+    }
+
+private:
+    constexpr void add_digit(uint32_t m)
+    {
+        uint64_t carry = m;
+        for (unsigned k = 0; k < digits; ++k) {
+            carry += num[k];
+            num[k] = carry;
+            carry >>= BIGINT_WIDTH_BITS;
+        }
+    }
+
+    constexpr void mul_digit(uint32_t m)
+    {
+        uint64_t carry = 0;
+        for (unsigned k = 0; k < digits; ++k) {
+            carry += (uint64_t)num[k] * m;
+            num[k] = carry;
+            carry >>= BIGINT_WIDTH_BITS;
+        }
+    }
+
+    static constexpr unsigned significant_digits(const bigint_fixed &a)
+    {
+        unsigned n = digits;
+        while (n > 1 && a.num[n-1] == 0) --n;
+        return n;
+    }
+
+    static constexpr unsigned leading_zeros(uint32_t x)
+    {
+        unsigned n = 0;
+        for (uint32_t bit = BIGINT_SIGN_BIT; bit != 0 && !(x & bit); bit >>= 1) ++n;
+        return n;
+    }
+
+    // Unsigned division (Knuth's algorithm D), with u and v read as
+    // non-negative numbers
+    static constexpr void divmod_mag(const bigint_fixed &u, const bigint_fixed &v,
+                                     bigint_fixed &q, bigint_fixed &r)
+    {
+        q = bigint_fixed();
+        r = bigint_fixed();
+        unsigned n = significant_digits(v);
+        unsigned m = significant_digits(u);
+
+        if (n == 1) {
+            uint64_t rem = 0;
+            for (unsigned k = m; k-- > 0; ) {
+                uint64_t val = (rem << BIGINT_WIDTH_BITS) | u.num[k];
+                q.num[k] = val / v.num[0];
+                rem = val % v.num[0];
+            }
+            r.num[0] = rem;
+            return;
+        }
+        if (m < n) {
+            r = u;
+            return;
+        }
+
+        // normalize so that the top digit of v has its high bit set
+        unsigned s = leading_zeros(v.num[n-1]);
+        uint32_t vn[digits] = {};
+        uint32_t un[digits + 1] = {};
+        for (unsigned k = n; k-- > 0; )
+            vn[k] = (v.num[k] << s) | (s && k > 0 ? v.num[k-1] >> (BIGINT_WIDTH_BITS - s) : 0);
+        un[m] = s ? u.num[m-1] >> (BIGINT_WIDTH_BITS - s) : 0;
+        for (unsigned k = m; k-- > 0; )
+            un[k] = (u.num[k] << s) | (s && k > 0 ? u.num[k-1] >> (BIGINT_WIDTH_BITS - s) : 0);
+
+        for (unsigned j = m - n + 1; j-- > 0; ) {
+            // estimate the quotient digit from the top two digits
+            uint64_t top = ((uint64_t)un[j+n] << BIGINT_WIDTH_BITS) | un[j+n-1];
+            uint64_t qhat = top / vn[n-1];
+            uint64_t rhat = top % vn[n-1];
+            while (qhat > BIGINT_LOW_MASK
+                   || qhat * vn[n-2] > ((rhat << BIGINT_WIDTH_BITS) | un[j+n-2])) {
+                qhat--;
+                rhat += vn[n-1];
+                if (rhat > BIGINT_LOW_MASK) break;
+            }
+
+            // un[j..j+n] -= qhat * vn
+            uint64_t carry = 0, borrow = 0;
+            for (unsigned k = 0; k < n; ++k) {
+                uint64_t prod = qhat * vn[k] + carry;
+                carry = prod >> BIGINT_WIDTH_BITS;
+                uint64_t diff = (uint64_t)un[j+k] - (prod & BIGINT_LOW_MASK) - borrow;
+                un[j+k] = diff;
+                borrow = (diff >> BIGINT_WIDTH_BITS) & 1;
+            }
+            uint64_t diff = (uint64_t)un[j+n] - carry - borrow;
+            un[j+n] = diff;
+
+            if ((diff >> BIGINT_WIDTH_BITS) & 1) {
+                // qhat was one too big: add v back
+                qhat--;
+                uint64_t c = 0;
+                for (unsigned k = 0; k < n; ++k) {
+                    c += (uint64_t)un[j+k] + vn[k];
+                    un[j+k] = c;
+                    c >>= BIGINT_WIDTH_BITS;
+                }
+                un[j+n] += c;
+            }
+            q.num[j] = qhat;
+        }
+
+        // un holds the normalized remainder
+        for (unsigned k = 0; k < n; ++k)
+            r.num[k] = (un[k] >> s) | (s ? un[k+1] << (BIGINT_WIDTH_BITS - s) : 0);
+    }
+};
+
+template <unsigned Bits>
+constexpr unsigned bigint_fixed<Bits>::digits;
+
+typedef bigint_fixed<128> bigint128_t;
+typedef bigint_fixed<256> bigint256_t;
+typedef bigint_fixed<512> bigint512_t;
+
+#endif /* _BIGINT_FIXED_HPP_ */
@@ -9,16 +9,80 @@
 
 #include <stdlib.h>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #define BIGINT_HIGH_MASK 0xFFFFFFFF00000000
 #define BIGINT_LOW_MASK  0x00000000FFFFFFFF
 #define BIGINT_WIDTH_BITS 32
 #define BIGINT_SIGN_BIT 0x80000000
 
+/* Algorithm crossover points, in digits. Run the "tune" target to generate
+   bigint_tuned_params.h with values measured on this machine; anything it
+   doesn't define falls back to the conservative ..._DEFAULT values below,
+   which are also where the tuning starts. */
+#if defined(__has_include)
+# if __has_include("bigint_tuned_params.h")
+#  include "bigint_tuned_params.h"
+# endif
+#elif defined(BIGINT_HAVE_TUNED_PARAMS)
+# include "bigint_tuned_params.h"
+#endif
+
+#define BIGINT_MUL_KARATSUBA_THRESHOLD_DEFAULT 32
+#ifndef BIGINT_MUL_KARATSUBA_THRESHOLD
+# define BIGINT_MUL_KARATSUBA_THRESHOLD BIGINT_MUL_KARATSUBA_THRESHOLD_DEFAULT
+#endif
+#define BIGINT_SQR_KARATSUBA_THRESHOLD_DEFAULT 48
+#ifndef BIGINT_SQR_KARATSUBA_THRESHOLD
+# define BIGINT_SQR_KARATSUBA_THRESHOLD BIGINT_SQR_KARATSUBA_THRESHOLD_DEFAULT
+#endif
+/* conversions to and from strings in bases that aren't powers of two split
+   numbers in half down to this many digits */
+#define BIGINT_TO_STR_THRESHOLD_DEFAULT 32
+#ifndef BIGINT_TO_STR_THRESHOLD
+# define BIGINT_TO_STR_THRESHOLD BIGINT_TO_STR_THRESHOLD_DEFAULT
+#endif
+#define BIGINT_FROM_STR_THRESHOLD_DEFAULT 32
+#ifndef BIGINT_FROM_STR_THRESHOLD
+# define BIGINT_FROM_STR_THRESHOLD BIGINT_FROM_STR_THRESHOLD_DEFAULT
+#endif
+/* divisions by numbers with this many digits that can be done with a
+   reciprocal (in bigint_mod_many and the string conversions) compute it with
+   Newton's method. Below a few thousand digits schoolbook division is
+   faster, so this sits where Newton starts to win */
+#define BIGINT_DIV_NEWTON_THRESHOLD_DEFAULT 8192
+#ifndef BIGINT_DIV_NEWTON_THRESHOLD
+# define BIGINT_DIV_NEWTON_THRESHOLD BIGINT_DIV_NEWTON_THRESHOLD_DEFAULT
+#endif
+/* bigint_mod_many switches to a remainder tree for numbers with this many
+   digits */
+#define BIGINT_MOD_MANY_TREE_THRESHOLD_DEFAULT 48
+#ifndef BIGINT_MOD_MANY_TREE_THRESHOLD
+# define BIGINT_MOD_MANY_TREE_THRESHOLD BIGINT_MOD_MANY_TREE_THRESHOLD_DEFAULT
+#endif
+
 #ifndef _BIGINT_INLINE
 # define _BIGINT_INLINE inline
 #endif
 
+#define BIGINT_INTERN_INITIAL_BUCKETS 8
+
+// serialised fixed base tables start with these words
+#define BIGINT_FIXED_BASE_MAGIC 0x31626662 // "bfb1"
+#define BIGINT_FIXED_BASE_HEADER 5
+
+// reciprocal of 10^9, the biggest power of ten that fits a digit
+#define _BIGINT_LIMB_INV_1E9 { 4000000000u, 316718722u, 2 }
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 _bigint_uint128_t;
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -26,30 +90,61 @@ extern "C"
 
 _BIGINT_INLINE bigint_tp _bigint_new(uint32_t digits)
 {
-    bigint_tp res = malloc(sizeof(struct _bigint) + digits * sizeof(uint32_t));
+    bigint_tp res = (bigint_tp)malloc(sizeof(struct _bigint) + digits * sizeof(uint32_t));
     res->digits = digits;
+#ifdef BIGINT_REFCOUNT
+    res->refs = 1;
+#endif
     return res;
 }
 
 _BIGINT_INLINE bigint_tp _bigint_realloc(bigint_tp n, uint32_t digits)
 {
-    n = realloc(n, sizeof(struct _bigint) + digits * sizeof(uint32_t));
+    n = (bigint_tp)realloc(n, sizeof(struct _bigint) + digits * sizeof(uint32_t));
     n->digits = digits;
     return n;
 }
 
 _BIGINT_INLINE void bigint_free(bigint_tp n)
 {
+#ifdef BIGINT_REFCOUNT
+    if (__atomic_sub_fetch(&n->refs, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+#endif
     free(n);
 }
 
-_BIGINT_INLINE bigint_tp bigint_dup(bigint_tp n)
+_BIGINT_INLINE bigint_tp _bigint_copy(bigint_tp n)
 {
     bigint_tp res = _bigint_new(n->digits);
     memcpy(res->num, n->num, n->digits * sizeof(uint32_t));
     return res;
 }
 
+_BIGINT_INLINE bigint_tp bigint_dup(bigint_tp n)
+{
+#ifdef BIGINT_REFCOUNT
+    __atomic_add_fetch(&n->refs, 1, __ATOMIC_RELAXED);
+    return n;
+#else
+    return _bigint_copy(n);
+#endif
+}
+
+_BIGINT_INLINE bigint_tp _bigint_unshare(bigint_tp n)
+{
+    // Called before modifying n in place. If anyone else holds a reference
+    // to n, we have to make our own copy first.
+#ifdef BIGINT_REFCOUNT
+    if (__atomic_load_n(&n->refs, __ATOMIC_ACQUIRE) != 1) {
+        bigint_tp res = _bigint_copy(n);
+        bigint_free(n);
+        return res;
+    }
+#endif
+    return n;
+}
+
 _BIGINT_INLINE void _bigint_crop(bigint_tp n)
 {
     while (n->digits > 1
@@ -60,7 +155,7 @@ _BIGINT_INLINE void _bigint_crop(bigint_tp n)
 
 _BIGINT_INLINE bigint_tp bigint_from_int(int64_t i)
 {
-    if ((i > 0 && (i & (BIGINT_HIGH_MASK | BIGINT_SIGN_BIT))) || (i < 0 && (~i & BIGINT_HIGH_MASK))) {
+    if ((i > 0 && (i & (BIGINT_HIGH_MASK | BIGINT_SIGN_BIT))) || (i < 0 && (~i & (BIGINT_HIGH_MASK | BIGINT_SIGN_BIT)))) {
         // two digits
         bigint_tp res = _bigint_new(2);
         res->num[0] = i & BIGINT_LOW_MASK;
@@ -98,7 +193,7 @@ _BIGINT_INLINE int bigint_cmp(bigint_tp n, bigint_tp m)
     if (n_sign > m_sign) return 1;
     else if (n_sign < m_sign) return -1;
     else if (n->digits > m->digits) return n_sign;
-    else if (n->digits < m->digits) return n_sign;
+    else if (n->digits < m->digits) return -n_sign;
     else {
         // same number of digits, same sign.
         for (int i = n->digits-1; i >= 0; --i) {
@@ -112,13 +207,22 @@ _BIGINT_INLINE int bigint_cmp(bigint_tp n, bigint_tp m)
 _BIGINT_INLINE bigint_tp bigint_shift(bigint_tp n, int32_t shift)
 {
     if (shift == 0) return n;
-    else if (shift < 0) {
+    n = _bigint_unshare(n);
+    if (shift < 0) {
         // right shift
         shift = -shift;
         uint32_t sign_bit = n->num[n->digits-1] & BIGINT_SIGN_BIT;
-        while (shift >= BIGINT_WIDTH_BITS) {
-            shift -= BIGINT_WIDTH_BITS;
-            memcpy(&n->num[0], &n->num[1], sizeof(uint32_t) * (--n->digits));
+        uint32_t digit_shift = shift / BIGINT_WIDTH_BITS;
+        shift %= BIGINT_WIDTH_BITS;
+        if (digit_shift >= n->digits) {
+            // everything is shifted out
+            n->digits = 1;
+            n->num[0] = sign_bit ? (uint32_t)-1 : 0;
+            return n;
+        }
+        if (digit_shift > 0) {
+            n->digits -= digit_shift;
+            memmove(&n->num[0], &n->num[digit_shift], sizeof(uint32_t) * n->digits);
         }
         for (unsigned int i = 0; i < n->digits; ++i) {
             uint64_t val = n->num[i];
@@ -162,42 +266,46 @@ _BIGINT_INLINE bigint_tp bigint_shift(bigint_tp n, int32_t shift)
 
 _BIGINT_INLINE bigint_tp bigint_add32_inplace(bigint_tp n, int32_t m)
 {
-    int n_sign = bigint_sgn(n);
-    
-    int m_sign = m < 0 ? -1 : +1;
-
-    uint64_t carry = (uint32_t) m;
-    uint64_t val;
-
-    for (unsigned int i = 0; i < n->digits; ++i) {
-        val = n->num[i] + carry;
-        n->num[i] = val;
-        carry = ((val & BIGINT_HIGH_MASK) >> BIGINT_WIDTH_BITS);
-        if (carry != 0 && m_sign == -1) carry += (uint32_t) -1;
-        if (carry == 0) {
-            break;
+    n = _bigint_unshare(n);
+    // the digits above the top are all sign bits
+    uint32_t n_ext = (n->num[n->digits-1] & BIGINT_SIGN_BIT) ? (uint32_t)-1 : 0;
+    uint32_t m_ext = m < 0 ? (uint32_t)-1 : 0;
+
+    uint64_t val = (uint64_t)n->num[0] + (uint32_t)m;
+    n->num[0] = val;
+    uint64_t carry = val >> BIGINT_WIDTH_BITS;
+    for (unsigned int i = 1; i < n->digits; ++i) {
+        if ((uint32_t)(m_ext + carry) == 0) {
+            // adding 0 + 0 or (2^32 - 1) + 1: nothing changes from here on
+            _bigint_crop(n);
+            return n;
         }
+        val = (uint64_t)n->num[i] + m_ext + carry;
+        n->num[i] = val;
+        carry = val >> BIGINT_WIDTH_BITS;
     }
 
-    if ((n_sign & BIGINT_SIGN_BIT) != (val & BIGINT_SIGN_BIT) && (m_sign & BIGINT_SIGN_BIT) != (val & BIGINT_SIGN_BIT)) {
+    // expand the number if the sign doesn't fit any more
+    uint32_t next = n_ext + m_ext + (uint32_t)carry;
+    uint32_t top_ext = (n->num[n->digits-1] & BIGINT_SIGN_BIT) ? (uint32_t)-1 : 0;
+    if (next != top_ext) {
         n = _bigint_realloc(n, n->digits + 1);
-        if (n_sign == -1) n->num[n->digits-1] = -1; // underflow
-        else n->num[n->digits-1] = carry; // overflow
+        n->num[n->digits-1] = next;
     }
 
     _bigint_crop(n);
-    
     return n;
 }
 
 _BIGINT_INLINE bigint_tp bigint_add32(bigint_tp n, int32_t m)
 {
-    bigint_tp res = bigint_dup(n);
+    bigint_tp res = _bigint_copy(n);
     return bigint_add32_inplace(res, m);
 }
 
 _BIGINT_INLINE bigint_tp bigint_add_inplace(bigint_tp n, bigint_tp m)
 {
+    n = _bigint_unshare(n);
     int sgn_n = bigint_sgn(n);
     int sgn_m = bigint_sgn(m);
     int digits_n = n->digits;
@@ -205,7 +313,7 @@ _BIGINT_INLINE bigint_tp bigint_add_inplace(bigint_tp n, bigint_tp m)
     int digits = digits_n >= digits_m ? digits_n : digits_m;
 
     uint64_t carry = 0;
-    uint64_t val_n, val_m, sum;
+    uint64_t val_n, val_m, sum = 0;
     for (int i = 0; i < digits; ++i) {
         if (i < digits_n) val_n = n->num[i];
         else {
@@ -233,25 +341,214 @@ _BIGINT_INLINE bigint_tp bigint_add_inplace(bigint_tp n, bigint_tp m)
 
 _BIGINT_INLINE bigint_tp bigint_add(bigint_tp n, bigint_tp m)
 {
-    bigint_tp res = bigint_dup(n);
+    bigint_tp res = _bigint_copy(n);
     return bigint_add_inplace(res, m);
 }
 
-_BIGINT_INLINE bigint_tp bigint_flipsign(bigint_tp n)
+_BIGINT_INLINE uint32_t _bigint_limbs_sub(uint32_t *r, const uint32_t *a, uint32_t an, const uint32_t *b, uint32_t bn)
 {
-    for (unsigned int i = 0; i < n->digits; ++i) {
-        n->num[i] = ~n->num[i];
+    // r[0..max(an, bn)) = a - b, reading both as two's complement numbers
+    // (an, bn >= 1). r may be a or b. Returns the next digit of the result,
+    // which is only ever the sign extension: 0 or 2^32 - 1.
+    uint32_t a_ext = (a[an-1] & BIGINT_SIGN_BIT) ? (uint32_t)-1 : 0;
+    uint32_t b_ext = (b[bn-1] & BIGINT_SIGN_BIT) ? (uint32_t)-1 : 0;
+    uint32_t digits = an > bn ? an : bn;
+    uint32_t common = an < bn ? an : bn;
+    uint32_t borrow = 0, i;
+    for (i = 0; i < common; ++i) {
+        uint64_t d = (uint64_t)a[i] - b[i] - borrow;
+        r[i] = (uint32_t)d;
+        borrow = (uint32_t)(d >> BIGINT_WIDTH_BITS) & 1;
+    }
+    if (an > bn && r == a) {
+        // subtracting 0 or (2^32 - 1) + 1 from the rest of a changes nothing
+        for (; i < digits && (uint32_t)(b_ext + borrow) != 0; ++i) {
+            uint64_t d = (uint64_t)a[i] - b_ext - borrow;
+            r[i] = (uint32_t)d;
+            borrow = (uint32_t)(d >> BIGINT_WIDTH_BITS) & 1;
+        }
+        if (i < digits) return a_ext;
+    }
+    for (; i < digits; ++i) {
+        uint64_t d = (uint64_t)(i < an ? a[i] : a_ext) - (i < bn ? b[i] : b_ext) - borrow;
+        r[i] = (uint32_t)d;
+        borrow = (uint32_t)(d >> BIGINT_WIDTH_BITS) & 1;
+    }
+    return a_ext - b_ext - borrow;
+}
+
+_BIGINT_INLINE bigint_tp _bigint_put_top(bigint_tp n, uint32_t top)
+{
+    // append top as the next digit of n, unless the sign extension of n
+    // already says the same, and crop
+    if (top != ((n->num[n->digits-1] & BIGINT_SIGN_BIT) ? (uint32_t)-1 : 0)) {
+        n = _bigint_realloc(n, n->digits + 1);
+        n->num[n->digits-1] = top;
     }
-    n = bigint_add32_inplace(n, 1);
+    _bigint_crop(n);
     return n;
 }
 
+_BIGINT_INLINE bigint_tp bigint_sub(bigint_tp n, bigint_tp m)
+{
+    uint32_t digits = n->digits > m->digits ? n->digits : m->digits;
+    bigint_tp res = _bigint_new(digits + 1);
+    res->num[digits] = _bigint_limbs_sub(res->num, n->num, n->digits, m->num, m->digits);
+    _bigint_crop(res);
+    return res;
+}
+
+_BIGINT_INLINE bigint_tp bigint_sub_inplace(bigint_tp n, bigint_tp m)
+{
+    // n - m
+    n = _bigint_unshare(n);
+    uint32_t n_digits = n->digits, m_digits = m->digits;
+    if (m_digits > n_digits) n = _bigint_realloc(n, m_digits);
+    uint32_t top = _bigint_limbs_sub(n->num, n->num, n_digits, m->num, m_digits);
+    return _bigint_put_top(n, top);
+}
+
+_BIGINT_INLINE bigint_tp bigint_rsub_inplace(bigint_tp n, bigint_tp m)
+{
+    // m - n
+    n = _bigint_unshare(n);
+    uint32_t n_digits = n->digits, m_digits = m->digits;
+    if (m_digits > n_digits) n = _bigint_realloc(n, m_digits);
+    uint32_t top = _bigint_limbs_sub(n->num, m->num, m_digits, n->num, n_digits);
+    return _bigint_put_top(n, top);
+}
+
+_BIGINT_INLINE bigint_tp bigint_sub32_inplace(bigint_tp n, int32_t m)
+{
+    n = _bigint_unshare(n);
+    uint32_t digit = (uint32_t)m;
+    uint32_t top = _bigint_limbs_sub(n->num, n->num, n->digits, &digit, 1);
+    return _bigint_put_top(n, top);
+}
+
+_BIGINT_INLINE bigint_tp bigint_sub32(bigint_tp n, int32_t m)
+{
+    uint32_t digit = (uint32_t)m;
+    bigint_tp res = _bigint_new(n->digits + 1);
+    res->num[n->digits] = _bigint_limbs_sub(res->num, n->num, n->digits, &digit, 1);
+    _bigint_crop(res);
+    return res;
+}
+
+_BIGINT_INLINE bigint_tp bigint_neg_into(bigint_tp r, bigint_tp n)
+{
+    // -n, in the memory of r (which is consumed), or in a new number if r
+    // is NULL. r may be n.
+    uint32_t digits = n->digits;
+    if (r == NULL) {
+        r = _bigint_new(digits);
+    } else {
+        r = _bigint_unshare(r);
+        if (r->digits != digits) {
+            int same = r == n;
+            r = _bigint_realloc(r, digits);
+            if (same) n = r;
+        }
+    }
+    uint32_t n_ext = (n->num[digits-1] & BIGINT_SIGN_BIT) ? (uint32_t)-1 : 0;
+    uint32_t carry = 1;
+    for (uint32_t i = 0; i < digits; ++i) {
+        uint64_t v = (uint64_t)(uint32_t)~n->num[i] + carry;
+        r->num[i] = (uint32_t)v;
+        carry = (uint32_t)(v >> BIGINT_WIDTH_BITS);
+    }
+    return _bigint_put_top(r, ~n_ext + carry);
+}
+
+_BIGINT_INLINE bigint_tp bigint_flipsign(bigint_tp n)
+{
+    return bigint_neg_into(n, n);
+}
+
+_BIGINT_INLINE void _bigint_limb_inv_init(struct _bigint_limb_inv *inv, uint32_t d)
+{
+    // d != 0
+    inv->shift = 0;
+    while (!(d & BIGINT_SIGN_BIT)) {
+        d <<= 1;
+        inv->shift++;
+    }
+    inv->d = d;
+    inv->v = UINT64_MAX / d - ((uint64_t)1 << BIGINT_WIDTH_BITS);
+}
+
+_BIGINT_INLINE uint32_t _bigint_div_limb_preinv(uint32_t *r, uint32_t u, const struct _bigint_limb_inv *inv)
+{
+    // Divides (*r:u) by the divisor, where *r < divisor, without a division
+    // instruction (Moeller & Granlund, "Improved division by invariant
+    // integers", 2011). Returns the quotient and leaves the remainder in *r.
+    uint64_t val = ((((uint64_t)*r) << BIGINT_WIDTH_BITS) | u) << inv->shift;
+    uint32_t u1 = val >> BIGINT_WIDTH_BITS, u0 = val & BIGINT_LOW_MASK;
+
+    uint64_t qq = (uint64_t)inv->v * u1 + val;
+    uint32_t q = (qq >> BIGINT_WIDTH_BITS) + 1;
+    uint32_t rem = u0 - q * inv->d;
+    if (rem > (uint32_t)(qq & BIGINT_LOW_MASK)) {
+        q--;
+        rem += inv->d;
+    }
+    if (rem >= inv->d) {
+        // rare
+        q++;
+        rem -= inv->d;
+    }
+    *r = rem >> inv->shift;
+    return q;
+}
+
+_BIGINT_INLINE void _bigint_limbs_divrem_1(uint32_t *q, const uint32_t *a, uint32_t n,
+                                           const struct _bigint_limb_inv *inv, uint32_t k, uint32_t *rems)
+{
+    // q[0..n) = a[0..n) / d^k, in a single pass (q may be a). Each quotient
+    // digit of the division by d is divided again straight away, so
+    // rems[0..k) get the base d digits of the remainder, lowest first.
+    memset(rems, 0, k * sizeof(uint32_t));
+    for (uint32_t i = n; i-- > 0; ) {
+        uint32_t u = a[i];
+        for (uint32_t j = 0; j < k; ++j)
+            u = _bigint_div_limb_preinv(&rems[j], u, inv);
+        q[i] = u;
+    }
+}
+
+_BIGINT_INLINE uint32_t _bigint_limbs_mod_1(const uint32_t *a, uint32_t n, const struct _bigint_limb_inv *inv)
+{
+    // a[0..n) mod d, without storing the quotient
+    uint32_t rem = 0;
+    for (uint32_t i = n; i-- > 0; )
+        _bigint_div_limb_preinv(&rem, a[i], inv);
+    return rem;
+}
+
+_BIGINT_INLINE uint32_t _bigint_mod_1(bigint_tp n, uint32_t d)
+{
+    // |n| mod d, for d != 0, without writing to n
+    struct _bigint_limb_inv inv;
+    _bigint_limb_inv_init(&inv, d);
+    uint32_t rem = _bigint_limbs_mod_1(n->num, n->digits, &inv);
+    if (bigint_sgn(n) >= 0) return rem;
+
+    // the digits hold 2^(32 digits) - |n|
+    uint64_t p = 1 % d, b = ((uint64_t)1 << BIGINT_WIDTH_BITS) % d;
+    for (uint32_t e = n->digits; e != 0; e >>= 1) {
+        if (e & 1) p = p * b % d;
+        b = b * b % d;
+    }
+    return (p + d - rem) % d;
+}
+
 _BIGINT_INLINE bigint_tp bigint_div32_inplace(bigint_tp numerator, int32_t denominator, int32_t *remainder)
 {
     if (denominator == 0) return NULL;
+    numerator = _bigint_unshare(numerator);
 
     int d_sign = denominator < 0 ? -1 : +1;
-    denominator *= d_sign;
+    uint32_t d = denominator < 0 ? -(uint32_t)denominator : (uint32_t)denominator;
     int n_sign = bigint_sgn(numerator);
     int r_sign = d_sign * n_sign;
 
@@ -260,12 +557,10 @@ _BIGINT_INLINE bigint_tp bigint_div32_inplace(bigint_tp numerator, int32_t denom
         numerator = bigint_flipsign(numerator);
     }
 
-    uint64_t rem = 0;
-    for (int i = numerator->digits - 1; i >= 0; --i) {
-        uint64_t val = numerator->num[i] + (rem << BIGINT_WIDTH_BITS);
-        numerator->num[i] = val / (uint64_t)denominator;
-        rem = val % denominator;
-    }
+    struct _bigint_limb_inv inv;
+    uint32_t rem;
+    _bigint_limb_inv_init(&inv, d);
+    _bigint_limbs_divrem_1(numerator->num, numerator->num, numerator->digits, &inv, 1, &rem);
 
     if (r_sign < 0) {
         // flip the sign
@@ -275,7 +570,7 @@ _BIGINT_INLINE bigint_tp bigint_div32_inplace(bigint_tp numerator, int32_t denom
     // remove extraneous digits if possible
     _bigint_crop(numerator);
 
-    if (remainder != NULL) *remainder = rem * r_sign;
+    if (remainder != NULL) *remainder = (int32_t)rem * n_sign;
     return numerator;
 }
 
@@ -283,13 +578,39 @@ _BIGINT_INLINE bigint_tp bigint_div32(bigint_tp numerator, int32_t denominator,
 {
     if (denominator == 0) return NULL;
 
-    bigint_tp res = bigint_dup(numerator);
+    bigint_tp res = _bigint_copy(numerator);
     res = bigint_div32_inplace(res, denominator, remainder);
     return res;
 }
 
+_BIGINT_INLINE bigint_tp bigint_divrem_1_inplace(bigint_tp n, uint32_t d, uint32_t k, uint32_t *rems)
+{
+    // divides |n| by d^k, rounding to zero; the quotient has the sign of n
+    if (d == 0) return NULL;
+    n = _bigint_unshare(n);
+    int sign = bigint_sgn(n);
+    if (sign < 0) n = bigint_flipsign(n);
+
+    struct _bigint_limb_inv inv;
+    _bigint_limb_inv_init(&inv, d);
+    _bigint_limbs_divrem_1(n->num, n->num, n->digits, &inv, k, rems);
+
+    if (sign < 0) n = bigint_flipsign(n);
+    _bigint_crop(n);
+    return n;
+}
+
+_BIGINT_INLINE bigint_tp bigint_divrem_1(bigint_tp n, uint32_t d, uint32_t k, uint32_t *rems)
+{
+    if (d == 0) return NULL;
+
+    bigint_tp res = _bigint_copy(n);
+    return bigint_divrem_1_inplace(res, d, k, rems);
+}
+
 _BIGINT_INLINE bigint_tp bigint_mul32u_inplace(bigint_tp n, uint32_t m)
 {
+    n = _bigint_unshare(n);
     int n_sign = bigint_sgn(n);
     uint32_t carry = 0;
 
@@ -329,110 +650,1061 @@ _BIGINT_INLINE bigint_tp bigint_mul32_inplace(bigint_tp n, int32_t m)
 
 _BIGINT_INLINE bigint_tp bigint_mul32(bigint_tp n, int32_t m)
 {
-    bigint_tp res = bigint_dup(n);
+    bigint_tp res = _bigint_copy(n);
     return bigint_mul32_inplace(res, m);
 }
 
 _BIGINT_INLINE bigint_tp bigint_mul32u(bigint_tp n, uint32_t m)
 {
-    bigint_tp res = bigint_dup(n);
+    bigint_tp res = _bigint_copy(n);
     return bigint_mul32u_inplace(res, m);
 }
 
 
-_BIGINT_INLINE bigint_tp bigint_mul(bigint_tp n, bigint_tp m)
+_BIGINT_INLINE uint32_t _bigint_mag_digits(bigint_tp n)
 {
-    bigint_tp res = bigint_from_int(0);
-    int m_sign = bigint_sgn(m);
-    if (m_sign < 0) {
-        m = bigint_dup(m);
-        m = bigint_flipsign(m);
+    // number of significant digits of a non-negative number
+    uint32_t digits = n->digits;
+    while (digits > 1 && n->num[digits-1] == 0)
+        digits--;
+    return digits;
+}
+
+_BIGINT_INLINE uint32_t _bigint_limbs_add_to(uint32_t *r, uint32_t rn, const uint32_t *a, uint32_t an)
+{
+    // r += a, where rn >= an. Returns the carry out of r.
+    uint64_t carry = 0;
+    uint32_t i;
+    for (i = 0; i < an; ++i) {
+        carry += (uint64_t)r[i] + a[i];
+        r[i] = carry;
+        carry >>= BIGINT_WIDTH_BITS;
     }
+    for (; carry != 0 && i < rn; ++i) {
+        carry += r[i];
+        r[i] = carry;
+        carry >>= BIGINT_WIDTH_BITS;
+    }
+    return carry;
+}
 
-    for (int i = m->digits - 1; i >= 0; --i) {
-        bigint_tp tmp = bigint_mul32u(n, m->num[i]);
-        tmp = bigint_shift(tmp, i * BIGINT_WIDTH_BITS);
-        res = bigint_add_inplace(res, tmp);
-        bigint_free(tmp);
+_BIGINT_INLINE uint32_t _bigint_limbs_sub_from(uint32_t *r, uint32_t rn, const uint32_t *a, uint32_t an)
+{
+    // r -= a, where rn >= an. Returns the borrow out of r.
+    uint64_t borrow = 0;
+    uint32_t i;
+    for (i = 0; i < an; ++i) {
+        uint64_t diff = (uint64_t)r[i] - a[i] - borrow;
+        r[i] = diff;
+        borrow = (diff >> BIGINT_WIDTH_BITS) & 1;
     }
+    for (; borrow != 0 && i < rn; ++i) {
+        uint64_t diff = (uint64_t)r[i] - borrow;
+        r[i] = diff;
+        borrow = (diff >> BIGINT_WIDTH_BITS) & 1;
+    }
+    return borrow;
+}
 
-    if (m_sign < 0) {
-        bigint_free(m);
-        res = bigint_flipsign(res);
+_BIGINT_INLINE uint32_t _bigint_limbs_addmul1(uint32_t *r, const uint32_t *a, uint32_t n, uint32_t m)
+{
+    // r[0..n) += a[0..n) * m. Returns the high digit.
+    uint64_t carry = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint64_t val = (uint64_t)a[i] * m + r[i] + carry;
+        r[i] = val & BIGINT_LOW_MASK;
+        carry = val >> BIGINT_WIDTH_BITS;
+    }
+    return carry;
+}
+
+_BIGINT_INLINE uint32_t _bigint_limbs_submul1(uint32_t *r, const uint32_t *a, uint32_t n, uint32_t m)
+{
+    // r[0..n) -= a[0..n) * m. Returns the digit still to be subtracted above.
+    uint64_t borrow = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint64_t val = (uint64_t)a[i] * m + borrow;
+        uint32_t lo = val & BIGINT_LOW_MASK;
+        borrow = val >> BIGINT_WIDTH_BITS;
+        if (r[i] < lo) borrow++;
+        r[i] -= lo;
+    }
+    return borrow;
+}
+
+_BIGINT_INLINE void _bigint_mul_basecase(uint32_t *r, const uint32_t *a, uint32_t an,
+                                         const uint32_t *b, uint32_t bn)
+{
+    // r[0..an+bn) = a * b, schoolbook
+    memset(r, 0, an * sizeof(uint32_t));
+    for (uint32_t j = 0; j < bn; ++j)
+        r[an+j] = _bigint_limbs_addmul1(r + j, a, an, b[j]);
+}
+
+_BIGINT_INLINE void _bigint_sqr_basecase(uint32_t *r, const uint32_t *a, uint32_t n)
+{
+    // r[0..2n) = a * a: every cross product once, doubled, plus the squares
+    memset(r, 0, 2 * n * sizeof(uint32_t));
+    for (uint32_t i = 0; i + 1 < n; ++i)
+        r[n+i] = _bigint_limbs_addmul1(r + 2*i + 1, a + i + 1, n - i - 1, a[i]);
+
+    uint32_t overflow = 0;
+    for (uint32_t i = 0; i < 2 * n; ++i) {
+        uint32_t val = r[i];
+        r[i] = (val << 1) | overflow;
+        overflow = val >> (BIGINT_WIDTH_BITS - 1);
     }
+
+    uint64_t carry = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint64_t sq = (uint64_t)a[i] * a[i];
+        carry += (uint64_t)r[2*i] + (sq & BIGINT_LOW_MASK);
+        r[2*i] = carry;
+        carry >>= BIGINT_WIDTH_BITS;
+        carry += (uint64_t)r[2*i+1] + (sq >> BIGINT_WIDTH_BITS);
+        r[2*i+1] = carry;
+        carry >>= BIGINT_WIDTH_BITS;
+    }
+}
+
+_BIGINT_INLINE void _bigint_mul_mag(uint32_t *r, const uint32_t *a, uint32_t an,
+                                    const uint32_t *b, uint32_t bn)
+{
+    // r[0..an+bn) = a * b for unsigned digit arrays with an >= bn >= 1.
+    // (Karatsuba needs at least 4 digits to make progress.)
+    if (bn < BIGINT_MUL_KARATSUBA_THRESHOLD || bn < 4) {
+        _bigint_mul_basecase(r, a, an, b, bn);
+        return;
+    }
+
+    uint32_t h = (an + 1) / 2;
+    if (bn <= h) {
+        // unbalanced: multiply b by bn-sized slices of a
+        uint32_t *tmp = (uint32_t *)malloc(2 * bn * sizeof(uint32_t));
+        memset(r, 0, (an + bn) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < an; i += bn) {
+            uint32_t len = an - i < bn ? an - i : bn;
+            _bigint_mul_mag(tmp, b, bn, a + i, len);
+            _bigint_limbs_add_to(r + i, an + bn - i, tmp, bn + len);
+        }
+        free(tmp);
+        return;
+    }
+
+    // Karatsuba: a = a1 B^h + a0, b = b1 B^h + b0
+    // a b = a1 b1 B^2h + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B^h + a0 b0
+    uint32_t *sa = (uint32_t *)malloc((4 * h + 4) * sizeof(uint32_t));
+    uint32_t *sb = sa + h + 1;
+    uint32_t *z1 = sb + h + 1;
+
+    memcpy(sa, a, h * sizeof(uint32_t));
+    sa[h] = _bigint_limbs_add_to(sa, h, a + h, an - h);
+    memcpy(sb, b, h * sizeof(uint32_t));
+    sb[h] = _bigint_limbs_add_to(sb, h, b + h, bn - h);
+    _bigint_mul_mag(z1, sa, h + 1, sb, h + 1);
+
+    _bigint_mul_mag(r, a, h, b, h);
+    _bigint_mul_mag(r + 2*h, a + h, an - h, b + h, bn - h);
+
+    _bigint_limbs_sub_from(z1, 2*h + 2, r, 2*h);
+    _bigint_limbs_sub_from(z1, 2*h + 2, r + 2*h, an + bn - 2*h);
+    // the middle term fits in what remains of r
+    uint32_t z1_len = 2*h + 2 < an + bn - h ? 2*h + 2 : an + bn - h;
+    _bigint_limbs_add_to(r + h, an + bn - h, z1, z1_len);
+
+    free(sa);
+}
+
+_BIGINT_INLINE void _bigint_sqr_mag(uint32_t *r, const uint32_t *a, uint32_t n)
+{
+    // r[0..2n) = a * a for an unsigned digit array
+    if (n < BIGINT_SQR_KARATSUBA_THRESHOLD || n < 4) {
+        _bigint_sqr_basecase(r, a, n);
+        return;
+    }
+
+    uint32_t h = (n + 1) / 2;
+    uint32_t *sa = (uint32_t *)malloc((3 * h + 3) * sizeof(uint32_t));
+    uint32_t *z1 = sa + h + 1;
+
+    memcpy(sa, a, h * sizeof(uint32_t));
+    sa[h] = _bigint_limbs_add_to(sa, h, a + h, n - h);
+    _bigint_sqr_mag(z1, sa, h + 1);
+
+    _bigint_sqr_mag(r, a, h);
+    _bigint_sqr_mag(r + 2*h, a + h, n - h);
+
+    _bigint_limbs_sub_from(z1, 2*h + 2, r, 2*h);
+    _bigint_limbs_sub_from(z1, 2*h + 2, r + 2*h, 2*n - 2*h);
+    uint32_t z1_len = 2*h + 2 < 2*n - h ? 2*h + 2 : 2*n - h;
+    _bigint_limbs_add_to(r + h, 2*n - h, z1, z1_len);
+
+    free(sa);
+}
+
+_BIGINT_INLINE uint32_t _bigint_mul_digits(uint32_t *r, bigint_tp n, bigint_tp m)
+{
+    // r = |n| * |m|, where r has room for n->digits + m->digits digits.
+    // Returns the number of digits written.
+    int n_sign = bigint_sgn(n);
+    int m_sign = bigint_sgn(m);
+    int square = (n == m);
+
+    // work on the magnitudes
+    if (n_sign < 0) n = bigint_neg_into(NULL, n);
+    if (square) m = n;
+    else if (m_sign < 0) m = bigint_neg_into(NULL, m);
+
+    uint32_t n_digits = _bigint_mag_digits(n);
+    uint32_t m_digits = _bigint_mag_digits(m);
+    if (square)
+        _bigint_sqr_mag(r, n->num, n_digits);
+    else if (n_digits >= m_digits)
+        _bigint_mul_mag(r, n->num, n_digits, m->num, m_digits);
+    else
+        _bigint_mul_mag(r, m->num, m_digits, n->num, n_digits);
+
+    if (n_sign < 0) bigint_free(n);
+    if (m_sign < 0 && !square) bigint_free(m);
+    return n_digits + m_digits;
+}
+
+_BIGINT_INLINE bigint_tp _bigint_add_digits_inplace(bigint_tp n, const uint32_t *m, uint32_t m_digits, int m_sign)
+{
+    n = _bigint_unshare(n);
+    // n += m_sign * m, where m is an unsigned digit array
+    uint32_t n_digits = n->digits;
+    uint32_t digits = (n_digits > m_digits ? n_digits : m_digits) + 1;
+    uint32_t sign_ext = bigint_sgn(n) < 0 ? (uint32_t)-1 : 0;
+
+    n = _bigint_realloc(n, digits);
+    for (uint32_t i = n_digits; i < digits; ++i)
+        n->num[i] = sign_ext;
+    // the spare digit means this can't overflow
+    if (m_sign < 0)
+        _bigint_limbs_sub_from(n->num, digits, m, m_digits);
+    else
+        _bigint_limbs_add_to(n->num, digits, m, m_digits);
+
+    _bigint_crop(n);
+    return n;
+}
+
+_BIGINT_INLINE bigint_tp bigint_mul(bigint_tp n, bigint_tp m)
+{
+    // one spare digit for the sign
+    bigint_tp res = _bigint_new(n->digits + m->digits + 1);
+    uint32_t digits = _bigint_mul_digits(res->num, n, m);
+    memset(&res->num[digits], 0, (res->digits - digits) * sizeof(uint32_t));
+    _bigint_crop(res);
+
+    if (bigint_sgn(n) * bigint_sgn(m) < 0) res = bigint_flipsign(res);
     return res;
 }
 
-_BIGINT_INLINE bigint_tp _bigint_find_quotient(bigint_tp n, bigint_tp d,
-                                               bigint_tp overestimate,
-                                               bigint_tp underestimate)
+_BIGINT_INLINE bigint_tp _bigint_addmul_mag_inplace(bigint_tp n, bigint_tp a, bigint_tp b, int sign)
 {
-    bigint_tp trial = bigint_add(overestimate, underestimate);
-    trial = bigint_shift(trial, -1);
-    if (bigint_cmp(trial, underestimate) == 0)
-        return trial;
-    bigint_tp res = bigint_mul(trial, d);
-    bigint_tp rec_res;
-    switch (bigint_cmp(res, n)) {
-    case 0: // correct
-        bigint_free(res);
-        return trial;
-    case 1: // to big
-        bigint_free(res);
-        rec_res = _bigint_find_quotient(n, d, trial, underestimate);
-        bigint_free(trial);
-        return rec_res;
-    default:
-    case -1:
-        bigint_free(res);
-        rec_res = _bigint_find_quotient(n, d, overestimate, trial);
-        bigint_free(trial);
-        return rec_res;
+    // n += sign * |a| * |b|
+    bigint_tp a0 = a, b0 = b;
+    // work on the magnitudes, and don't read from n while writing to it
+    if (bigint_sgn(a) < 0) a = bigint_neg_into(NULL, a);
+    else if (a == n) a = _bigint_copy(a);
+    if (b == a0) b = a;
+    else if (bigint_sgn(b) < 0) b = bigint_neg_into(NULL, b);
+    else if (b == n) b = _bigint_copy(b);
+
+    uint32_t an = _bigint_mag_digits(a), bn = _bigint_mag_digits(b);
+    const uint32_t *ad = a->num, *bd = b->num;
+    if (an < bn) {
+        uint32_t t = an; an = bn; bn = t;
+        ad = b->num; bd = a->num;
+    }
+
+    if (bn < BIGINT_MUL_KARATSUBA_THRESHOLD) {
+        // schoolbook: add (or subtract) one row a * b[j] at a time straight
+        // into the digits of n
+        n = _bigint_unshare(n);
+        uint32_t n_digits = n->digits;
+        uint32_t digits = (n_digits > an + bn ? n_digits : an + bn) + 1;
+        uint32_t sign_ext = bigint_sgn(n) < 0 ? (uint32_t)-1 : 0;
+        n = _bigint_realloc(n, digits);
+        for (uint32_t i = n_digits; i < digits; ++i)
+            n->num[i] = sign_ext;
+        // the spare digit means this can't overflow
+        for (uint32_t j = 0; j < bn; ++j) {
+            uint32_t *r = n->num + j;
+            if (sign < 0) {
+                uint32_t hi = _bigint_limbs_submul1(r, ad, an, bd[j]);
+                _bigint_limbs_sub_from(r + an, digits - j - an, &hi, 1);
+            } else {
+                uint32_t hi = _bigint_limbs_addmul1(r, ad, an, bd[j]);
+                _bigint_limbs_add_to(r + an, digits - j - an, &hi, 1);
+            }
+        }
+        _bigint_crop(n);
+    } else {
+        // subquadratic multiplication needs the whole product first
+        uint32_t *prod = (uint32_t *)malloc((an + bn) * sizeof(uint32_t));
+        if (a == b) _bigint_sqr_mag(prod, ad, an);
+        else _bigint_mul_mag(prod, ad, an, bd, bn);
+        n = _bigint_add_digits_inplace(n, prod, an + bn, sign);
+        free(prod);
     }
+
+    if (a != a0) bigint_free(a);
+    if (b != b0 && b != a) bigint_free(b);
+    return n;
 }
 
-_BIGINT_INLINE bigint_tp bigint_div(bigint_tp n, bigint_tp d)
+_BIGINT_INLINE bigint_tp bigint_addmul_inplace(bigint_tp n, bigint_tp a, bigint_tp b)
+{
+    // n += a * b; unless both are long, without building a * b at all
+    return _bigint_addmul_mag_inplace(n, a, b, bigint_sgn(a) * bigint_sgn(b));
+}
+
+_BIGINT_INLINE bigint_tp bigint_submul_inplace(bigint_tp n, bigint_tp a, bigint_tp b)
+{
+    // n -= a * b
+    return _bigint_addmul_mag_inplace(n, a, b, -bigint_sgn(a) * bigint_sgn(b));
+}
+
+_BIGINT_INLINE void _bigint_divrem_mag(uint32_t *q, uint32_t *r, const uint32_t *a, uint32_t an,
+                                       const uint32_t *b, uint32_t bn)
+{
+    // Knuth's algorithm D: q[0..an-bn] = a / b and r[0..bn) = a % b, where
+    // an >= bn >= 2 and b[bn-1] != 0. Either q or r may be NULL.
+    uint32_t *un = (uint32_t *)malloc((an + 1 + bn) * sizeof(uint32_t));
+    uint32_t *vn = un + an + 1;
+    uint32_t i;
+
+    // shift both so that the top digit of b has its top bit set
+    int s = 0;
+    while (!((b[bn-1] << s) & BIGINT_SIGN_BIT))
+        s++;
+    for (i = bn - 1; i > 0; --i)
+        vn[i] = (b[i] << s) | (s ? b[i-1] >> (BIGINT_WIDTH_BITS - s) : 0);
+    vn[0] = b[0] << s;
+    un[an] = s ? a[an-1] >> (BIGINT_WIDTH_BITS - s) : 0;
+    for (i = an - 1; i > 0; --i)
+        un[i] = (a[i] << s) | (s ? a[i-1] >> (BIGINT_WIDTH_BITS - s) : 0);
+    un[0] = a[0] << s;
+
+    for (uint32_t j = an - bn + 1; j-- > 0; ) {
+        // estimate the quotient digit from the top two digits; it's at most
+        // one too big after this
+        uint64_t top = ((uint64_t)un[j+bn] << BIGINT_WIDTH_BITS) | un[j+bn-1];
+        uint64_t qhat = top / vn[bn-1];
+        uint64_t rhat = top % vn[bn-1];
+        while (qhat > BIGINT_LOW_MASK
+               || qhat * vn[bn-2] > ((rhat << BIGINT_WIDTH_BITS) | un[j+bn-2])) {
+            qhat--;
+            rhat += vn[bn-1];
+            if (rhat > BIGINT_LOW_MASK) break;
+        }
+
+        // un[j..j+bn] -= qhat * vn
+        uint64_t borrow = 0;
+        for (i = 0; i < bn; ++i) {
+            uint64_t p = qhat * vn[i] + borrow;
+            uint32_t lo = p & BIGINT_LOW_MASK;
+            borrow = p >> BIGINT_WIDTH_BITS;
+            if (un[i+j] < lo) borrow++;
+            un[i+j] -= lo;
+        }
+        if (un[j+bn] < borrow) {
+            // went negative: qhat was one too big, add b back
+            un[j+bn] -= borrow;
+            qhat--;
+            un[j+bn] += _bigint_limbs_add_to(un + j, bn, vn, bn);
+        } else {
+            un[j+bn] -= borrow;
+        }
+        if (q != NULL) q[j] = qhat;
+    }
+
+    if (r != NULL) {
+        // un[bn] is zero by now
+        for (i = 0; i < bn; ++i)
+            r[i] = (un[i] >> s) | (s ? un[i+1] << (BIGINT_WIDTH_BITS - s) : 0);
+    }
+    free(un);
+}
+
+_BIGINT_INLINE bigint_tp bigint_divrem(bigint_tp n, bigint_tp d, bigint_tp *remainder)
 {
+    // rounds to zero; the remainder has the sign of n
+    if (bigint_cmp32(d, 0) == 0) return NULL;
+
     int n_sgn = bigint_sgn(n);
     int d_sgn = bigint_sgn(d);
-    int q_sgn = n_sgn * d_sgn;
+    bigint_tp n_mag = n_sgn < 0 ? bigint_neg_into(NULL, n) : n;
+    bigint_tp d_mag = d_sgn < 0 ? bigint_neg_into(NULL, d) : d;
+    uint32_t an = _bigint_mag_digits(n_mag);
+    uint32_t bn = _bigint_mag_digits(d_mag);
+    bigint_tp q, r;
+
+    if (bn == 1) {
+        uint32_t rem = 0;
+        q = bigint_divrem_1(n_mag, d_mag->num[0], 1, &rem);
+        r = bigint_from_int(rem);
+    } else if (an < bn) {
+        q = bigint_from_int(0);
+        r = _bigint_copy(n_mag);
+    } else {
+        // an extra digit each, so the results are positive
+        q = _bigint_new(an - bn + 2);
+        r = _bigint_new(bn + 1);
+        _bigint_divrem_mag(q->num, r->num, n_mag->num, an, d_mag->num, bn);
+        q->num[an-bn+1] = 0;
+        r->num[bn] = 0;
+        _bigint_crop(q);
+        _bigint_crop(r);
+    }
 
-    // simple cases
+    if (n_mag != n) bigint_free(n_mag);
+    if (d_mag != d) bigint_free(d_mag);
+    if (n_sgn * d_sgn < 0) q = bigint_flipsign(q);
+    if (n_sgn < 0) r = bigint_flipsign(r);
+
+    if (remainder != NULL) *remainder = r;
+    else bigint_free(r);
+    return q;
+}
+
+_BIGINT_INLINE bigint_tp bigint_div(bigint_tp n, bigint_tp d)
+{
+    return bigint_divrem(n, d, NULL);
+}
+
+_BIGINT_INLINE bigint_tp bigint_mod_inplace(bigint_tp n, bigint_tp d)
+{
+    // remainder of the division, with the sign of n
+    bigint_tp r;
+    bigint_tp q = bigint_divrem(n, d, &r);
+    if (q == NULL) return NULL;
+    bigint_free(q);
+    bigint_free(n);
+    return r;
+}
+
+_BIGINT_INLINE bigint_tp bigint_mod(bigint_tp n, bigint_tp d)
+{
     if (bigint_cmp32(d, 0) == 0) return NULL;
-    else if (bigint_cmp32(d, d_sgn) == 0) {
-        if (d_sgn == 1) return bigint_dup(n);
-        else return bigint_flipsign(bigint_dup(n));
-    } else if (d->digits == 1) {
-        return bigint_div32(n, d->num[0], NULL);
-    } else if (q_sgn == 1) {
-        int cmp_result = bigint_cmp(n, d);
-        if (cmp_result == 0) return bigint_from_int(1);
-        else if (cmp_result == -n_sgn) return bigint_from_int(0);
-    } else if (q_sgn == -1) {
-        bigint_tp d2 = bigint_flipsign(bigint_dup(d));
-        int cmp_result = bigint_cmp(n, d2);
-        bigint_free(d2);
-        if (cmp_result == 0) return bigint_from_int(-1);
-        else if (cmp_result == -n_sgn) return bigint_from_int(0);
-    }
 
-    // sad times, we must search!
-    bigint_tp overestimate, underestimate;
-    // make everything positive, this makes the logic simpler
-    if (n_sgn < 0) n = bigint_flipsign(bigint_dup(n));
-    if (d_sgn < 0) d = bigint_flipsign(bigint_dup(d));
+    bigint_tp res = _bigint_copy(n);
+    return bigint_mod_inplace(res, d);
+}
 
-    overestimate = n;
-    underestimate = bigint_from_int(-1);
+_BIGINT_INLINE int32_t _bigint_recip_bits(bigint_tp d)
+{
+    // the reciprocals below are of d > 0 with k digits, scaled by 2^e where
+    // e = 32 (2 k + 2), enough to divide numbers of up to 2 k digits
+    return (2 * _bigint_mag_digits(d) + 2) * BIGINT_WIDTH_BITS;
+}
 
-    bigint_tp q = _bigint_find_quotient(n, d, overestimate, underestimate);
-    if (q_sgn < 0) q = bigint_flipsign(q);
-    bigint_free(underestimate);
-    if (n_sgn < 0) bigint_free(n);
-    if (d_sgn < 0) bigint_free(d);
+_BIGINT_INLINE bigint_tp _bigint_recip_refine(bigint_tp d, bigint_tp x)
+{
+    // One Newton step from x towards 2^e / d: x + x (2^e - d x) / 2^e, which
+    // about doubles the number of correct digits (consumes x)
+    int32_t e = _bigint_recip_bits(d);
+    bigint_tp s = bigint_shift(bigint_from_int(1), e);
+    bigint_tp t = bigint_mul(d, x);
+    t = bigint_rsub_inplace(t, s);
+    bigint_tp u = bigint_shift(bigint_mul(x, t), -e);
+    x = bigint_add_inplace(x, u);
+    bigint_free(s);
+    bigint_free(t);
+    bigint_free(u);
+    return x;
+}
+
+_BIGINT_INLINE bigint_tp _bigint_recip(bigint_tp d)
+{
+    // About 2^e / d, to within a few units: from the reciprocal of the top
+    // k/2 + 4 digits, which is good to about k + 6 digits after one step.
+    uint32_t k = _bigint_mag_digits(d);
+    uint32_t h = k / 2 + 4;
+    if (k < BIGINT_DIV_NEWTON_THRESHOLD || h >= k) {
+        bigint_tp s = bigint_shift(bigint_from_int(1), _bigint_recip_bits(d));
+        bigint_tp x = bigint_div(s, d);
+        bigint_free(s);
+        return x;
+    }
+    bigint_tp top = bigint_shift(bigint_dup(d), -(int32_t)(k - h) * BIGINT_WIDTH_BITS);
+    bigint_tp x = bigint_shift(_bigint_recip(top), (k - h) * BIGINT_WIDTH_BITS);
+    bigint_free(top);
+    return _bigint_recip_refine(d, x);
+}
+
+_BIGINT_INLINE bigint_tp _bigint_divrem_recip(bigint_tp n, bigint_tp d, bigint_tp inv, bigint_tp *r)
+{
+    // n / d and *r = n % d for 0 <= n < 2^(32 k) d, given inv from
+    // _bigint_recip: two multiplications, and then a step or two to fix up
+    // the quotient
+    bigint_tp q = bigint_shift(bigint_mul(n, inv), -_bigint_recip_bits(d));
+    *r = bigint_dup(n);
+    *r = bigint_submul_inplace(*r, q, d);
+    while (bigint_sgn(*r) < 0) {
+        q = bigint_sub32_inplace(q, 1);
+        *r = bigint_add_inplace(*r, d);
+    }
+    while (bigint_cmp(*r, d) >= 0) {
+        q = bigint_add32_inplace(q, 1);
+        *r = bigint_sub_inplace(*r, d);
+    }
     return q;
 }
 
+_BIGINT_INLINE void _bigint_mod_mag(uint32_t *r, const uint32_t *x, uint32_t xn, bigint_tp d)
+{
+    // r[0..k) = x[0..xn) % d, for d > 0 with k >= 2 digits and xn >= k.
+    // Long divisors use the reciprocal, k digits of x at a time from the top.
+    uint32_t k = _bigint_mag_digits(d);
+    if (k < BIGINT_DIV_NEWTON_THRESHOLD) {
+        _bigint_divrem_mag(NULL, r, x, xn, d->num, k);
+        return;
+    }
+
+    bigint_tp inv = _bigint_recip(d);
+    bigint_tp rem = bigint_from_int(0);
+    for (uint32_t end = xn; end > 0; ) {
+        uint32_t len = (end - 1) % k + 1;
+        bigint_tp block = _bigint_new(len + 1);
+        memcpy(block->num, x + end - len, len * sizeof(uint32_t));
+        block->num[len] = 0;
+        _bigint_crop(block);
+        rem = bigint_shift(rem, len * BIGINT_WIDTH_BITS);
+        rem = bigint_add_inplace(rem, block);
+        bigint_free(block);
+
+        bigint_tp next;
+        bigint_free(_bigint_divrem_recip(rem, d, inv, &next));
+        bigint_free(rem);
+        rem = next;
+        end -= len;
+    }
+    uint32_t digits = _bigint_mag_digits(rem);
+    memcpy(r, rem->num, digits * sizeof(uint32_t));
+    memset(r + digits, 0, (k - digits) * sizeof(uint32_t));
+    bigint_free(rem);
+    bigint_free(inv);
+}
+
+_BIGINT_INLINE void _bigint_mod_many_leaf(uint32_t r, const uint32_t *moduli, uint32_t k, uint32_t *out)
+{
+    // r is a remainder modulo the product of moduli[0..k), which fits in a
+    // digit, so the rest is one machine division per modulus
+    for (uint32_t i = 0; i < k; ++i)
+        out[i] = r % moduli[i];
+}
+
+_BIGINT_INLINE bigint_tp _bigint_mod_tree_build(bigint_tp *tree, uint32_t node, const uint32_t *prods,
+                                                uint32_t lo, uint32_t hi)
+{
+    // tree[node] = prods[lo] * ... * prods[hi-1], with the two halves at
+    // 2 node and 2 node + 1
+    if (hi - lo == 1) {
+        tree[node] = bigint_from_int(prods[lo]);
+    } else {
+        uint32_t mid = lo + (hi - lo) / 2;
+        tree[node] = bigint_mul(_bigint_mod_tree_build(tree, 2 * node, prods, lo, mid),
+                                _bigint_mod_tree_build(tree, 2 * node + 1, prods, mid, hi));
+    }
+    return tree[node];
+}
+
+_BIGINT_INLINE void _bigint_mod_tree_descend(bigint_tp *tree, uint32_t node, const uint32_t *x, uint32_t xn,
+                                             const uint32_t *group, uint32_t lo, uint32_t hi,
+                                             const uint32_t *moduli, uint32_t *out)
+{
+    // reduce x[0..xn) modulo tree[node] and hand the remainder down to the
+    // halves; groups lo..hi-1 start at moduli[group[lo]]
+    bigint_tp m = tree[node];
+    uint32_t mn = _bigint_mag_digits(m);
+    while (xn > 0 && x[xn-1] == 0)
+        xn--;
+
+    if (hi - lo == 1 || mn == 1) {
+        struct _bigint_limb_inv inv;
+        _bigint_limb_inv_init(&inv, m->num[0]);
+        uint32_t r = _bigint_limbs_mod_1(x, xn, &inv);
+        for (uint32_t g = lo; g < hi; ++g)
+            _bigint_mod_many_leaf(r, moduli + group[g], group[g+1] - group[g], out + group[g]);
+        return;
+    }
+
+    // if x is shorter than the product, it's already reduced
+    uint32_t *r = NULL;
+    if (xn >= mn) {
+        r = (uint32_t *)malloc(mn * sizeof(uint32_t));
+        _bigint_mod_mag(r, x, xn, m);
+        x = r;
+        xn = mn;
+    }
+    uint32_t mid = lo + (hi - lo) / 2;
+    _bigint_mod_tree_descend(tree, 2 * node, x, xn, group, lo, mid, moduli, out);
+    _bigint_mod_tree_descend(tree, 2 * node + 1, x, xn, group, mid, hi, moduli, out);
+    free(r);
+}
+
+_BIGINT_INLINE int bigint_mod_many(bigint_tp n, const uint32_t *moduli, uint32_t k, uint32_t *out)
+{
+    // out[i] = n mod moduli[i], between 0 and moduli[i] - 1 whatever the
+    // sign of n. Returns -1 (and leaves out alone) if a modulus is 0.
+    for (uint32_t i = 0; i < k; ++i)
+        if (moduli[i] == 0) return -1;
+    if (k == 0) return 0;
+
+    // pack runs of moduli whose product fits in a digit into groups, so
+    // each one only costs a single-digit remainder
+    uint32_t *group = (uint32_t *)malloc((2 * k + 1) * sizeof(uint32_t));
+    uint32_t *prods = group + k + 1;
+    uint32_t groups = 0;
+    for (uint32_t i = 0; i < k; ++i) {
+        if (groups == 0 || (uint64_t)prods[groups-1] * moduli[i] > BIGINT_LOW_MASK) {
+            group[groups] = i;
+            prods[groups++] = moduli[i];
+        } else {
+            prods[groups-1] *= moduli[i];
+        }
+    }
+    group[groups] = k;
+
+    int sign = bigint_sgn(n);
+    bigint_tp a = sign < 0 ? bigint_neg_into(NULL, n) : n;
+    uint32_t an = _bigint_mag_digits(a);
+
+    if (an < BIGINT_MOD_MANY_TREE_THRESHOLD || groups == 1) {
+        // one pass over n per group
+        for (uint32_t g = 0; g < groups; ++g) {
+            struct _bigint_limb_inv inv;
+            _bigint_limb_inv_init(&inv, prods[g]);
+            _bigint_mod_many_leaf(_bigint_limbs_mod_1(a->num, an, &inv),
+                                  moduli + group[g], group[g+1] - group[g], out + group[g]);
+        }
+    } else {
+        // Remainder tree: divide n by the product of all the moduli once,
+        // then the remainder by the products of each half, and so on down
+        // (Bernstein, "Fast multiplication and its applications", 2008).
+        // Below the root, the numbers being divided are no longer than the
+        // divisors' parents.
+        bigint_tp *tree = (bigint_tp *)calloc(4 * groups, sizeof(bigint_tp));
+        _bigint_mod_tree_build(tree, 1, prods, 0, groups);
+        _bigint_mod_tree_descend(tree, 1, a->num, an, group, 0, groups, moduli, out);
+        for (uint32_t i = 0; i < 4 * groups; ++i)
+            if (tree[i] != NULL) bigint_free(tree[i]);
+        free(tree);
+    }
+
+    if (sign < 0) {
+        for (uint32_t i = 0; i < k; ++i)
+            if (out[i] != 0) out[i] = moduli[i] - out[i];
+        bigint_free(a);
+    }
+    free(group);
+    return 0;
+}
+
+_BIGINT_INLINE bigint_tp bigint_gcd(bigint_tp n, bigint_tp m)
+{
+    // Euclid's algorithm; the result is never negative
+    bigint_tp a = bigint_sgn(n) < 0 ? bigint_neg_into(NULL, n) : _bigint_copy(n);
+    bigint_tp b = bigint_sgn(m) < 0 ? bigint_neg_into(NULL, m) : _bigint_copy(m);
+    _bigint_crop(a);
+    _bigint_crop(b);
+
+    while (bigint_cmp32(b, 0) != 0) {
+        if (a->digits <= 2 && b->digits <= 2) {
+            // both fit in 63 bits, finish off in machine integers
+            uint64_t x = a->num[0] | (a->digits > 1 ? (uint64_t)a->num[1] << BIGINT_WIDTH_BITS : 0);
+            uint64_t y = b->num[0] | (b->digits > 1 ? (uint64_t)b->num[1] << BIGINT_WIDTH_BITS : 0);
+            while (y != 0) {
+                uint64_t t = x % y;
+                x = y;
+                y = t;
+            }
+            bigint_free(a);
+            bigint_free(b);
+            return bigint_from_int(x);
+        }
+        bigint_tp r = bigint_mod(a, b);
+        bigint_free(a);
+        a = b;
+        b = r;
+    }
+    bigint_free(b);
+    return a;
+}
+
+_BIGINT_INLINE int _bigint_limbs_cmp(const uint32_t *a, const uint32_t *b, uint32_t n)
+{
+    for (uint32_t i = n; i-- > 0; ) {
+        if (a[i] != b[i]) return a[i] > b[i] ? 1 : -1;
+    }
+    return 0;
+}
+
+_BIGINT_INLINE void _bigint_mont_init(struct _bigint_mont *mont, bigint_tp m)
+{
+    // m odd and positive
+    mont->m = bigint_dup(m);
+    mont->n = _bigint_mag_digits(m);
+    // Newton's iteration for 1/m mod 2^32: every step doubles the correct
+    // bits, and m is its own inverse mod 8
+    uint32_t m0 = m->num[0], inv = m0;
+    for (int i = 0; i < 4; ++i)
+        inv *= 2 - m0 * inv;
+    mont->minv = -inv;
+    mont->tmp = (uint32_t *)malloc((2 * mont->n + 1) * sizeof(uint32_t));
+}
+
+_BIGINT_INLINE void _bigint_mont_free(struct _bigint_mont *mont)
+{
+    bigint_free(mont->m);
+    free(mont->tmp);
+}
+
+_BIGINT_INLINE void _bigint_mont_redc(const struct _bigint_mont *mont, uint32_t *r, uint32_t *t)
+{
+    // r = t / R mod m, where t[0..2n] < m R (Montgomery's REDC). t is
+    // overwritten.
+    uint32_t n = mont->n;
+    const uint32_t *m = mont->m->num;
+    for (uint32_t i = 0; i < n; ++i) {
+        // make the lowest digit vanish
+        uint32_t carry = _bigint_limbs_addmul1(t + i, m, n, t[i] * mont->minv);
+        _bigint_limbs_add_to(t + i + n, n + 1 - i, &carry, 1);
+    }
+    // t / R < 2m now
+    if (t[2*n] != 0 || _bigint_limbs_cmp(t + n, m, n) >= 0)
+        _bigint_limbs_sub_from(t + n, n + 1, m, n);
+    memcpy(r, t + n, n * sizeof(uint32_t));
+}
+
+_BIGINT_INLINE void _bigint_mont_mul(struct _bigint_mont *mont, uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+    // r = a b / R mod m; r may be a or b
+    if (a == b) _bigint_sqr_mag(mont->tmp, a, mont->n);
+    else _bigint_mul_mag(mont->tmp, a, mont->n, b, mont->n);
+    mont->tmp[2 * mont->n] = 0;
+    _bigint_mont_redc(mont, r, mont->tmp);
+}
+
+_BIGINT_INLINE void _bigint_mont_add(const struct _bigint_mont *mont, uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+    // r = a + b mod m; r may be a or b
+    uint32_t n = mont->n;
+    if (r == b) b = a;
+    else if (r != a) memcpy(r, a, n * sizeof(uint32_t));
+    if (_bigint_limbs_add_to(r, n, b, n) != 0 || _bigint_limbs_cmp(r, mont->m->num, n) >= 0)
+        _bigint_limbs_sub_from(r, n, mont->m->num, n);
+}
+
+_BIGINT_INLINE void _bigint_mont_sub(const struct _bigint_mont *mont, uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+    // r = a - b mod m; r may be a, but not b
+    uint32_t n = mont->n;
+    if (r != a) memcpy(r, a, n * sizeof(uint32_t));
+    if (_bigint_limbs_sub_from(r, n, b, n) != 0)
+        _bigint_limbs_add_to(r, n, mont->m->num, n);
+}
+
+_BIGINT_INLINE void _bigint_mont_half(const struct _bigint_mont *mont, uint32_t *r)
+{
+    // r = r / 2 mod m, in place: make r even by adding m if needed
+    uint32_t n = mont->n, carry = 0;
+    if (r[0] & 1) carry = _bigint_limbs_add_to(r, n, mont->m->num, n);
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t next = i + 1 < n ? r[i+1] : carry;
+        r[i] = (r[i] >> 1) | (next << (BIGINT_WIDTH_BITS - 1));
+    }
+}
+
+_BIGINT_INLINE void _bigint_mont_to(struct _bigint_mont *mont, uint32_t *r, bigint_tp x)
+{
+    // r = x R mod m
+    bigint_tp t = bigint_shift(bigint_dup(x), mont->n * BIGINT_WIDTH_BITS);
+    t = bigint_mod_inplace(t, mont->m);
+    if (bigint_sgn(t) < 0) t = bigint_add_inplace(t, mont->m);
+    uint32_t t_digits = _bigint_mag_digits(t);
+    memcpy(r, t->num, t_digits * sizeof(uint32_t));
+    memset(r + t_digits, 0, (mont->n - t_digits) * sizeof(uint32_t));
+    bigint_free(t);
+}
+
+_BIGINT_INLINE bigint_tp _bigint_mont_from(struct _bigint_mont *mont, const uint32_t *a)
+{
+    // a / R mod m as a number
+    uint32_t n = mont->n;
+    bigint_tp res = _bigint_new(n + 1);
+    memcpy(mont->tmp, a, n * sizeof(uint32_t));
+    memset(mont->tmp + n, 0, (n + 1) * sizeof(uint32_t));
+    _bigint_mont_redc(mont, res->num, mont->tmp);
+    res->num[n] = 0;
+    _bigint_crop(res);
+    return res;
+}
+
+_BIGINT_INLINE void _bigint_mont_pow(struct _bigint_mont *mont, uint32_t *r, const uint32_t *a, bigint_tp e)
+{
+    // r = a^e in Montgomery form, e >= 0, left to right in windows of k bits
+    uint32_t n = mont->n;
+    uint32_t e_digits = _bigint_mag_digits(e);
+    uint32_t bits = e_digits * BIGINT_WIDTH_BITS;
+    while (bits > 0 && !((e->num[(bits-1) / BIGINT_WIDTH_BITS] >> ((bits-1) % BIGINT_WIDTH_BITS)) & 1))
+        bits--;
+    uint32_t k = bits < 16 ? 1 : bits < 128 ? 3 : bits < 1024 ? 4 : 5;
+
+    // table[i] = a^i; table[0] = 1 = R mod m
+    uint32_t *table = (uint32_t *)malloc((n << k) * sizeof(uint32_t));
+    bigint_tp one = bigint_from_int(1);
+    _bigint_mont_to(mont, table, one);
+    bigint_free(one);
+    memcpy(table + n, a, n * sizeof(uint32_t));
+    for (uint32_t i = 2; i < (1u << k); ++i)
+        _bigint_mont_mul(mont, table + i*n, table + (i-1)*n, a);
+
+    memcpy(r, table, n * sizeof(uint32_t));
+    // the first window may be shorter, so the rest line up with bit 0
+    uint32_t pos = bits;
+    uint32_t len = bits % k == 0 ? k : bits % k;
+    int first = 1;
+    while (pos > 0) {
+        uint32_t window = 0;
+        for (uint32_t j = 0; j < len; ++j) {
+            --pos;
+            window = (window << 1) | ((e->num[pos / BIGINT_WIDTH_BITS] >> (pos % BIGINT_WIDTH_BITS)) & 1);
+            if (!first) _bigint_mont_mul(mont, r, r, r);
+        }
+        if (first) memcpy(r, table + window*n, n * sizeof(uint32_t));
+        else if (window != 0) _bigint_mont_mul(mont, r, r, table + window*n);
+        first = 0;
+        len = k;
+    }
+    free(table);
+}
+
+_BIGINT_INLINE bigint_tp bigint_powmod(bigint_tp b, bigint_tp e, bigint_tp m)
+{
+    // b^e mod m in [0, m), for e >= 0 and m > 0
+    if (bigint_sgn(e) < 0 || bigint_sgn(m) < 0 || bigint_cmp32(m, 0) == 0) return NULL;
+    if (bigint_cmp32(m, 1) == 0) return bigint_from_int(0);
+
+    if (m->num[0] & 1) {
+        struct _bigint_mont mont;
+        _bigint_mont_init(&mont, m);
+        uint32_t *a = (uint32_t *)malloc(2 * mont.n * sizeof(uint32_t));
+        _bigint_mont_to(&mont, a, b);
+        _bigint_mont_pow(&mont, a + mont.n, a, e);
+        bigint_tp res = _bigint_mont_from(&mont, a + mont.n);
+        free(a);
+        _bigint_mont_free(&mont);
+        return res;
+    }
+
+    // Montgomery needs an odd modulus; square and multiply with divisions
+    bigint_tp base = bigint_mod(b, m);
+    if (bigint_sgn(base) < 0) base = bigint_add_inplace(base, m);
+    bigint_tp res = bigint_from_int(1);
+    for (uint32_t i = _bigint_mag_digits(e) * BIGINT_WIDTH_BITS; i-- > 0; ) {
+        bigint_tp t = bigint_mul(res, res);
+        bigint_free(res);
+        res = bigint_mod_inplace(t, m);
+        if ((e->num[i / BIGINT_WIDTH_BITS] >> (i % BIGINT_WIDTH_BITS)) & 1) {
+            t = bigint_mul(res, base);
+            bigint_free(res);
+            res = bigint_mod_inplace(t, m);
+        }
+    }
+    bigint_free(base);
+    return res;
+}
+
+_BIGINT_INLINE uint32_t *_bigint_fixed_base_entry(bigint_fixed_base_tp fb, uint32_t s, uint32_t i)
+{
+    return fb->table + ((size_t)s << fb->h | i) * fb->mont.n;
+}
+
+_BIGINT_INLINE void _bigint_fixed_base_fill(bigint_fixed_base_tp fb, uint32_t max_bits, uint32_t h, uint32_t v)
+{
+    // sizes and memory for the tables; the contents are up to the caller
+    fb->max_bits = max_bits;
+    fb->h = h;
+    fb->a = (max_bits + h - 1) / h;
+    fb->v = v < fb->a ? v : fb->a;
+    fb->b = (fb->a + fb->v - 1) / fb->v;
+    // with b bits per block, fewer blocks may do (a = 10, v = 6 gives b = 2
+    // and 5 blocks), and a table nobody fills must not be kept around
+    fb->v = (fb->a + fb->b - 1) / fb->b;
+    fb->table = (uint32_t *)malloc(((size_t)fb->v << h) * fb->mont.n * sizeof(uint32_t));
+}
+
+_BIGINT_INLINE bigint_fixed_base_tp bigint_fixed_base_new(bigint_tp g, bigint_tp m, uint32_t max_bits, uint32_t h, uint32_t v)
+{
+    // Lim & Lee, "More flexible exponentiation with precomputation", 1994.
+    // An exponent of h a bits is split into h rows of a bits, and each row
+    // into v blocks of b bits. Table s holds the products of
+    // g^(2^(j a + s b)) for all subsets of the rows j, so one column of
+    // bits across all rows and blocks costs one squaring and v
+    // multiplications. The tables take v 2^h numbers.
+    if (bigint_sgn(m) < 0 || !(m->num[0] & 1) || bigint_cmp32(m, 1) == 0) return NULL;
+    if (max_bits == 0 || h == 0 || h > 16 || v == 0) return NULL;
+
+    bigint_fixed_base_tp fb = (bigint_fixed_base_tp)malloc(sizeof(struct _bigint_fixed_base));
+    _bigint_mont_init(&fb->mont, m);
+    fb->g = bigint_mod(g, m);
+    if (bigint_sgn(fb->g) < 0) fb->g = bigint_add_inplace(fb->g, m);
+    _bigint_fixed_base_fill(fb, max_bits, h, v);
+    uint32_t n = fb->mont.n;
+
+    // the entries for single rows are g^(2^k) for the right k
+    uint32_t *x = (uint32_t *)malloc(n * sizeof(uint32_t));
+    _bigint_mont_to(&fb->mont, x, fb->g);
+    for (uint32_t k = 0; k < fb->h * fb->a; ++k) {
+        uint32_t j = k / fb->a, k_row = k % fb->a;
+        if (k_row % fb->b == 0)
+            memcpy(_bigint_fixed_base_entry(fb, k_row / fb->b, 1u << j), x, n * sizeof(uint32_t));
+        _bigint_mont_mul(&fb->mont, x, x, x);
+    }
+    free(x);
+
+    bigint_tp one = bigint_from_int(1);
+    for (uint32_t s = 0; s < fb->v; ++s) {
+        _bigint_mont_to(&fb->mont, _bigint_fixed_base_entry(fb, s, 0), one);
+        for (uint32_t i = 3; i < (1u << fb->h); ++i) {
+            // everything but the lowest row, times the lowest row
+            uint32_t low = i & -i;
+            if (low != i)
+                _bigint_mont_mul(&fb->mont, _bigint_fixed_base_entry(fb, s, i),
+                                 _bigint_fixed_base_entry(fb, s, i - low), _bigint_fixed_base_entry(fb, s, low));
+        }
+    }
+    bigint_free(one);
+    return fb;
+}
+
+_BIGINT_INLINE void bigint_fixed_base_free(bigint_fixed_base_tp fb)
+{
+    _bigint_mont_free(&fb->mont);
+    bigint_free(fb->g);
+    free(fb->table);
+    free(fb);
+}
+
+_BIGINT_INLINE bigint_tp bigint_fixed_base_pow(bigint_fixed_base_tp fb, bigint_tp e)
+{
+    // g^e mod m for 0 <= e; anything over max_bits bits goes the slow way
+    if (bigint_sgn(e) < 0) return NULL;
+    uint32_t e_bits = _bigint_mag_digits(e) * BIGINT_WIDTH_BITS;
+    while (e_bits > 0 && !((e->num[(e_bits-1) / BIGINT_WIDTH_BITS] >> ((e_bits-1) % BIGINT_WIDTH_BITS)) & 1))
+        e_bits--;
+    if (e_bits > fb->max_bits) return bigint_powmod(fb->g, e, fb->mont.m);
+
+    // our own scratch space, so several threads can share the tables
+    struct _bigint_mont mont = fb->mont;
+    uint32_t n = mont.n;
+    mont.tmp = (uint32_t *)malloc((3 * n + 1) * sizeof(uint32_t));
+    uint32_t *r = mont.tmp + 2 * n + 1;
+    int started = 0;
+    for (uint32_t col = fb->b; col-- > 0; ) {
+        if (started) _bigint_mont_mul(&mont, r, r, r);
+        for (uint32_t s = 0; s < fb->v && s * fb->b + col < fb->a; ++s) {
+            uint32_t i = 0;
+            for (uint32_t j = 0; j < fb->h; ++j) {
+                uint32_t bit = j * fb->a + s * fb->b + col;
+                if (bit < e_bits)
+                    i |= ((e->num[bit / BIGINT_WIDTH_BITS] >> (bit % BIGINT_WIDTH_BITS)) & 1) << j;
+            }
+            if (i == 0) continue;
+            if (started) {
+                _bigint_mont_mul(&mont, r, r, _bigint_fixed_base_entry(fb, s, i));
+            } else {
+                memcpy(r, _bigint_fixed_base_entry(fb, s, i), n * sizeof(uint32_t));
+                started = 1;
+            }
+        }
+    }
+    if (!started) memcpy(r, _bigint_fixed_base_entry(fb, 0, 0), n * sizeof(uint32_t));
+
+    bigint_tp res = _bigint_mont_from(&mont, r);
+    free(mont.tmp);
+    return res;
+}
+
+_BIGINT_INLINE void _bigint_fixed_base_put(unsigned char **p, const uint32_t *words, size_t count)
+{
+    // little endian, whatever the machine
+    for (size_t i = 0; i < count; ++i) {
+        for (int k = 0; k < 4; ++k)
+            *(*p)++ = (unsigned char)(words[i] >> (8 * k));
+    }
+}
+
+_BIGINT_INLINE void _bigint_fixed_base_get(const unsigned char **p, uint32_t *words, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        words[i] = 0;
+        for (int k = 0; k < 4; ++k)
+            words[i] |= (uint32_t)*(*p)++ << (8 * k);
+    }
+}
+
+_BIGINT_INLINE unsigned char *bigint_fixed_base_to_bytes(bigint_fixed_base_tp fb, size_t *size)
+{
+    // header, m, g mod m, and the tables as they are in memory
+    uint32_t n = fb->mont.n;
+    size_t table_words = ((size_t)fb->v << fb->h) * n;
+    *size = (BIGINT_FIXED_BASE_HEADER + 2 * (size_t)n + table_words) * 4;
+    unsigned char *buf = (unsigned char *)malloc(*size), *p = buf;
+
+    uint32_t header[BIGINT_FIXED_BASE_HEADER] = { BIGINT_FIXED_BASE_MAGIC, n, fb->max_bits, fb->h, fb->v };
+    _bigint_fixed_base_put(&p, header, BIGINT_FIXED_BASE_HEADER);
+    _bigint_fixed_base_put(&p, fb->mont.m->num, n);
+    uint32_t g_digits = _bigint_mag_digits(fb->g);
+    _bigint_fixed_base_put(&p, fb->g->num, g_digits);
+    memset(p, 0, (n - g_digits) * 4);
+    p += (n - g_digits) * 4;
+    _bigint_fixed_base_put(&p, fb->table, table_words);
+    return buf;
+}
+
+_BIGINT_INLINE bigint_fixed_base_tp bigint_fixed_base_from_bytes(const unsigned char *buf, size_t size)
+{
+    // NULL if buf doesn't hold tables written by bigint_fixed_base_to_bytes
+    uint32_t header[BIGINT_FIXED_BASE_HEADER];
+    if (size < BIGINT_FIXED_BASE_HEADER * 4) return NULL;
+    _bigint_fixed_base_get(&buf, header, BIGINT_FIXED_BASE_HEADER);
+    uint32_t n = header[1], max_bits = header[2], h = header[3], v = header[4];
+    if (header[0] != BIGINT_FIXED_BASE_MAGIC || n == 0 || max_bits == 0 || h == 0 || h > 16 || v == 0)
+        return NULL;
+    // only a v that _bigint_fixed_base_fill would have kept
+    uint32_t a = (max_bits + h - 1) / h;
+    if (v > a || v != (a + (a + v - 1) / v - 1) / ((a + v - 1) / v)) return NULL;
+    size_t table_words = ((size_t)v << h) * n;
+    if (size != (BIGINT_FIXED_BASE_HEADER + 2 * (size_t)n + table_words) * 4) return NULL;
+
+    // an extra digit each to keep them positive
+    bigint_tp m = _bigint_new(n + 1), g = _bigint_new(n + 1);
+    _bigint_fixed_base_get(&buf, m->num, n);
+    _bigint_fixed_base_get(&buf, g->num, n);
+    m->num[n] = g->num[n] = 0;
+    _bigint_crop(m);
+    _bigint_crop(g);
+    if (_bigint_mag_digits(m) != n || !(m->num[0] & 1) || bigint_cmp32(m, 1) == 0 || bigint_cmp(g, m) >= 0) {
+        bigint_free(m);
+        bigint_free(g);
+        return NULL;
+    }
+
+    bigint_fixed_base_tp fb = (bigint_fixed_base_tp)malloc(sizeof(struct _bigint_fixed_base));
+    _bigint_mont_init(&fb->mont, m);
+    fb->g = g;
+    _bigint_fixed_base_fill(fb, max_bits, h, v);
+    _bigint_fixed_base_get(&buf, fb->table, table_words);
+    bigint_free(m);
+    return fb;
+}
+
 _BIGINT_INLINE bigint_tp _bigint_find_sqrt(bigint_tp n,
                                           bigint_tp overestimate,
                                           bigint_tp underestimate)
@@ -481,56 +1753,611 @@ _BIGINT_INLINE bigint_tp bigint_sqrt(bigint_tp n)
 
 _BIGINT_INLINE char *bigint_to_string(bigint_tp n)
 {
-    int sign = bigint_sgn(n);
-    bigint_tp n2 = bigint_mul32(n, sign);
+    return bigint_to_str_base(n, 10);
+}
 
-    char *s = malloc(2 + 10 * n->digits);
-    // write the number backwards
-    char *p = s;
-    do {
-        int32_t remainder;
-        n2 = bigint_div32_inplace(n2, 10, &remainder);
-        *(p++) = remainder + '0';
-    } while (n2->digits > 1 || n2->num[0] != 0);
+_BIGINT_INLINE bigint_tp bigint_from_string(const char *c)
+{
+    return bigint_from_str_base(c, 10);
+}
 
-    if (sign == -1) *(p++) = '-';
-    *p = '\0';
+_BIGINT_INLINE uint32_t _bigint_char_value(int c)
+{
+    // the digit c stands for in bases up to 36 (in either case), or 36
+    static const uint8_t values[256] = {
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+         0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 36, 36, 36, 36, 36, 36,
+        36, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+        25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 36, 36, 36, 36,
+        36, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+        25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36
+    };
+    return values[(unsigned char)c];
+}
 
-    // reverse
-    char *b = s, *e = (p-1);
-    while (b < e) {
-        char tmp = *b;
-        *(b++) = *e;
-        *(e--) = tmp;
+_BIGINT_INLINE uint32_t _bigint_str_base_chunk(int base, uint32_t *chars)
+{
+    // the biggest power of base that fits a digit, and how many characters
+    // it stands for
+    uint32_t big = base;
+    *chars = 1;
+    while ((uint64_t)big * base <= BIGINT_LOW_MASK) {
+        big *= base;
+        (*chars)++;
     }
+    return big;
+}
 
-    bigint_free(n2);
+_BIGINT_INLINE void _bigint_str_base_powers(uint32_t big, int j, bigint_tp *powers, bigint_tp *invs)
+{
+    // Makes sure powers[0..j] = big^(2^i) are there, and if invs isn't NULL,
+    // their reciprocals (see _bigint_recip) too. Each reciprocal starts out
+    // as the square of the one before, which is nearly as good as the one
+    // Newton step it then needs.
+    for (int i = 0; i <= j; ++i) {
+        if (powers[i] == NULL)
+            powers[i] = i == 0 ? bigint_from_int(big) : bigint_mul(powers[i-1], powers[i-1]);
+        if (invs == NULL || invs[i] != NULL) continue;
+
+        if (i == 0) {
+            invs[0] = _bigint_recip(powers[0]);
+        } else {
+            int32_t shift = _bigint_recip_bits(powers[i]) - 2 * _bigint_recip_bits(powers[i-1]);
+            bigint_tp x = bigint_shift(bigint_mul(invs[i-1], invs[i-1]), shift);
+            invs[i] = _bigint_recip_refine(powers[i], x);
+        }
+    }
+}
 
-    return realloc(s, p - s + 1);
+_BIGINT_INLINE bigint_tp _bigint_from_base_mag(const uint32_t *num, uint32_t digits, uint32_t big, bigint_tp *powers)
+{
+    // num[0..digits) are base big digits, little-endian. Split in two,
+    // hi big^k + lo with k a power of two (as in _bigdec_to_bigint_mag), so
+    // that the powers can be reused.
+    if (digits < BIGINT_FROM_STR_THRESHOLD || digits < 2) {
+        bigint_tp res = _bigint_new(digits + 1);
+        uint32_t used = 1;
+        res->num[0] = 0;
+        for (uint32_t i = digits; i-- > 0; ) {
+            // res = res * big + num[i]
+            uint64_t carry = num[i];
+            for (uint32_t l = 0; l < used; ++l) {
+                uint64_t val = (uint64_t)res->num[l] * big + carry;
+                res->num[l] = val & BIGINT_LOW_MASK;
+                carry = val >> BIGINT_WIDTH_BITS;
+            }
+            if (carry != 0) res->num[used++] = carry;
+        }
+        res->num[used] = 0;
+        res->digits = used + 1;
+        _bigint_crop(res);
+        return res;
+    }
+
+    int j = 0;
+    while ((2u << j) < digits) ++j;
+    uint32_t k = 1u << j;
+    _bigint_str_base_powers(big, j, powers, NULL);
+
+    bigint_tp hi = _bigint_from_base_mag(num + k, digits - k, big, powers);
+    bigint_tp lo = _bigint_from_base_mag(num, k, big, powers);
+    lo = bigint_addmul_inplace(lo, hi, powers[j]);
+    bigint_free(hi);
+    return lo;
 }
 
-_BIGINT_INLINE bigint_tp bigint_from_string(const char *c)
+_BIGINT_INLINE void _bigint_to_base_mag(char *s, size_t width, bigint_tp n, int base,
+                                        bigint_tp *powers, bigint_tp *invs)
+{
+    // Writes n >= 0, which is less than base^width, as exactly width
+    // characters (with leading zeros). Long numbers are split into
+    // hi big^k + lo, with the division done by multiplying with the
+    // reciprocal of big^k and correcting the quotient.
+    const char *chars = "0123456789abcdefghijklmnopqrstuvwxyz";
+    uint32_t c;
+    uint32_t big = _bigint_str_base_chunk(base, &c);
+    uint32_t digits = _bigint_mag_digits(n);
+
+    if (digits < BIGINT_TO_STR_THRESHOLD || digits < 2) {
+        // two chunks per pass over the number, from the end
+        uint32_t *num = (uint32_t *)malloc(digits * sizeof(uint32_t));
+        memcpy(num, n->num, digits * sizeof(uint32_t));
+        struct _bigint_limb_inv inv;
+        _bigint_limb_inv_init(&inv, big);
+        char *p = s + width;
+        while (digits > 1 || num[0] != 0) {
+            uint32_t rems[2];
+            _bigint_limbs_divrem_1(num, num, digits, &inv, 2, rems);
+            while (digits > 1 && num[digits-1] == 0)
+                digits--;
+            for (int i = 0; i < 2; ++i)
+                for (uint32_t l = 0; l < c && p > s; ++l) {
+                    *(--p) = chars[rems[i] % base];
+                    rems[i] /= base;
+                }
+        }
+        memset(s, '0', p - s);
+        free(num);
+        return;
+    }
+
+    // n < big^(2^(j+1)), so the quotient is less than big^(2^j)
+    size_t chunks = (width + c - 1) / c;
+    int j = 0;
+    while (((size_t)2 << j) < chunks) ++j;
+    size_t lo_width = ((size_t)1 << j) * c;
+    _bigint_str_base_powers(big, j, powers, invs);
+
+    bigint_tp r;
+    bigint_tp q = _bigint_divrem_recip(n, powers[j], invs[j], &r);
+    _bigint_to_base_mag(s, width - lo_width, q, base, powers, invs);
+    _bigint_to_base_mag(s + width - lo_width, lo_width, r, base, powers, invs);
+    bigint_free(q);
+    bigint_free(r);
+}
+
+_BIGINT_INLINE void _bigint_to_base_pow2(char *s, size_t len, const uint32_t *num, uint32_t digits, int bits)
+{
+    // s[0..len) = the lowest len characters of num[0..digits) in base
+    // 2^bits, written from the end: every character is some bits of the
+    // number, so no arithmetic is needed
+    const char *chars = "0123456789abcdefghijklmnopqrstuv";
+    char *q = s + len;
+    uint32_t d = 0;
+    if (bits == 4) {
+        // every digit below the top one is exactly 8 characters
+#ifdef __AVX2__
+        const __m256i rev = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                             15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        const __m256i hex = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                             '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                             '0', '1', '2', '3', '4', '5', '6', '7',
+                                             '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+        const __m256i low4 = _mm256_set1_epi8(0x0f);
+        for (; d + 8 < digits; d += 8) {
+            // 8 digits: reverse the bytes so the highest comes first, then
+            // split them into nibbles and look up the characters
+            __m256i x = _mm256_loadu_si256((const __m256i *)(num + d));
+            x = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(x, rev), 0x4e);
+            __m256i hi = _mm256_shuffle_epi8(hex, _mm256_and_si256(_mm256_srli_epi16(x, 4), low4));
+            __m256i lo = _mm256_shuffle_epi8(hex, _mm256_and_si256(x, low4));
+            // unpacking works within 128-bit lanes, so put the lanes back in order
+            __m256i a = _mm256_unpacklo_epi8(hi, lo), b = _mm256_unpackhi_epi8(hi, lo);
+            q -= 64;
+            _mm256_storeu_si256((__m256i *)q, _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)(q + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+#endif
+#ifdef __SSE2__
+        const __m128i low = _mm_set1_epi8(0x0f), nine = _mm_set1_epi8(9);
+        const __m128i zero = _mm_set1_epi8('0'), gap = _mm_set1_epi8('a' - '0' - 10);
+        for (; d + 4 < digits; d += 4) {
+            // the same for 4 digits, without a byte shuffle: reverse the
+            // 32-bit words, the 16-bit halves, and then the bytes
+            __m128i x = _mm_loadu_si128((const __m128i *)(num + d));
+            x = _mm_shuffle_epi32(x, 0x1b);
+            x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xb1), 0xb1);
+            x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), low), lo = _mm_and_si128(x, low);
+            __m128i v[2] = { _mm_unpacklo_epi8(hi, lo), _mm_unpackhi_epi8(hi, lo) };
+            q -= 32;
+            for (int j = 0; j < 2; ++j) {
+                v[j] = _mm_add_epi8(_mm_add_epi8(v[j], zero), _mm_and_si128(_mm_cmpgt_epi8(v[j], nine), gap));
+                _mm_storeu_si128((__m128i *)(q + 16 * j), v[j]);
+            }
+        }
+#endif
+        static const char pairs[513] =
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+        "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+        "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+        "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+        "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+        "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+        "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+        "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+        for (; d + 1 < digits; ++d) {
+            uint32_t w = num[d];
+            q -= 8;
+            memcpy(q, pairs + 2 * (w >> 24), 2);
+            memcpy(q + 2, pairs + 2 * ((w >> 16) & 0xff), 2);
+            memcpy(q + 4, pairs + 2 * ((w >> 8) & 0xff), 2);
+            memcpy(q + 6, pairs + 2 * (w & 0xff), 2);
+        }
+    }
+
+    // a digit at a time, for whatever is left
+    uint32_t mask = (1u << bits) - 1;
+    uint64_t acc = 0;
+    int have = 0;
+    while (q > s) {
+        if (have < bits && d < digits) {
+            acc |= (uint64_t)num[d++] << have;
+            have += BIGINT_WIDTH_BITS;
+        }
+        *--q = chars[acc & mask];
+        acc >>= bits;
+        have -= bits;
+    }
+}
+
+_BIGINT_INLINE int _bigint_from_base_pow2(uint32_t *num, uint32_t digits, const char *c, size_t len, int bits)
 {
-    bigint_tp res = bigint_from_int(0);
+    // num[0..digits) = c[0..len) in base 2^bits, read from the end; -1 if
+    // there's a character that isn't a digit in that base
+    const char *q = c + len;
+    uint32_t d = 0;
+    if (bits == 4) {
+        // 8 characters make a digit
+#ifdef __AVX2__
+        const __m256i rev = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                             15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        for (; q - c >= 64; q -= 64, d += 8) {
+            // 64 characters: their values (x - '0' for digits and
+            // (x | 0x20) - 'a' + 10 for letters) as 64 nibbles...
+            __m256i v[2], bad = _mm256_setzero_si256();
+            for (int j = 0; j < 2; ++j) {
+                __m256i x = _mm256_loadu_si256((const __m256i *)(q - 64 + 32 * j));
+                __m256i dig = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+                __m256i let = _mm256_sub_epi8(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+                // unsigned < by way of signed >, with the top bit flipped
+                __m256i is_dig = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 10),
+                                                   _mm256_xor_si256(dig, _mm256_set1_epi8(-128)));
+                __m256i is_let = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 6),
+                                                   _mm256_xor_si256(let, _mm256_set1_epi8(-128)));
+                bad = _mm256_or_si256(bad, _mm256_cmpeq_epi8(_mm256_or_si256(is_dig, is_let), _mm256_setzero_si256()));
+                v[j] = _mm256_or_si256(_mm256_and_si256(is_dig, dig),
+                                       _mm256_and_si256(is_let, _mm256_add_epi8(let, _mm256_set1_epi8(10))));
+                // ...then pairs of them as bytes, in the low half of each 16 bits
+                v[j] = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(v[j], 4), _mm256_srli_epi16(v[j], 8)),
+                                        _mm256_set1_epi16(0xff));
+            }
+            if (_mm256_movemask_epi8(bad) != 0) return -1;
+            // packing works within 128-bit lanes, so the 64-bit quarters
+            // come out as bytes 0-7, 16-23, 8-15, 24-31; after reversing each
+            // lane, quarters 2, 0, 3, 1 put all 32 bytes in reverse order
+            __m256i x = _mm256_shuffle_epi8(_mm256_packus_epi16(v[0], v[1]), rev);
+            _mm256_storeu_si256((__m256i *)(num + d), _mm256_permute4x64_epi64(x, 0x72));
+        }
+#endif
+#ifdef __SSE2__
+        for (; q - c >= 32; q -= 32, d += 4) {
+            // the same for 32 characters
+            __m128i v[2], bad = _mm_setzero_si128();
+            for (int j = 0; j < 2; ++j) {
+                __m128i x = _mm_loadu_si128((const __m128i *)(q - 32 + 16 * j));
+                __m128i dig = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+                __m128i let = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+                __m128i is_dig = _mm_cmplt_epi8(_mm_xor_si128(dig, _mm_set1_epi8(-128)), _mm_set1_epi8(-128 + 10));
+                __m128i is_let = _mm_cmplt_epi8(_mm_xor_si128(let, _mm_set1_epi8(-128)), _mm_set1_epi8(-128 + 6));
+                bad = _mm_or_si128(bad, _mm_cmpeq_epi8(_mm_or_si128(is_dig, is_let), _mm_setzero_si128()));
+                v[j] = _mm_or_si128(_mm_and_si128(is_dig, dig),
+                                    _mm_and_si128(is_let, _mm_add_epi8(let, _mm_set1_epi8(10))));
+                v[j] = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(v[j], 4), _mm_srli_epi16(v[j], 8)),
+                                     _mm_set1_epi16(0xff));
+            }
+            if (_mm_movemask_epi8(bad) != 0) return -1;
+            // reverse the bytes as in _bigint_to_base_pow2
+            __m128i x = _mm_packus_epi16(v[0], v[1]);
+            x = _mm_shuffle_epi32(x, 0x1b);
+            x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xb1), 0xb1);
+            x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+            _mm_storeu_si128((__m128i *)(num + d), x);
+        }
+#endif
+        for (; q - c >= 8; q -= 8) {
+            uint32_t w = 0, seen = 0;
+            for (int i = 8; i > 0; --i) {
+                uint32_t v = _bigint_char_value(q[-i]);
+                seen |= v;
+                w = (w << 4) | (v & 0xf);
+            }
+            // a value of 16 or more has a higher bit set
+            if (seen > 0xf) return -1;
+            num[d++] = w;
+        }
+    }
+
+    // collect the bits of the characters that are left
+    uint64_t acc = 0;
+    int have = 0;
+    while (q > c) {
+        uint32_t v = _bigint_char_value(*--q);
+        if (v >> bits) return -1;
+        acc |= (uint64_t)v << have;
+        have += bits;
+        if (have >= BIGINT_WIDTH_BITS) {
+            num[d++] = acc & BIGINT_LOW_MASK;
+            acc >>= BIGINT_WIDTH_BITS;
+            have -= BIGINT_WIDTH_BITS;
+        }
+    }
+    for (; d < digits; acc = 0)
+        num[d++] = acc;
+    return 0;
+}
+
+_BIGINT_INLINE char *bigint_to_str_base(bigint_tp n, int base)
+{
+    // lower case letters for digits above 9; NULL unless 2 <= base <= 36
+    if (base < 2 || base > 36) return NULL;
+    int sign = bigint_sgn(n);
+    bigint_tp m = sign < 0 ? bigint_neg_into(NULL, n) : n;
+    uint32_t digits = _bigint_mag_digits(m);
+    char *s;
+    size_t len;
+
+    int bits = 0;
+    while ((1 << bits) < base) ++bits;
+    if ((1 << bits) == base) {
+        // count the bits, so that there are no leading zeros
+        uint32_t top = m->num[digits-1];
+        uint64_t n_bits = (uint64_t)(digits - 1) * BIGINT_WIDTH_BITS;
+        while (top != 0) {
+            n_bits++;
+            top >>= 1;
+        }
+        len = n_bits == 0 ? 1 : (n_bits + bits - 1) / bits;
+        s = (char *)malloc(len + 2);
+        _bigint_to_base_pow2(s + (sign < 0), len, m->num, digits, bits);
+    } else {
+        // m < 2^(32 digits) <= big^chunks as long as 2^lb <= big
+        uint32_t c, lb = 0;
+        uint32_t big = _bigint_str_base_chunk(base, &c);
+        while ((big >> lb) > 1)
+            lb++;
+        size_t width = (((size_t)digits * BIGINT_WIDTH_BITS + lb - 1) / lb) * c;
+        s = (char *)malloc(width + 2);
+        bigint_tp powers[32] = {0}, invs[32] = {0};
+        _bigint_to_base_mag(s + 1, width, m, base, powers, invs);
+        for (int j = 0; j < 32; ++j) {
+            if (powers[j] != NULL) bigint_free(powers[j]);
+            if (invs[j] != NULL) bigint_free(invs[j]);
+        }
+        // drop the leading zeros, and make room for the sign
+        size_t zeros = 0;
+        while (zeros + 1 < width && s[1 + zeros] == '0')
+            zeros++;
+        len = width - zeros;
+        memmove(s + (sign < 0), s + 1 + zeros, len);
+    }
+
+    if (sign < 0) {
+        s[0] = '-';
+        bigint_free(m);
+    }
+    s[len + (sign < 0)] = '\0';
+    return (char *)realloc(s, len + (sign < 0) + 1);
+}
+
+_BIGINT_INLINE bigint_tp bigint_from_str_base(const char *c, int base)
+{
+    // digits above 9 are letters, in either case; NULL if there's anything
+    // else in c, or unless 2 <= base <= 36
+    if (base < 2 || base > 36) return NULL;
     int is_negative = 0;
     if (*c == '-') {
         is_negative = 1;
         c++;
     }
-    for (; *c; ++c) {
-        res = bigint_mul32_inplace(res, 10);
-        int i = *c - '0';
-        if (i < 0 || i > 9) {
+    size_t len = strlen(c);
+    bigint_tp res;
+
+    int bits = 0;
+    while ((1 << bits) < base) ++bits;
+    if ((1 << bits) == base) {
+        res = _bigint_new((len * bits + BIGINT_WIDTH_BITS - 1) / BIGINT_WIDTH_BITS + 1);
+        if (_bigint_from_base_pow2(res->num, res->digits, c, len, bits) != 0) {
             // error!
             bigint_free(res);
             return NULL;
         }
-        res = bigint_add32_inplace(res, i);
+    } else {
+        // chunks of c characters, starting from the end, are the base big
+        // digits of the number
+        uint32_t chars;
+        uint32_t big = _bigint_str_base_chunk(base, &chars);
+        uint32_t digits = (len + chars - 1) / chars;
+        uint32_t *num = (uint32_t *)malloc((digits + 1) * sizeof(uint32_t));
+        const char *end = c + len;
+        for (uint32_t i = 0; i < digits; ++i) {
+            const char *start = (size_t)(end - c) > chars ? end - chars : c;
+            uint32_t val = 0;
+            for (const char *p = start; p < end; ++p) {
+                uint32_t v = _bigint_char_value(*p);
+                if (v >= (uint32_t)base) {
+                    // error!
+                    free(num);
+                    return NULL;
+                }
+                val = val * base + v;
+            }
+            num[i] = val;
+            end = start;
+        }
+        if (digits == 0) num[digits++] = 0;
+
+        bigint_tp powers[32] = {0};
+        res = _bigint_from_base_mag(num, digits, big, powers);
+        for (int j = 0; j < 32; ++j)
+            if (powers[j] != NULL) bigint_free(powers[j]);
+        free(num);
     }
+
+    _bigint_crop(res);
     if (is_negative) res = bigint_flipsign(res);
     return res;
 }
 
+_BIGINT_INLINE uint32_t _bigint_cropped_digits(bigint_tp n)
+{
+    // what n->digits would be after _bigint_crop(n)
+    uint32_t digits = n->digits;
+    while (digits > 1
+        && ((n->num[digits-1] == 0 && !(n->num[digits-2] & BIGINT_SIGN_BIT))
+            || (n->num[digits-1] == (uint32_t)-1l && (n->num[digits-2] & BIGINT_SIGN_BIT))))
+                digits--;
+    return digits;
+}
+
+_BIGINT_INLINE uint64_t _bigint_hash_mix(uint64_t a, uint64_t b)
+{
+    // full 64x64 -> 128 bit product, folded (as in wyhash)
+#ifdef __SIZEOF_INT128__
+    _bigint_uint128_t r = (_bigint_uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t a_lo = a & BIGINT_LOW_MASK, a_hi = a >> BIGINT_WIDTH_BITS;
+    uint64_t b_lo = b & BIGINT_LOW_MASK, b_hi = b >> BIGINT_WIDTH_BITS;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> BIGINT_WIDTH_BITS) + (lh & BIGINT_LOW_MASK) + (hl & BIGINT_LOW_MASK);
+    uint64_t lo = (ll & BIGINT_LOW_MASK) | (mid << BIGINT_WIDTH_BITS);
+    uint64_t hi = hh + (lh >> BIGINT_WIDTH_BITS) + (hl >> BIGINT_WIDTH_BITS) + (mid >> BIGINT_WIDTH_BITS);
+    return lo ^ hi;
+#endif
+}
+
+_BIGINT_INLINE uint64_t bigint_hash_seed(bigint_tp n, uint64_t seed)
+{
+    // wyhash-style hash over the digits, two digits to a word. Only the
+    // cropped digits count, so equal numbers always hash the same.
+    static const uint64_t s0 = 0xa0761d6478bd642full, s1 = 0xe7037ed1a0b428dbull,
+                          s2 = 0x8ebc6af09c88c6e3ull, s3 = 0x589965cc75374cc3ull;
+    uint32_t digits = _bigint_cropped_digits(n);
+    const uint32_t *p = n->num;
+#define _BIGINT_WORD(i) ((uint64_t)p[i] | ((uint64_t)p[(i)+1] << BIGINT_WIDTH_BITS))
+
+    seed ^= _bigint_hash_mix(seed ^ s0, s1);
+    uint32_t i = 0;
+    if (digits >= 8) {
+        // two independent lanes, 32 bytes per round
+        uint64_t seed2 = seed;
+        for (; i + 8 <= digits; i += 8) {
+            seed = _bigint_hash_mix(_BIGINT_WORD(i) ^ s1, _BIGINT_WORD(i+2) ^ seed);
+            seed2 = _bigint_hash_mix(_BIGINT_WORD(i+4) ^ s2, _BIGINT_WORD(i+6) ^ seed2);
+        }
+        seed ^= seed2;
+    }
+    for (; i + 4 <= digits; i += 4)
+        seed = _bigint_hash_mix(_BIGINT_WORD(i) ^ s1, _BIGINT_WORD(i+2) ^ seed);
+
+    uint64_t a = 0, b = 0;
+    switch (digits - i) {
+    case 3: b = p[i+2]; // fall through
+    case 2: a = _BIGINT_WORD(i); break;
+    case 1: a = p[i]; break;
+    }
+#undef _BIGINT_WORD
+    return _bigint_hash_mix(s3 ^ digits, _bigint_hash_mix(a ^ s1, b ^ seed));
+}
+
+_BIGINT_INLINE uint64_t bigint_hash(bigint_tp n)
+{
+    return bigint_hash_seed(n, 0);
+}
+
+_BIGINT_INLINE bigint_intern_tp bigint_intern_new(void)
+{
+    bigint_intern_tp t = (bigint_intern_tp)malloc(sizeof(struct _bigint_intern));
+    for (int i = 0; i < BIGINT_INTERN_SEGMENTS; ++i) {
+        struct _bigint_intern_segment *seg = &t->segments[i];
+        pthread_mutex_init(&seg->lock, NULL);
+        seg->n_buckets = BIGINT_INTERN_INITIAL_BUCKETS;
+        seg->count = 0;
+        seg->buckets = (struct _bigint_intern_entry **)calloc(seg->n_buckets, sizeof(struct _bigint_intern_entry *));
+    }
+    return t;
+}
+
+_BIGINT_INLINE void bigint_intern_free(bigint_intern_tp t)
+{
+    for (int i = 0; i < BIGINT_INTERN_SEGMENTS; ++i) {
+        struct _bigint_intern_segment *seg = &t->segments[i];
+        for (uint32_t b = 0; b < seg->n_buckets; ++b) {
+            struct _bigint_intern_entry *e = seg->buckets[b];
+            while (e != NULL) {
+                struct _bigint_intern_entry *next = e->next;
+                bigint_free(e->n);
+                free(e);
+                e = next;
+            }
+        }
+        free(seg->buckets);
+        pthread_mutex_destroy(&seg->lock);
+    }
+    free(t);
+}
+
+_BIGINT_INLINE void _bigint_intern_grow(struct _bigint_intern_segment *seg)
+{
+    uint32_t n_buckets = seg->n_buckets * 2;
+    struct _bigint_intern_entry **buckets =
+        (struct _bigint_intern_entry **)calloc(n_buckets, sizeof(struct _bigint_intern_entry *));
+    for (uint32_t b = 0; b < seg->n_buckets; ++b) {
+        struct _bigint_intern_entry *e = seg->buckets[b];
+        while (e != NULL) {
+            struct _bigint_intern_entry *next = e->next;
+            uint32_t idx = e->hash & (n_buckets - 1);
+            e->next = buckets[idx];
+            buckets[idx] = e;
+            e = next;
+        }
+    }
+    free(seg->buckets);
+    seg->buckets = buckets;
+    seg->n_buckets = n_buckets;
+}
+
+_BIGINT_INLINE bigint_tp bigint_intern(bigint_intern_tp t, bigint_tp n)
+{
+    // Takes over n, and returns the table's copy of the number, which stays
+    // valid until the table is freed. Don't modify or free it.
+    // the table stores numbers cropped, so that bigint_cmp works on them
+    if (_bigint_cropped_digits(n) != n->digits) {
+        n = _bigint_unshare(n);
+        _bigint_crop(n);
+    }
+
+    uint64_t hash = bigint_hash(n);
+    // the segment comes from the high bits, the bucket from the low bits
+    struct _bigint_intern_segment *seg = &t->segments[(hash >> 32) % BIGINT_INTERN_SEGMENTS];
+
+    // a mutex, not a spin lock: comparing long numbers or growing the
+    // segment can keep it for a while
+    pthread_mutex_lock(&seg->lock);
+
+    struct _bigint_intern_entry **bucket = &seg->buckets[hash & (seg->n_buckets - 1)];
+    for (struct _bigint_intern_entry *e = *bucket; e != NULL; e = e->next) {
+        if (e->hash == hash && (e->n == n || bigint_cmp(e->n, n) == 0)) {
+            bigint_tp canonical = e->n;
+            pthread_mutex_unlock(&seg->lock);
+            if (canonical != n) bigint_free(n);
+            return canonical;
+        }
+    }
+
+    struct _bigint_intern_entry *e = (struct _bigint_intern_entry *)malloc(sizeof(struct _bigint_intern_entry));
+    e->hash = hash;
+    e->n = n;
+    e->next = *bucket;
+    *bucket = e;
+    if (++seg->count > seg->n_buckets)
+        _bigint_intern_grow(seg);
+
+    pthread_mutex_unlock(&seg->lock);
+    return n;
+}
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,46 @@
+/* bigint library - bigint_prime.h
+   Primality testing: function declarations / public interface.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGINT_PRIME_H_
+#define _BIGINT_PRIME_H_
+
+#include "bigint.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* bigint_probab_prime() returns 0 for composite numbers, 2 for numbers
+   known to be prime, and 1 for numbers that passed a Baillie-PSW test (no
+   composite number passing it is known). reps > 1 adds reps - 1 rounds of
+   Miller-Rabin with random bases on top. */
+inline int bigint_probab_prime(bigint_tp n, int reps);
+inline bigint_tp bigint_nextprime(bigint_tp n);
+inline void bigint_probab_prime_batch(bigint_tp *ns, uint32_t count, int reps, int *results, int threads);
+
+struct _bigint_prime_batch {
+    bigint_tp *ns;
+    int *results;
+    uint32_t count;
+    uint32_t next;      // the next number nobody has taken yet
+    int reps;
+};
+
+inline const uint16_t *_bigint_small_primes(void);
+inline void _bigint_prime_sieve_rems(bigint_tp n, uint32_t *rems);
+inline int _bigint_prime_trial(bigint_tp n);
+inline int _bigint_prime_jacobi(int32_t d, bigint_tp n);
+inline int _bigint_prime_miller_rabin(struct _bigint_mont *mont, bigint_tp base, bigint_tp d, uint32_t s);
+inline int _bigint_prime_lucas(struct _bigint_mont *mont, int32_t d);
+inline int _bigint_prime_bpsw(bigint_tp n, int reps);
+inline void *_bigint_prime_batch_worker(void *arg);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#include "bigint_prime_impl.h"
+
+#endif /* _BIGINT_PRIME_H_ */
@@ -0,0 +1,337 @@
+/* bigint library - bigint_prime_impl.h
+   Primality testing: function definitions (all inline).
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGINT_PRIME_IMPL_H_
+#define _BIGINT_PRIME_IMPL_H_
+
+#include "bigint_prime.h"
+#include "bigfloat.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// the odd primes below 1000, and the first prime after them
+#define _BIGINT_SMALL_PRIMES 167
+#define _BIGINT_SMALL_PRIMES_NEXT 1009
+
+// odd candidates bigint_nextprime sieves at a time
+#define _BIGINT_NEXTPRIME_WINDOW 2048
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+_BIGINT_INLINE const uint16_t *_bigint_small_primes(void)
+{
+    static const uint16_t primes[_BIGINT_SMALL_PRIMES] = {
+        3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47,
+        53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109,
+        113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191,
+        193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269,
+        271, 277, 281, 283, 293, 307, 311, 313, 317, 331, 337, 347, 349, 353,
+        359, 367, 373, 379, 383, 389, 397, 401, 409, 419, 421, 431, 433, 439,
+        443, 449, 457, 461, 463, 467, 479, 487, 491, 499, 503, 509, 521, 523,
+        541, 547, 557, 563, 569, 571, 577, 587, 593, 599, 601, 607, 613, 617,
+        619, 631, 641, 643, 647, 653, 659, 661, 673, 677, 683, 691, 701, 709,
+        719, 727, 733, 739, 743, 751, 757, 761, 769, 773, 787, 797, 809, 811,
+        821, 823, 827, 829, 839, 853, 857, 859, 863, 877, 881, 883, 887, 907,
+        911, 919, 929, 937, 941, 947, 953, 967, 971, 977, 983, 991, 997,
+    };
+    return primes;
+}
+
+_BIGINT_INLINE void _bigint_prime_sieve_rems(bigint_tp n, uint32_t *rems)
+{
+    // n mod p for all the small primes, n >= 0. Several primes at a time go
+    // into one digit, so we only run over n once per group.
+    const uint16_t *primes = _bigint_small_primes();
+    uint32_t digits = _bigint_mag_digits(n);
+    uint32_t i = 0;
+    while (i < _BIGINT_SMALL_PRIMES) {
+        uint32_t prod = primes[i], j = i + 1;
+        while (j < _BIGINT_SMALL_PRIMES && (uint64_t)prod * primes[j] <= UINT32_MAX)
+            prod *= primes[j++];
+        struct _bigint_limb_inv inv;
+        _bigint_limb_inv_init(&inv, prod);
+        uint32_t rem = _bigint_limbs_mod_1(n->num, digits, &inv);
+        for (; i < j; ++i)
+            rems[i] = rem % primes[i];
+    }
+}
+
+_BIGINT_INLINE int _bigint_prime_trial(bigint_tp n)
+{
+    // 0 if n has a small factor (or n < 2), 2 if that proves it's prime,
+    // 1 if we don't know
+    if (bigint_cmp32(n, 2) < 0) return 0;
+    if (!(n->num[0] & 1)) return bigint_cmp32(n, 2) == 0 ? 2 : 0;
+
+    const uint16_t *primes = _bigint_small_primes();
+    uint32_t rems[_BIGINT_SMALL_PRIMES];
+    _bigint_prime_sieve_rems(n, rems);
+    for (uint32_t i = 0; i < _BIGINT_SMALL_PRIMES; ++i) {
+        if (rems[i] == 0) return bigint_cmp32(n, primes[i]) == 0 ? 2 : 0;
+    }
+    // a composite number has a factor no bigger than its square root
+    if (bigint_cmp32(n, _BIGINT_SMALL_PRIMES_NEXT * _BIGINT_SMALL_PRIMES_NEXT) < 0) return 2;
+    return 1;
+}
+
+_BIGINT_INLINE int _bigint_prime_jacobi(int32_t d, bigint_tp n)
+{
+    // Jacobi symbol (d/n) for odd d and odd n > 0
+    int j = 1;
+    uint32_t a = d < 0 ? -(uint32_t)d : (uint32_t)d;
+    uint32_t n_low = n->num[0];
+    if (d < 0 && (n_low & 3) == 3) j = -j;
+    // quadratic reciprocity: (a/n) = (n/a), unless both are 3 mod 4
+    if ((a & 3) == 3 && (n_low & 3) == 3) j = -j;
+
+    struct _bigint_limb_inv inv;
+    _bigint_limb_inv_init(&inv, a);
+    uint32_t b = _bigint_limbs_mod_1(n->num, _bigint_mag_digits(n), &inv);
+    // (b/a) with machine integers
+    while (b != 0) {
+        while (!(b & 1)) {
+            b >>= 1;
+            if ((a & 7) == 3 || (a & 7) == 5) j = -j;
+        }
+        uint32_t t = a;
+        a = b;
+        b = t;
+        if ((a & 3) == 3 && (b & 3) == 3) j = -j;
+        b %= a;
+    }
+    return a == 1 ? j : 0;
+}
+
+_BIGINT_INLINE int _bigint_prime_miller_rabin(struct _bigint_mont *mont, bigint_tp base, bigint_tp d, uint32_t s)
+{
+    // strong probable prime test to the given base, where m - 1 = d 2^s
+    uint32_t n = mont->n;
+    uint32_t *x = (uint32_t *)malloc(4 * n * sizeof(uint32_t));
+    uint32_t *one = x + n, *minus_one = x + 2*n, *a = x + 3*n;
+    bigint_tp t = bigint_from_int(1);
+    _bigint_mont_to(mont, one, t);
+    bigint_free(t);
+    memset(minus_one, 0, n * sizeof(uint32_t));
+    _bigint_mont_sub(mont, minus_one, minus_one, one);
+
+    _bigint_mont_to(mont, a, base);
+    _bigint_mont_pow(mont, x, a, d);
+    int res = _bigint_limbs_cmp(x, one, n) == 0 || _bigint_limbs_cmp(x, minus_one, n) == 0;
+    for (uint32_t i = 1; i < s && !res; ++i) {
+        _bigint_mont_mul(mont, x, x, x);
+        if (_bigint_limbs_cmp(x, minus_one, n) == 0) res = 1;
+        // 1 without -1 first: we've found a square root of 1 that isn't +-1
+        else if (_bigint_limbs_cmp(x, one, n) == 0) break;
+    }
+    free(x);
+    return res;
+}
+
+_BIGINT_INLINE int _bigint_prime_lucas(struct _bigint_mont *mont, int32_t d)
+{
+    // strong Lucas probable prime test with P = 1, Q = (1 - d) / 4, where
+    // (d/m) = -1. With m + 1 = k 2^s, m passes if U_k = 0, or V_(k 2^r) = 0
+    // for some r < s (everything mod m).
+    uint32_t n = mont->n;
+    uint32_t *u = (uint32_t *)malloc(7 * n * sizeof(uint32_t));
+    uint32_t *v = u + n, *qk = u + 2*n, *q = u + 3*n, *dd = u + 4*n, *t = u + 5*n, *zero = u + 6*n;
+    bigint_tp c = bigint_from_int((1 - d) / 4);
+    _bigint_mont_to(mont, q, c);
+    bigint_free(c);
+    c = bigint_from_int(d);
+    _bigint_mont_to(mont, dd, c);
+    bigint_free(c);
+
+    bigint_tp k = bigint_add32(mont->m, 1);
+    uint32_t s = 0;
+    while (!((k->num[s / BIGINT_WIDTH_BITS] >> (s % BIGINT_WIDTH_BITS)) & 1))
+        s++;
+    k = bigint_shift(k, -(int32_t)s);
+
+    // U_1 = 1, V_1 = P = 1, and go through the bits of k from the top:
+    // U_2j = U_j V_j, V_2j = V_j^2 - 2 Q^j,
+    // U_(j+1) = (P U_j + V_j) / 2, V_(j+1) = (D U_j + P V_j) / 2
+    c = bigint_from_int(1);
+    _bigint_mont_to(mont, u, c);
+    bigint_free(c);
+    memcpy(v, u, n * sizeof(uint32_t));
+    memcpy(qk, q, n * sizeof(uint32_t));
+    uint32_t bits = _bigint_mag_digits(k) * BIGINT_WIDTH_BITS;
+    while (!((k->num[(bits-1) / BIGINT_WIDTH_BITS] >> ((bits-1) % BIGINT_WIDTH_BITS)) & 1))
+        bits--;
+    for (uint32_t i = bits - 1; i-- > 0; ) {
+        _bigint_mont_mul(mont, u, u, v);
+        _bigint_mont_add(mont, t, qk, qk);
+        _bigint_mont_mul(mont, v, v, v);
+        _bigint_mont_sub(mont, v, v, t);
+        _bigint_mont_mul(mont, qk, qk, qk);
+        if ((k->num[i / BIGINT_WIDTH_BITS] >> (i % BIGINT_WIDTH_BITS)) & 1) {
+            _bigint_mont_add(mont, t, u, v);
+            _bigint_mont_mul(mont, u, dd, u);
+            _bigint_mont_add(mont, v, u, v);
+            _bigint_mont_half(mont, v);
+            memcpy(u, t, n * sizeof(uint32_t));
+            _bigint_mont_half(mont, u);
+            _bigint_mont_mul(mont, qk, qk, q);
+        }
+    }
+    bigint_free(k);
+
+    memset(zero, 0, n * sizeof(uint32_t));
+    int res = _bigint_limbs_cmp(u, zero, n) == 0 || _bigint_limbs_cmp(v, zero, n) == 0;
+    for (uint32_t r = 1; r < s && !res; ++r) {
+        _bigint_mont_add(mont, t, qk, qk);
+        _bigint_mont_mul(mont, v, v, v);
+        _bigint_mont_sub(mont, v, v, t);
+        _bigint_mont_mul(mont, qk, qk, qk);
+        res = _bigint_limbs_cmp(v, zero, n) == 0;
+    }
+    free(u);
+    return res;
+}
+
+_BIGINT_INLINE int _bigint_prime_bpsw(bigint_tp n, int reps)
+{
+    // Baillie-PSW for an odd n without small factors, plus reps - 1 rounds
+    // of Miller-Rabin
+    struct _bigint_mont mont;
+    _bigint_mont_init(&mont, n);
+    bigint_tp d = bigint_add32(n, -1);
+    uint32_t s = 0;
+    while (!((d->num[s / BIGINT_WIDTH_BITS] >> (s % BIGINT_WIDTH_BITS)) & 1))
+        s++;
+    d = bigint_shift(d, -(int32_t)s);
+
+    bigint_tp base = bigint_from_int(2);
+    int res = _bigint_prime_miller_rabin(&mont, base, d, s);
+    bigint_free(base);
+
+    if (res) {
+        // Selfridge: the first of 5, -7, 9, -11, ... with (D/n) = -1. There
+        // is none if n is a square, so check that if it takes a while.
+        int32_t dd = 5;
+        for (int i = 0; res; ++i) {
+            int j = _bigint_prime_jacobi(dd, n);
+            if (j == -1) break;
+            // |D| < n shares a factor with n
+            if (j == 0) res = 0;
+            if (i == 5) {
+                int inexact;
+                bigint_free(_bigfloat_sqrtrem_mag(n, &inexact));
+                if (!inexact) res = 0;
+            }
+            dd = dd > 0 ? -(dd + 2) : -dd + 2;
+        }
+        if (res) res = _bigint_prime_lucas(&mont, dd);
+    }
+
+    // pseudo-random bases in [2, n - 2], the same ones for the same n
+    uint64_t state = bigint_hash(n) | 1;
+    bigint_tp n3 = bigint_add32(n, -3);
+    for (int i = 1; i < reps && res; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        base = bigint_from_int(state >> 1);
+        base = bigint_mod_inplace(base, n3);
+        base = bigint_add32_inplace(base, 2);
+        res = _bigint_prime_miller_rabin(&mont, base, d, s);
+        bigint_free(base);
+    }
+    bigint_free(n3);
+    bigint_free(d);
+    _bigint_mont_free(&mont);
+    return res;
+}
+
+_BIGINT_INLINE int bigint_probab_prime(bigint_tp n, int reps)
+{
+    int res = _bigint_prime_trial(n);
+    if (res != 1) return res;
+    return _bigint_prime_bpsw(n, reps);
+}
+
+_BIGINT_INLINE bigint_tp bigint_nextprime(bigint_tp n)
+{
+    // the smallest (probable) prime > n
+    if (bigint_cmp32(n, 2) < 0) return bigint_from_int(2);
+    bigint_tp c = bigint_add32(n, 1);
+    if (!(c->num[0] & 1)) c = bigint_add32_inplace(c, 1);
+
+    // for small numbers, trial division is all we need
+    while (bigint_cmp32(c, _BIGINT_SMALL_PRIMES_NEXT * _BIGINT_SMALL_PRIMES_NEXT) < 0) {
+        if (_bigint_prime_trial(c) == 2) return c;
+        c = bigint_add32_inplace(c, 2);
+    }
+
+    // Sieve the odd numbers c + 2i in a window: c + 2i = 0 mod p where
+    // i = -c / 2 mod p. Only what's left goes through BPSW.
+    const uint16_t *primes = _bigint_small_primes();
+    uint32_t rems[_BIGINT_SMALL_PRIMES];
+    char *composite = (char *)malloc(_BIGINT_NEXTPRIME_WINDOW);
+    for (;;) {
+        _bigint_prime_sieve_rems(c, rems);
+        memset(composite, 0, _BIGINT_NEXTPRIME_WINDOW);
+        for (uint32_t j = 0; j < _BIGINT_SMALL_PRIMES; ++j) {
+            uint32_t p = primes[j];
+            uint32_t i = (p - rems[j]) % p * ((p + 1) / 2) % p;
+            for (; i < _BIGINT_NEXTPRIME_WINDOW; i += p)
+                composite[i] = 1;
+        }
+        for (uint32_t i = 0; i < _BIGINT_NEXTPRIME_WINDOW; ++i) {
+            if (composite[i]) continue;
+            bigint_tp candidate = bigint_add32(c, 2 * i);
+            if (_bigint_prime_bpsw(candidate, 1)) {
+                free(composite);
+                bigint_free(c);
+                return candidate;
+            }
+            bigint_free(candidate);
+        }
+        c = bigint_add32_inplace(c, 2 * _BIGINT_NEXTPRIME_WINDOW);
+    }
+}
+
+_BIGINT_INLINE void *_bigint_prime_batch_worker(void *arg)
+{
+    struct _bigint_prime_batch *batch = (struct _bigint_prime_batch *)arg;
+    for (;;) {
+        // take the numbers one at a time, so big ones don't hold anyone up
+        uint32_t i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+        if (i >= batch->count) break;
+        batch->results[i] = bigint_probab_prime(batch->ns[i], batch->reps);
+    }
+    return NULL;
+}
+
+_BIGINT_INLINE void bigint_probab_prime_batch(bigint_tp *ns, uint32_t count, int reps, int *results, int threads)
+{
+    // results[i] = bigint_probab_prime(ns[i], reps), on up to the given
+    // number of threads (including the calling one)
+    struct _bigint_prime_batch batch = { ns, results, count, 0, reps };
+    pthread_t *workers = NULL;
+    int started = 0;
+    if (threads > 1) {
+        workers = (pthread_t *)malloc((threads - 1) * sizeof(pthread_t));
+        // if we can't have all the threads, make do with fewer
+        while (started < threads - 1 &&
+               pthread_create(&workers[started], NULL, _bigint_prime_batch_worker, &batch) == 0)
+            started++;
+    }
+    _bigint_prime_batch_worker(&batch);
+    for (int i = 0; i < started; ++i)
+        pthread_join(workers[i], NULL);
+    free(workers);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _BIGINT_PRIME_IMPL_H_ */
@@ -0,0 +1,309 @@
+/* bigint_tune - measure algorithm crossover points on this machine
+   Writes bigint_tuned_params.h, which bigint_impl.h picks up in place of its
+   default thresholds.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+
+/* The thresholds are variables here, so we can move them around while we
+   time the algorithms on either side. This file contains its own copy of the
+   library so that every call really goes through them. */
+uint32_t bigint_tune_mul_karatsuba_threshold;
+uint32_t bigint_tune_sqr_karatsuba_threshold;
+uint32_t bigint_tune_bigdec_mul_karatsuba_threshold;
+uint32_t bigint_tune_bigdec_to_bigint_threshold;
+uint32_t bigint_tune_bigdec_from_bigint_threshold;
+uint32_t bigint_tune_bigfloat_div_newton_threshold;
+uint32_t bigint_tune_bigfloat_sqrt_newton_threshold;
+uint32_t bigint_tune_div_newton_threshold;
+uint32_t bigint_tune_mod_many_tree_threshold;
+uint32_t bigint_tune_to_str_threshold;
+uint32_t bigint_tune_from_str_threshold;
+#define BIGINT_MUL_KARATSUBA_THRESHOLD bigint_tune_mul_karatsuba_threshold
+#define BIGINT_SQR_KARATSUBA_THRESHOLD bigint_tune_sqr_karatsuba_threshold
+#define BIGDEC_MUL_KARATSUBA_THRESHOLD bigint_tune_bigdec_mul_karatsuba_threshold
+#define BIGDEC_TO_BIGINT_THRESHOLD bigint_tune_bigdec_to_bigint_threshold
+#define BIGDEC_FROM_BIGINT_THRESHOLD bigint_tune_bigdec_from_bigint_threshold
+#define BIGFLOAT_DIV_NEWTON_THRESHOLD bigint_tune_bigfloat_div_newton_threshold
+#define BIGFLOAT_SQRT_NEWTON_THRESHOLD bigint_tune_bigfloat_sqrt_newton_threshold
+#define BIGINT_DIV_NEWTON_THRESHOLD bigint_tune_div_newton_threshold
+#define BIGINT_MOD_MANY_TREE_THRESHOLD bigint_tune_mod_many_tree_threshold
+#define BIGINT_TO_STR_THRESHOLD bigint_tune_to_str_threshold
+#define BIGINT_FROM_STR_THRESHOLD bigint_tune_from_str_threshold
+
+#define _BIGINT_INLINE extern inline
+#include "bigint_impl.h"
+#include "bigdec_impl.h"
+#include "bigfloat_impl.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define TUNE_MIN_DIGITS 4
+#define TUNE_MAX_DIGITS 4096
+#define TUNE_REPEATS 5
+#define TUNE_MIN_SECONDS 0.01
+
+struct tune_param {
+    const char *name;
+    uint32_t *threshold;
+    // run the operation on operands of the given size
+    void (*run)(uint32_t digits);
+    uint32_t default_value;
+};
+
+// the name, the variable standing in for the threshold, and its default
+#define TUNE_PARAM(name, threshold, run) { #name, &threshold, run, name##_DEFAULT }
+
+static uint32_t tune_rand_state = 0x12345678;
+static uint32_t *tune_a, *tune_b, *tune_r;
+// base 10^9 operands for the bigdec algorithms
+static uint32_t *tune_da, *tune_db;
+// 16 bit moduli for bigint_mod_many
+#define TUNE_MODULI 256
+static uint32_t tune_moduli[TUNE_MODULI];
+
+static uint32_t tune_rand(void)
+{
+    // xorshift32, we just need digits that aren't all zero
+    tune_rand_state ^= tune_rand_state << 13;
+    tune_rand_state ^= tune_rand_state >> 17;
+    tune_rand_state ^= tune_rand_state << 5;
+    return tune_rand_state;
+}
+
+static double tune_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void tune_run_mul(uint32_t digits)
+{
+    _bigint_mul_mag(tune_r, tune_a, digits, tune_b, digits);
+}
+
+static void tune_run_sqr(uint32_t digits)
+{
+    _bigint_sqr_mag(tune_r, tune_a, digits);
+}
+
+static void tune_run_bigdec_mul(uint32_t digits)
+{
+    _bigdec_mul_mag(tune_r, tune_da, digits, tune_db, digits);
+}
+
+// the power tables are kept between runs: a whole conversion only computes
+// them once, so they shouldn't count against a single split
+static bigint_tp tune_bigint_powers[32];
+static bigdec_tp tune_bigdec_powers[32];
+
+static void tune_run_bigdec_to_bigint(uint32_t digits)
+{
+    bigint_free(_bigdec_to_bigint_mag(tune_da, digits, tune_bigint_powers));
+}
+
+static void tune_run_bigdec_from_bigint(uint32_t digits)
+{
+    bigdec_free(_bigdec_from_bigint_mag(tune_a, digits, tune_bigdec_powers));
+}
+
+static bigint_tp tune_bigint(const uint32_t *lo, const uint32_t *hi, uint32_t digits)
+{
+    // positive number with the digits of lo, followed by those of hi
+    uint32_t hi_digits = hi == NULL ? 0 : digits;
+    bigint_tp n = _bigint_new(digits + hi_digits + 1);
+    memcpy(n->num, lo, digits * sizeof(uint32_t));
+    if (hi != NULL) memcpy(n->num + digits, hi, digits * sizeof(uint32_t));
+    n->num[digits + hi_digits] = 0;
+    return n;
+}
+
+static void tune_run_bigfloat_div(uint32_t digits)
+{
+    int inexact;
+    bigint_tp n = tune_bigint(tune_b, tune_a, digits);
+    bigint_tp d = tune_bigint(tune_b, NULL, digits);
+    bigint_free(_bigfloat_divrem_mag(n, d, &inexact));
+    bigint_free(n);
+    bigint_free(d);
+}
+
+static void tune_run_bigfloat_sqrt(uint32_t digits)
+{
+    int inexact;
+    bigint_tp n = tune_bigint(tune_a, NULL, digits);
+    bigint_free(_bigfloat_sqrtrem_mag(n, &inexact));
+    bigint_free(n);
+}
+
+static void tune_run_div_newton(uint32_t digits)
+{
+    bigint_tp n = tune_bigint(tune_a, tune_b, digits);
+    bigint_tp d = tune_bigint(tune_b, NULL, digits);
+    _bigint_mod_mag(tune_r, n->num, _bigint_mag_digits(n), d);
+    bigint_free(n);
+    bigint_free(d);
+}
+
+static void tune_run_mod_many(uint32_t digits)
+{
+    bigint_tp n = tune_bigint(tune_a, NULL, digits);
+    bigint_mod_many(n, tune_moduli, TUNE_MODULI, tune_r);
+    bigint_free(n);
+}
+
+// base 10 strings, with their own tables of powers of 10^9
+static bigint_tp tune_str_powers[32];
+static bigint_tp tune_str_invs[32];
+static char *tune_str;
+
+static void tune_run_to_str(uint32_t digits)
+{
+    // 10^9 > 2^29, so 9 characters for every 29 bits will do
+    bigint_tp n = tune_bigint(tune_a, NULL, digits);
+    size_t width = (((size_t)digits * BIGINT_WIDTH_BITS + 28) / 29) * BIGDEC_BASE_DIGITS;
+    _bigint_to_base_mag(tune_str, width, n, 10, tune_str_powers, tune_str_invs);
+    bigint_free(n);
+}
+
+static void tune_run_from_str(uint32_t digits)
+{
+    bigint_free(_bigint_from_base_mag(tune_da, digits, BIGDEC_BASE, tune_str_powers));
+}
+
+static double tune_time(const struct tune_param *p, uint32_t digits)
+{
+    // best time per call out of several runs
+    double best = -1;
+    for (int rep = 0; rep < TUNE_REPEATS; ++rep) {
+        long calls = 0;
+        double start = tune_now(), elapsed;
+        do {
+            p->run(digits);
+            calls++;
+            elapsed = tune_now() - start;
+        } while (elapsed < TUNE_MIN_SECONDS);
+        if (best < 0 || elapsed / calls < best) best = elapsed / calls;
+    }
+    return best;
+}
+
+static int tune_faster_above(const struct tune_param *p, uint32_t digits)
+{
+    // does switching to the faster algorithm at this size pay off?
+    *p->threshold = digits + 1;
+    double t_below = tune_time(p, digits);
+    *p->threshold = digits;
+    double t_above = tune_time(p, digits);
+    return t_above < t_below;
+}
+
+static uint32_t tune_crossover(const struct tune_param *p)
+{
+    uint32_t lo = TUNE_MIN_DIGITS, hi = TUNE_MIN_DIGITS;
+    // find a size where the faster algorithm wins...
+    while (!tune_faster_above(p, hi)) {
+        lo = hi;
+        hi *= 2;
+        if (hi > TUNE_MAX_DIGITS) {
+            // no crossover in range: don't report less than the default,
+            // which may lie beyond what we can time. The later parameters
+            // have to be timed with what we report.
+            uint32_t t = p->default_value > TUNE_MAX_DIGITS ? p->default_value : TUNE_MAX_DIGITS;
+            *p->threshold = t;
+            return t;
+        }
+    }
+    if (hi == lo) return lo;
+    // ...and bisect down to where it starts winning
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (tune_faster_above(p, mid)) hi = mid;
+        else lo = mid;
+    }
+    *p->threshold = hi;
+    return hi;
+}
+
+int main(int argc, char **argv)
+{
+    struct tune_param params[] = {
+        TUNE_PARAM(BIGINT_MUL_KARATSUBA_THRESHOLD, bigint_tune_mul_karatsuba_threshold, tune_run_mul),
+        TUNE_PARAM(BIGINT_SQR_KARATSUBA_THRESHOLD, bigint_tune_sqr_karatsuba_threshold, tune_run_sqr),
+        TUNE_PARAM(BIGDEC_MUL_KARATSUBA_THRESHOLD, bigint_tune_bigdec_mul_karatsuba_threshold, tune_run_bigdec_mul),
+        // the conversions depend on multiplication, so they go last
+        TUNE_PARAM(BIGDEC_TO_BIGINT_THRESHOLD, bigint_tune_bigdec_to_bigint_threshold, tune_run_bigdec_to_bigint),
+        TUNE_PARAM(BIGDEC_FROM_BIGINT_THRESHOLD, bigint_tune_bigdec_from_bigint_threshold, tune_run_bigdec_from_bigint),
+        TUNE_PARAM(BIGFLOAT_DIV_NEWTON_THRESHOLD, bigint_tune_bigfloat_div_newton_threshold, tune_run_bigfloat_div),
+        TUNE_PARAM(BIGFLOAT_SQRT_NEWTON_THRESHOLD, bigint_tune_bigfloat_sqrt_newton_threshold, tune_run_bigfloat_sqrt),
+        TUNE_PARAM(BIGINT_DIV_NEWTON_THRESHOLD, bigint_tune_div_newton_threshold, tune_run_div_newton),
+        TUNE_PARAM(BIGINT_MOD_MANY_TREE_THRESHOLD, bigint_tune_mod_many_tree_threshold, tune_run_mod_many),
+        TUNE_PARAM(BIGINT_TO_STR_THRESHOLD, bigint_tune_to_str_threshold, tune_run_to_str),
+        TUNE_PARAM(BIGINT_FROM_STR_THRESHOLD, bigint_tune_from_str_threshold, tune_run_from_str),
+    };
+    const int n_params = sizeof(params) / sizeof(params[0]);
+    uint32_t results[sizeof(params) / sizeof(params[0])];
+
+    const char *filename = argc > 1 ? argv[1] : "bigint_tuned_params.h";
+
+    tune_a = malloc(TUNE_MAX_DIGITS * sizeof(uint32_t));
+    tune_b = malloc(TUNE_MAX_DIGITS * sizeof(uint32_t));
+    tune_r = malloc(2 * TUNE_MAX_DIGITS * sizeof(uint32_t));
+    tune_da = malloc(TUNE_MAX_DIGITS * sizeof(uint32_t));
+    tune_db = malloc(TUNE_MAX_DIGITS * sizeof(uint32_t));
+    tune_str = malloc(2 * TUNE_MAX_DIGITS * BIGDEC_BASE_DIGITS);
+    for (int i = 0; i < TUNE_MAX_DIGITS; ++i) {
+        tune_a[i] = tune_rand();
+        tune_b[i] = tune_rand();
+        tune_da[i] = tune_rand() % BIGDEC_BASE;
+        tune_db[i] = tune_rand() % BIGDEC_BASE;
+    }
+    for (int i = 0; i < TUNE_MODULI; ++i)
+        tune_moduli[i] = (tune_rand() >> 16) | 1;
+
+    // start out with the defaults everywhere
+    for (int i = 0; i < n_params; ++i)
+        *params[i].threshold = params[i].default_value;
+
+    for (int i = 0; i < n_params; ++i) {
+        fprintf(stderr, "%s ... ", params[i].name);
+        fflush(stderr);
+        results[i] = tune_crossover(&params[i]);
+        fprintf(stderr, "%u\n", results[i]);
+    }
+
+    FILE *f = fopen(filename, "w");
+    if (f == NULL) {
+        perror(filename);
+        return 1;
+    }
+    fputs("/* bigint library - bigint_tuned_params.h\n"
+          "   Algorithm thresholds for this machine, generated by bigint_tune. */\n\n"
+          "#ifndef _BIGINT_TUNED_PARAMS_H_\n"
+          "#define _BIGINT_TUNED_PARAMS_H_\n\n", f);
+    for (int i = 0; i < n_params; ++i)
+        fprintf(f, "#ifndef %s\n# define %s %u\n#endif\n",
+                params[i].name, params[i].name, results[i]);
+    fputs("\n#endif /* _BIGINT_TUNED_PARAMS_H_ */\n", f);
+    fclose(f);
+
+    fprintf(stderr, "wrote %s\n", filename);
+
+    free(tune_a);
+    free(tune_b);
+    free(tune_r);
+    free(tune_da);
+    free(tune_db);
+    free(tune_str);
+    for (int j = 0; j < 32; ++j) {
+        if (tune_bigint_powers[j] != NULL) bigint_free(tune_bigint_powers[j]);
+        if (tune_bigdec_powers[j] != NULL) bigdec_free(tune_bigdec_powers[j]);
+        if (tune_str_powers[j] != NULL) bigint_free(tune_str_powers[j]);
+        if (tune_str_invs[j] != NULL) bigint_free(tune_str_invs[j]);
+    }
+    return 0;
+}
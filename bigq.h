@@ -0,0 +1,60 @@
+/* bigint library - bigq.h
+   Rational numbers: function declarations / public interface.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGQ_H_
+#define _BIGQ_H_
+
+#include "bigint.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* A bigq is a fraction num/den with den > 0. It isn't reduced after every
+   operation: that only happens once the numbers have grown past a limit, or
+   when the value is compared or printed. */
+struct _bigq {
+    bigint_tp num;
+    bigint_tp den;
+    int reduced;        // num and den are known to be coprime
+    uint32_t limit;     // reduce once num and den have more digits than this
+};
+typedef struct _bigq * bigq_tp;
+
+inline bigq_tp bigq_dup(bigq_tp q);
+inline void bigq_free(bigq_tp q);
+
+inline bigq_tp bigq_from_int(int64_t num, int64_t den);
+inline bigq_tp bigq_from_bigint(bigint_tp num, bigint_tp den);
+inline char *bigq_to_string(bigq_tp q);
+inline bigq_tp bigq_from_string(const char *c);
+
+inline void bigq_normalize(bigq_tp q);
+
+inline int bigq_sgn(bigq_tp q);
+inline int bigq_cmp(bigq_tp q, bigq_tp r);
+
+inline bigq_tp bigq_add(bigq_tp q, bigq_tp r);
+inline bigq_tp bigq_add_inplace(bigq_tp q, bigq_tp r);
+inline bigq_tp bigq_sub(bigq_tp q, bigq_tp r);
+inline bigq_tp bigq_sub_inplace(bigq_tp q, bigq_tp r);
+inline bigq_tp bigq_mul(bigq_tp q, bigq_tp r);
+inline bigq_tp bigq_mul_inplace(bigq_tp q, bigq_tp r);
+inline bigq_tp bigq_div(bigq_tp q, bigq_tp r);
+inline bigq_tp bigq_div_inplace(bigq_tp q, bigq_tp r);
+
+inline bigq_tp _bigq_new(bigint_tp num, bigint_tp den, int reduced, uint32_t limit);
+inline uint32_t _bigq_digits(bigq_tp q);
+inline bigq_tp _bigq_replace(bigq_tp q, bigq_tp res);
+inline bigq_tp _bigq_addsub(bigq_tp q, bigq_tp r, int sign);
+inline bigq_tp _bigq_muldiv(bigq_tp q, bigq_tp r, int invert);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#include "bigq_impl.h"
+
+#endif /* _BIGQ_H_ */
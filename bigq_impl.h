@@ -0,0 +1,291 @@
+/* bigint library - bigq_impl.h
+   Rational numbers: function definitions (all inline).
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGQ_IMPL_H_
+#define _BIGQ_IMPL_H_
+
+#include "bigq.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* fractions with fewer digits than this (numerator and denominator
+   together) are never reduced until they're compared or printed */
+#ifndef BIGQ_NORMALIZE_THRESHOLD
+# define BIGQ_NORMALIZE_THRESHOLD 32
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+_BIGINT_INLINE uint32_t _bigq_digits(bigq_tp q)
+{
+    return q->num->digits + q->den->digits;
+}
+
+_BIGINT_INLINE bigq_tp _bigq_new(bigint_tp num, bigint_tp den, int reduced, uint32_t limit)
+{
+    // takes ownership of num and den, den != 0
+    bigq_tp res = (bigq_tp)malloc(sizeof(struct _bigq));
+    if (bigint_sgn(den) < 0) {
+        num = bigint_flipsign(num);
+        den = bigint_flipsign(den);
+    }
+    res->num = num;
+    res->den = den;
+    res->reduced = reduced || bigint_cmp32(den, 1) == 0;
+    res->limit = limit;
+    if (_bigq_digits(res) > res->limit) bigq_normalize(res);
+    return res;
+}
+
+_BIGINT_INLINE void bigq_free(bigq_tp q)
+{
+    bigint_free(q->num);
+    bigint_free(q->den);
+    free(q);
+}
+
+_BIGINT_INLINE bigq_tp bigq_dup(bigq_tp q)
+{
+    bigq_tp res = (bigq_tp)malloc(sizeof(struct _bigq));
+    *res = *q;
+    res->num = bigint_dup(q->num);
+    res->den = bigint_dup(q->den);
+    return res;
+}
+
+_BIGINT_INLINE bigq_tp _bigq_replace(bigq_tp q, bigq_tp res)
+{
+    // move res into q, so the _inplace functions keep their pointer
+    bigint_free(q->num);
+    bigint_free(q->den);
+    *q = *res;
+    free(res);
+    return q;
+}
+
+_BIGINT_INLINE bigq_tp bigq_from_int(int64_t num, int64_t den)
+{
+    if (den == 0) return NULL;
+    return _bigq_new(bigint_from_int(num), bigint_from_int(den), 0, BIGQ_NORMALIZE_THRESHOLD);
+}
+
+_BIGINT_INLINE bigq_tp bigq_from_bigint(bigint_tp num, bigint_tp den)
+{
+    if (bigint_cmp32(den, 0) == 0) return NULL;
+    return _bigq_new(bigint_dup(num), bigint_dup(den), 0, BIGQ_NORMALIZE_THRESHOLD);
+}
+
+_BIGINT_INLINE void bigq_normalize(bigq_tp q)
+{
+    if (!q->reduced) {
+        bigint_tp g = bigint_gcd(q->num, q->den);
+        if (bigint_cmp32(g, 1) != 0) {
+            bigint_tp num = bigint_div(q->num, g);
+            bigint_tp den = bigint_div(q->den, g);
+            bigint_free(q->num);
+            bigint_free(q->den);
+            q->num = num;
+            q->den = den;
+        }
+        bigint_free(g);
+        q->reduced = 1;
+    }
+    // let it double in size before we do this again
+    uint32_t digits = _bigq_digits(q);
+    q->limit = 2 * digits > BIGQ_NORMALIZE_THRESHOLD ? 2 * digits : BIGQ_NORMALIZE_THRESHOLD;
+}
+
+_BIGINT_INLINE int bigq_sgn(bigq_tp q)
+{
+    return bigint_sgn(q->num);
+}
+
+_BIGINT_INLINE int bigq_cmp(bigq_tp q, bigq_tp r)
+{
+    bigq_normalize(q);
+    bigq_normalize(r);
+    int q_sign = bigq_sgn(q);
+    int r_sign = bigq_sgn(r);
+    if (q_sign != r_sign) return q_sign;
+    if (bigint_cmp(q->den, r->den) == 0) return bigint_cmp(q->num, r->num);
+
+    bigint_tp lhs = bigint_mul(q->num, r->den);
+    bigint_tp rhs = bigint_mul(r->num, q->den);
+    int res = bigint_cmp(lhs, rhs);
+    bigint_free(lhs);
+    bigint_free(rhs);
+    return res;
+}
+
+_BIGINT_INLINE bigq_tp _bigq_addsub(bigq_tp q, bigq_tp r, int sign)
+{
+    // q + sign * r
+    uint32_t limit = q->limit > r->limit ? q->limit : r->limit;
+    bigint_tp num, den;
+
+    if (bigint_cmp(q->den, r->den) == 0) {
+        // this happens a lot when adding up integers
+        num = sign < 0 ? bigint_sub(q->num, r->num) : bigint_add(q->num, r->num);
+        return _bigq_new(num, bigint_dup(q->den), 0, limit);
+    }
+
+    uint32_t ad = q->num->digits + r->den->digits, cb = r->num->digits + q->den->digits;
+    if ((ad > cb ? ad : cb) + q->den->digits + r->den->digits <= limit) {
+        // a/b + c/d = (ad + cb) / bd, and never mind the common factors
+        num = bigint_mul(q->num, r->den);
+        num = sign < 0 ? bigint_submul_inplace(num, r->num, q->den)
+                       : bigint_addmul_inplace(num, r->num, q->den);
+        return _bigq_new(num, bigint_mul(q->den, r->den), 0, limit);
+    }
+
+    // The result is going to need reducing. Reduce the terms instead: then
+    // any common factor of the sum has to divide g = gcd(b, d), and we only
+    // need gcds with g instead of the whole result (Knuth, TAOCP 4.5.1)
+    bigq_normalize(q);
+    bigq_normalize(r);
+    bigint_tp a = q->num, b = q->den, c = r->num, d = r->den;
+    bigint_tp g = bigint_gcd(b, d);
+    if (bigint_cmp32(g, 1) == 0) {
+        num = bigint_mul(a, d);
+        num = sign < 0 ? bigint_submul_inplace(num, c, b) : bigint_addmul_inplace(num, c, b);
+        den = bigint_mul(b, d);
+    } else {
+        bigint_tp b1 = bigint_div(b, g);
+        bigint_tp d1 = bigint_div(d, g);
+        bigint_tp t = bigint_mul(a, d1);
+        t = sign < 0 ? bigint_submul_inplace(t, c, b1) : bigint_addmul_inplace(t, c, b1);
+        bigint_tp g2 = bigint_gcd(t, g);
+        num = bigint_div(t, g2);
+        bigint_tp d2 = bigint_div(d, g2);
+        den = bigint_mul(b1, d2);
+        bigint_free(b1);
+        bigint_free(d1);
+        bigint_free(t);
+        bigint_free(g2);
+        bigint_free(d2);
+    }
+    bigint_free(g);
+    return _bigq_new(num, den, 1, limit);
+}
+
+_BIGINT_INLINE bigq_tp _bigq_muldiv(bigq_tp q, bigq_tp r, int invert)
+{
+    // q * r, or q / r if invert is set
+    uint32_t limit = q->limit > r->limit ? q->limit : r->limit;
+    if (_bigq_digits(q) + _bigq_digits(r) <= limit) {
+        if (invert) return _bigq_new(bigint_mul(q->num, r->den), bigint_mul(q->den, r->num), 0, limit);
+        else return _bigq_new(bigint_mul(q->num, r->num), bigint_mul(q->den, r->den), 0, limit);
+    }
+
+    // cross-cancel: with both fractions reduced, the only common factors
+    // left are between a and d, and between c and b
+    bigq_normalize(q);
+    bigq_normalize(r);
+    bigint_tp a = q->num, b = q->den;
+    bigint_tp c = invert ? r->den : r->num, d = invert ? r->num : r->den;
+    bigint_tp g1 = bigint_gcd(a, d);
+    bigint_tp g2 = bigint_gcd(c, b);
+    bigint_tp a1 = bigint_div(a, g1), d1 = bigint_div(d, g1);
+    bigint_tp c1 = bigint_div(c, g2), b1 = bigint_div(b, g2);
+    bigq_tp res = _bigq_new(bigint_mul(a1, c1), bigint_mul(b1, d1), 1, limit);
+    bigint_free(g1);
+    bigint_free(g2);
+    bigint_free(a1);
+    bigint_free(d1);
+    bigint_free(c1);
+    bigint_free(b1);
+    return res;
+}
+
+_BIGINT_INLINE bigq_tp bigq_add(bigq_tp q, bigq_tp r)
+{
+    return _bigq_addsub(q, r, 1);
+}
+
+_BIGINT_INLINE bigq_tp bigq_add_inplace(bigq_tp q, bigq_tp r)
+{
+    return _bigq_replace(q, _bigq_addsub(q, r, 1));
+}
+
+_BIGINT_INLINE bigq_tp bigq_sub(bigq_tp q, bigq_tp r)
+{
+    return _bigq_addsub(q, r, -1);
+}
+
+_BIGINT_INLINE bigq_tp bigq_sub_inplace(bigq_tp q, bigq_tp r)
+{
+    return _bigq_replace(q, _bigq_addsub(q, r, -1));
+}
+
+_BIGINT_INLINE bigq_tp bigq_mul(bigq_tp q, bigq_tp r)
+{
+    return _bigq_muldiv(q, r, 0);
+}
+
+_BIGINT_INLINE bigq_tp bigq_mul_inplace(bigq_tp q, bigq_tp r)
+{
+    return _bigq_replace(q, _bigq_muldiv(q, r, 0));
+}
+
+_BIGINT_INLINE bigq_tp bigq_div(bigq_tp q, bigq_tp r)
+{
+    if (bigint_cmp32(r->num, 0) == 0) return NULL;
+    return _bigq_muldiv(q, r, 1);
+}
+
+_BIGINT_INLINE bigq_tp bigq_div_inplace(bigq_tp q, bigq_tp r)
+{
+    if (bigint_cmp32(r->num, 0) == 0) return NULL;
+    return _bigq_replace(q, _bigq_muldiv(q, r, 1));
+}
+
+_BIGINT_INLINE char *bigq_to_string(bigq_tp q)
+{
+    bigq_normalize(q);
+    char *s = bigint_to_string(q->num);
+    if (bigint_cmp32(q->den, 1) == 0) return s;
+
+    char *den = bigint_to_string(q->den);
+    size_t num_len = strlen(s), den_len = strlen(den);
+    s = (char *)realloc(s, num_len + den_len + 2);
+    s[num_len] = '/';
+    memcpy(s + num_len + 1, den, den_len + 1);
+    free(den);
+    return s;
+}
+
+_BIGINT_INLINE bigq_tp bigq_from_string(const char *c)
+{
+    // "num" or "num/den"
+    const char *slash = strchr(c, '/');
+    if (slash == NULL) {
+        bigint_tp num = bigint_from_string(c);
+        if (num == NULL) return NULL;
+        return _bigq_new(num, bigint_from_int(1), 1, BIGQ_NORMALIZE_THRESHOLD);
+    }
+
+    char *num_str = (char *)malloc(slash - c + 1);
+    memcpy(num_str, c, slash - c);
+    num_str[slash - c] = '\0';
+    bigint_tp num = bigint_from_string(num_str);
+    bigint_tp den = bigint_from_string(slash + 1);
+    free(num_str);
+    if (num == NULL || den == NULL || bigint_cmp32(den, 0) == 0) {
+        // error!
+        if (num != NULL) bigint_free(num);
+        if (den != NULL) bigint_free(den);
+        return NULL;
+    }
+    return _bigq_new(num, den, 0, BIGQ_NORMALIZE_THRESHOLD);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _BIGQ_IMPL_H_ */
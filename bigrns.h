@@ -0,0 +1,73 @@
+/* bigint library - bigrns.h
+   Residue number system: function declarations / public interface.
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGRNS_H_
+#define _BIGRNS_H_
+
+#include "bigint.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* A bigrns base is a set of pairwise coprime odd moduli below 2^31, with
+   product M. A bigrns holds a number x with |x| < M/2 as its residues
+   x mod p for every modulus p, so adding and multiplying work on every
+   channel on its own, without carries. Going back to a bigint needs the
+   Chinese remainder theorem. */
+struct _bigrns_base {
+    uint32_t count;
+    uint32_t *moduli;
+    uint32_t *minv;     // -1/p mod 2^32, for Montgomery multiplication
+    uint32_t *r2;       // 2^64 mod p, to get residues into Montgomery form
+    uint32_t *crt;      // (M/p)^-1 mod p
+    struct _bigint_limb_inv *inv;
+    bigint_tp *tree;    // products of the moduli, as a binary tree
+    uint32_t capacity;  // numbers of up to this many bits fit
+};
+typedef struct _bigrns_base * bigrns_base_tp;
+
+/* The residues are kept in Montgomery form (x 2^32 mod p). bits is an
+   upper bound on the size of |x| in bits, which says whether x can still
+   be told apart from x - M. */
+struct _bigrns {
+    bigrns_base_tp base;
+    uint32_t bits;
+    uint32_t res[];
+};
+typedef struct _bigrns * bigrns_tp;
+
+inline bigrns_base_tp bigrns_base_new(uint32_t count);
+inline bigrns_base_tp bigrns_base_from_moduli(const uint32_t *moduli, uint32_t count);
+inline void bigrns_base_free(bigrns_base_tp base);
+
+inline bigrns_tp bigrns_dup(bigrns_tp x);
+inline void bigrns_free(bigrns_tp x);
+
+inline bigrns_tp bigrns_from_int(bigrns_base_tp base, int64_t i);
+inline bigrns_tp bigrns_from_bigint(bigrns_base_tp base, bigint_tp n);
+inline bigint_tp bigrns_to_bigint(bigrns_tp x);
+
+inline bigrns_tp bigrns_add(bigrns_tp x, bigrns_tp y);
+inline bigrns_tp bigrns_add_inplace(bigrns_tp x, bigrns_tp y);
+inline bigrns_tp bigrns_sub(bigrns_tp x, bigrns_tp y);
+inline bigrns_tp bigrns_sub_inplace(bigrns_tp x, bigrns_tp y);
+inline bigrns_tp bigrns_mul(bigrns_tp x, bigrns_tp y);
+inline bigrns_tp bigrns_mul_inplace(bigrns_tp x, bigrns_tp y);
+
+inline bigrns_base_tp _bigrns_base_init(uint32_t *moduli, uint32_t count);
+inline bigint_tp _bigrns_tree_build(bigrns_base_tp base, uint32_t node, uint32_t lo, uint32_t hi);
+inline bigint_tp _bigrns_crt(bigrns_base_tp base, const uint32_t *c, uint32_t node, uint32_t lo, uint32_t hi);
+inline uint32_t _bigrns_mont_mul(uint32_t a, uint32_t b, uint32_t p, uint32_t minv);
+inline uint32_t _bigrns_bits(bigint_tp n);
+inline bigrns_tp _bigrns_new(bigrns_base_tp base, uint32_t bits);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#include "bigrns_impl.h"
+
+#endif /* _BIGRNS_H_ */
@@ -0,0 +1,290 @@
+/* bigint library - bigrns_impl.h
+   Residue number system: function definitions (all inline).
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#ifndef _BIGRNS_IMPL_H_
+#define _BIGRNS_IMPL_H_
+
+#include "bigrns.h"
+#include "bigint_prime.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+_BIGINT_INLINE uint32_t _bigrns_mont_mul(uint32_t a, uint32_t b, uint32_t p, uint32_t minv)
+{
+    // a b / 2^32 mod p for p < 2^31: nothing here overflows 64 bits
+    uint64_t t = (uint64_t)a * b;
+    uint32_t m = (uint32_t)t * minv;
+    uint32_t u = (t + (uint64_t)m * p) >> 32;
+    return u >= p ? u - p : u;
+}
+
+_BIGINT_INLINE uint32_t _bigrns_bits(bigint_tp n)
+{
+    // size of |n| in bits
+    if (bigint_sgn(n) < 0) n = bigint_neg_into(NULL, n);
+    else n = bigint_dup(n);
+    uint32_t digits = _bigint_mag_digits(n);
+    uint32_t bits = digits * BIGINT_WIDTH_BITS;
+    while (bits > 0 && !((n->num[(bits-1) / BIGINT_WIDTH_BITS] >> ((bits-1) % BIGINT_WIDTH_BITS)) & 1))
+        bits--;
+    bigint_free(n);
+    return bits;
+}
+
+_BIGINT_INLINE bigint_tp _bigrns_tree_build(bigrns_base_tp base, uint32_t node, uint32_t lo, uint32_t hi)
+{
+    // the product of moduli[lo..hi), with the children of node i at 2i+1, 2i+2
+    bigint_tp prod;
+    if (hi - lo == 1) {
+        prod = bigint_from_int(base->moduli[lo]);
+    } else {
+        uint32_t mid = lo + (hi - lo) / 2;
+        bigint_tp left = _bigrns_tree_build(base, 2*node + 1, lo, mid);
+        bigint_tp right = _bigrns_tree_build(base, 2*node + 2, mid, hi);
+        prod = bigint_mul(left, right);
+    }
+    base->tree[node] = prod;
+    return prod;
+}
+
+_BIGINT_INLINE bigrns_base_tp _bigrns_base_init(uint32_t *moduli, uint32_t count)
+{
+    // takes ownership of moduli, which are known to be fine
+    bigrns_base_tp base = (bigrns_base_tp)malloc(sizeof(struct _bigrns_base));
+    base->count = count;
+    base->moduli = moduli;
+    base->minv = (uint32_t *)malloc(count * sizeof(uint32_t));
+    base->r2 = (uint32_t *)malloc(count * sizeof(uint32_t));
+    base->crt = (uint32_t *)malloc(count * sizeof(uint32_t));
+    base->inv = (struct _bigint_limb_inv *)malloc(count * sizeof(struct _bigint_limb_inv));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t p = moduli[i], inv = p;
+        for (int k = 0; k < 4; ++k)
+            inv *= 2 - p * inv;
+        base->minv[i] = -inv;
+        uint64_t r = ((uint64_t)1 << 32) % p;
+        base->r2[i] = r * r % p;
+        _bigint_limb_inv_init(&base->inv[i], p);
+
+        // M/p mod p, and its inverse by Euclid
+        uint64_t q = 1;
+        for (uint32_t j = 0; j < count; ++j)
+            if (j != i) q = q * (moduli[j] % p) % p;
+        int64_t a = q, b = p, x = 1, y = 0;
+        while (b != 0) {
+            int64_t t = a / b, s;
+            s = a - t * b; a = b; b = s;
+            s = x - t * y; x = y; y = s;
+        }
+        base->crt[i] = x < 0 ? x + p : x;
+    }
+
+    // a tree with count leaves has fewer than 4 count nodes
+    base->tree = (bigint_tp *)calloc(4 * count, sizeof(bigint_tp));
+    bigint_tp m = _bigrns_tree_build(base, 0, 0, count);
+    // M/2 >= 2^(bits(M) - 2)
+    base->capacity = _bigrns_bits(m) - 2;
+    return base;
+}
+
+_BIGINT_INLINE bigrns_base_tp bigrns_base_new(uint32_t count)
+{
+    // the count biggest primes below 2^31
+    if (count == 0) return NULL;
+    uint32_t *moduli = (uint32_t *)malloc(count * sizeof(uint32_t));
+    bigint_tp p = bigint_from_int(0x7fffffff);
+    for (uint32_t i = 0; i < count; ) {
+        if (bigint_probab_prime(p, 1)) moduli[i++] = p->num[0];
+        p = bigint_add32_inplace(p, -2);
+    }
+    bigint_free(p);
+    return _bigrns_base_init(moduli, count);
+}
+
+_BIGINT_INLINE bigrns_base_tp bigrns_base_from_moduli(const uint32_t *moduli, uint32_t count)
+{
+    // NULL unless the moduli are odd, between 3 and 2^31, and pairwise coprime
+    if (count == 0) return NULL;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!(moduli[i] & 1) || moduli[i] < 3 || moduli[i] >= 0x80000000) return NULL;
+        for (uint32_t j = 0; j < i; ++j) {
+            uint32_t a = moduli[i], b = moduli[j];
+            while (b != 0) {
+                uint32_t t = a % b;
+                a = b;
+                b = t;
+            }
+            if (a != 1) return NULL;
+        }
+    }
+    uint32_t *copy = (uint32_t *)malloc(count * sizeof(uint32_t));
+    memcpy(copy, moduli, count * sizeof(uint32_t));
+    return _bigrns_base_init(copy, count);
+}
+
+_BIGINT_INLINE void bigrns_base_free(bigrns_base_tp base)
+{
+    for (uint32_t i = 0; i < 4 * base->count; ++i)
+        if (base->tree[i] != NULL) bigint_free(base->tree[i]);
+    free(base->tree);
+    free(base->moduli);
+    free(base->minv);
+    free(base->r2);
+    free(base->crt);
+    free(base->inv);
+    free(base);
+}
+
+_BIGINT_INLINE bigrns_tp _bigrns_new(bigrns_base_tp base, uint32_t bits)
+{
+    bigrns_tp res = (bigrns_tp)malloc(sizeof(struct _bigrns) + base->count * sizeof(uint32_t));
+    res->base = base;
+    res->bits = bits;
+    return res;
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_dup(bigrns_tp x)
+{
+    bigrns_tp res = _bigrns_new(x->base, x->bits);
+    memcpy(res->res, x->res, x->base->count * sizeof(uint32_t));
+    return res;
+}
+
+_BIGINT_INLINE void bigrns_free(bigrns_tp x)
+{
+    free(x);
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_from_bigint(bigrns_base_tp base, bigint_tp n)
+{
+    // NULL if n doesn't fit
+    uint32_t bits = _bigrns_bits(n);
+    if (bits > base->capacity) return NULL;
+
+    int sign = bigint_sgn(n);
+    if (sign < 0) n = bigint_neg_into(NULL, n);
+    uint32_t digits = _bigint_mag_digits(n);
+    bigrns_tp res = _bigrns_new(base, bits);
+    for (uint32_t i = 0; i < base->count; ++i) {
+        uint32_t p = base->moduli[i];
+        uint32_t r = _bigint_limbs_mod_1(n->num, digits, &base->inv[i]);
+        if (sign < 0 && r != 0) r = p - r;
+        res->res[i] = _bigrns_mont_mul(r, base->r2[i], p, base->minv[i]);
+    }
+    if (sign < 0) bigint_free(n);
+    return res;
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_from_int(bigrns_base_tp base, int64_t i)
+{
+    bigint_tp n = bigint_from_int(i);
+    bigrns_tp res = bigrns_from_bigint(base, n);
+    bigint_free(n);
+    return res;
+}
+
+_BIGINT_INLINE bigint_tp _bigrns_crt(bigrns_base_tp base, const uint32_t *c, uint32_t node, uint32_t lo, uint32_t hi)
+{
+    // sum of c[i] M'/p_i over [lo, hi), where M' is the product over the range
+    if (hi - lo == 1) return bigint_from_int(c[lo]);
+    uint32_t mid = lo + (hi - lo) / 2;
+    bigint_tp left = _bigrns_crt(base, c, 2*node + 1, lo, mid);
+    bigint_tp right = _bigrns_crt(base, c, 2*node + 2, mid, hi);
+    bigint_tp res = bigint_mul(left, base->tree[2*node + 2]);
+    res = bigint_addmul_inplace(res, right, base->tree[2*node + 1]);
+    bigint_free(left);
+    bigint_free(right);
+    return res;
+}
+
+_BIGINT_INLINE bigint_tp bigrns_to_bigint(bigrns_tp x)
+{
+    // NULL if x might have outgrown the moduli on the way
+    bigrns_base_tp base = x->base;
+    if (x->bits > base->capacity) return NULL;
+
+    // x = sum of (x_i (M/p_i)^-1 mod p_i) M/p_i mod M; the Montgomery
+    // multiplication takes x_i out of Montgomery form at the same time
+    uint32_t *c = (uint32_t *)malloc(base->count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < base->count; ++i)
+        c[i] = _bigrns_mont_mul(x->res[i], base->crt[i], base->moduli[i], base->minv[i]);
+    bigint_tp res = _bigrns_crt(base, c, 0, 0, base->count);
+    free(c);
+
+    bigint_tp m = base->tree[0];
+    res = bigint_mod_inplace(res, m);
+    // the upper half of [0, M) is negative
+    bigint_tp twice = bigint_shift(bigint_dup(res), 1);
+    if (bigint_cmp(twice, m) > 0) res = bigint_sub_inplace(res, m);
+    bigint_free(twice);
+    return res;
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_add_inplace(bigrns_tp x, bigrns_tp y)
+{
+    if (x->base != y->base) return NULL;
+    const uint32_t *p = x->base->moduli;
+    for (uint32_t i = 0; i < x->base->count; ++i) {
+        uint32_t s = x->res[i] + y->res[i];
+        x->res[i] = s >= p[i] ? s - p[i] : s;
+    }
+    uint32_t bits = x->bits > y->bits ? x->bits : y->bits;
+    x->bits = bits < UINT32_MAX ? bits + 1 : bits;
+    return x;
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_add(bigrns_tp x, bigrns_tp y)
+{
+    if (x->base != y->base) return NULL;
+    return bigrns_add_inplace(bigrns_dup(x), y);
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_sub_inplace(bigrns_tp x, bigrns_tp y)
+{
+    if (x->base != y->base) return NULL;
+    const uint32_t *p = x->base->moduli;
+    for (uint32_t i = 0; i < x->base->count; ++i) {
+        // like add, so that it vectorises
+        uint32_t d = x->res[i] - y->res[i] + p[i];
+        x->res[i] = d >= p[i] ? d - p[i] : d;
+    }
+    uint32_t bits = x->bits > y->bits ? x->bits : y->bits;
+    x->bits = bits < UINT32_MAX ? bits + 1 : bits;
+    return x;
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_sub(bigrns_tp x, bigrns_tp y)
+{
+    if (x->base != y->base) return NULL;
+    return bigrns_sub_inplace(bigrns_dup(x), y);
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_mul_inplace(bigrns_tp x, bigrns_tp y)
+{
+    if (x->base != y->base) return NULL;
+    const uint32_t *p = x->base->moduli, *minv = x->base->minv;
+    for (uint32_t i = 0; i < x->base->count; ++i)
+        x->res[i] = _bigrns_mont_mul(x->res[i], y->res[i], p[i], minv[i]);
+    uint64_t bits = (uint64_t)x->bits + y->bits;
+    x->bits = bits < UINT32_MAX ? bits : UINT32_MAX;
+    return x;
+}
+
+_BIGINT_INLINE bigrns_tp bigrns_mul(bigrns_tp x, bigrns_tp y)
+{
+    if (x->base != y->base) return NULL;
+    return bigrns_mul_inplace(bigrns_dup(x), y);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _BIGRNS_IMPL_H_ */
@@ -1,8 +1,46 @@
 /* bigint library - unit tests
    Copyright 2020 Thomas Jollans - see COPYING */
 
+// for bigint_disk.h
+#define _DEFAULT_SOURCE
+
 #include <criterion/criterion.h>
 #include "bigint.h"
+#include "bigdec.h"
+#include "bigq.h"
+#include "bigfloat.h"
+#include "bigint_prime.h"
+#include "bigrns.h"
+#include "bigint_dag.h"
+#include "bigint_disk.h"
+
+Test(bigint_test, test_dup) {
+    char *s;
+    bigint_tp a = bigint_from_string("-23749238409823046709104012831203709123");
+    bigint_tp b = bigint_dup(a);
+#ifdef BIGINT_REFCOUNT
+    cr_assert_eq(a, b, "bigint_dup shares the number");
+#endif
+    cr_assert(bigint_cmp(a, b) == 0, "bigint_dup copies the value");
+
+    // modifying one copy must leave the other one alone
+    bigint_tp c = bigint_dup(a);
+    b = bigint_add32_inplace(b, 1000);
+    c = bigint_flipsign(c);
+    s = bigint_to_string(a);
+    cr_assert_str_eq(s, "-23749238409823046709104012831203709123", "modifying a duplicate leaves the original intact");
+    free(s);
+    s = bigint_to_string(b);
+    cr_assert_str_eq(s, "-23749238409823046709104012831203708123", "duplicates can be modified");
+    free(s);
+    s = bigint_to_string(c);
+    cr_assert_str_eq(s, "23749238409823046709104012831203709123", "duplicates can be modified");
+    free(s);
+
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(c);
+}
 
 Test(bigint_test, test_add32) {
     // basic 32-bit add
@@ -36,6 +74,16 @@ Test(bigint_test, test_add32) {
     cr_assert_eq(r->num[0], (uint32_t)-147483658, "bigint_add32 must be correct");
     bigint_free(i);
     bigint_free(r);
+    i = bigint_from_int(4294967296);
+    i = bigint_add32_inplace(i, -1);
+    cr_assert(bigint_cmp32(i, 0) > 0 && i->num[0] == 0xffffffff, "Subtraction with a borrow");
+    bigint_free(i);
+    i = bigint_from_int(-4294967296);
+    i = bigint_add32_inplace(i, -1);
+    s = bigint_to_string(i);
+    cr_assert_str_eq(s, "-4294967297", "Negative subtraction with a borrow");
+    free(s);
+    bigint_free(i);
 }
 
 Test(bigint_test, test_add) {
@@ -80,6 +128,47 @@ Test(bigint_test, test_add) {
     bigint_free(j);
 }
 
+Test(bigint_test, test_sub) {
+    char *s;
+    bigint_tp i = bigint_from_string("23749238409823046709104012831203709123");
+    bigint_tp j = bigint_from_string("-1000000000000000000000000000000000000000000000000000000000000000000");
+    bigint_tp k = bigint_sub(i, j);
+    s = bigint_to_string(k);
+    cr_assert_str_eq(s, "1000000000000000000000000000023749238409823046709104012831203709123", "bigint_sub");
+    free(s);
+    k = bigint_rsub_inplace(k, i);
+    s = bigint_to_string(k);
+    cr_assert_str_eq(s, "-1000000000000000000000000000000000000000000000000000000000000000000", "bigint_rsub_inplace");
+    free(s);
+    k = bigint_sub_inplace(k, j);
+    cr_assert(bigint_cmp32(k, 0) == 0 && k->digits == 1, "bigint_sub_inplace crops the result");
+    bigint_free(k);
+    bigint_free(j);
+
+    j = bigint_from_int(4294967296);
+    j = bigint_sub32_inplace(j, 1);
+    cr_assert(bigint_sgn(j) > 0 && j->num[0] == 0xffffffff, "bigint_sub32_inplace with a borrow");
+    k = bigint_sub32(j, INT32_MIN);
+    s = bigint_to_string(k);
+    cr_assert_str_eq(s, "6442450943", "bigint_sub32 with the smallest int32_t");
+    free(s);
+    bigint_free(k);
+    bigint_free(j);
+
+    j = bigint_from_int(-2147483648);
+    k = bigint_neg_into(NULL, j);
+    cr_assert_eq(k->digits, 2, "bigint_neg_into makes room for the sign");
+    k = bigint_neg_into(k, i);
+    s = bigint_to_string(k);
+    cr_assert_str_eq(s, "-23749238409823046709104012831203709123", "bigint_neg_into");
+    free(s);
+    j = bigint_sub_inplace(j, j);
+    cr_assert(bigint_cmp32(j, 0) == 0, "n - n");
+    bigint_free(i);
+    bigint_free(j);
+    bigint_free(k);
+}
+
 Test(bigint_test, test_mul32) {
     char *s;
     bigint_tp i, j;
@@ -162,6 +251,102 @@ Test(bigint_test, test_mul) {
     bigint_free(r);
 }
 
+Test(bigint_test, test_mul_large) {
+    // big enough to go through Karatsuba
+    char *s, *expected;
+    bigint_tp i, j, r;
+    char nines[1001], power[1202];
+
+    memset(nines, '9', 1000);
+    nines[1000] = '\0';
+    i = bigint_from_string(nines);
+
+    // (10^1000 - 1)^2 = 99...9800...01
+    expected = malloc(2001);
+    memset(expected, '9', 999);
+    expected[999] = '8';
+    memset(expected + 1000, '0', 999);
+    expected[1999] = '1';
+    expected[2000] = '\0';
+    r = bigint_mul(i, i);
+    s = bigint_to_string(r);
+    cr_assert_str_eq(s, expected, "bigint_mul squares large numbers");
+    free(s);
+    bigint_free(r);
+
+    j = bigint_dup(i);
+    r = bigint_mul(i, j);
+    s = bigint_to_string(r);
+    cr_assert_str_eq(s, expected, "bigint_mul multiplies large numbers");
+    free(s);
+    bigint_free(r);
+    bigint_free(j);
+    free(expected);
+
+    // unbalanced, with signs: -(10^1000 - 1) * 10^1200
+    power[0] = '1';
+    memset(power + 1, '0', 1200);
+    power[1201] = '\0';
+    j = bigint_from_string(power);
+    i = bigint_flipsign(i);
+    r = bigint_mul(i, j);
+    s = bigint_to_string(r);
+    cr_assert_eq(strlen(s), 2201, "bigint_mul with unbalanced operands");
+    cr_assert(s[0] == '-' && strncmp(s + 1, nines, 1000) == 0 && strcmp(s + 1001, power + 1) == 0,
+              "bigint_mul with unbalanced operands");
+    free(s);
+    bigint_free(r);
+
+    r = bigint_mul(j, i);
+    s = bigint_to_string(r);
+    cr_assert(s[0] == '-' && strncmp(s + 1, nines, 1000) == 0 && strcmp(s + 1001, power + 1) == 0,
+              "bigint_mul with unbalanced operands, other way around");
+    free(s);
+    bigint_free(r);
+    bigint_free(i);
+    bigint_free(j);
+}
+
+Test(bigint_test, test_addmul) {
+    char *s;
+    bigint_tp n, a, b;
+
+    n = bigint_from_string("1000000000000000000000000");
+    a = bigint_from_string("-123456789123456789");
+    b = bigint_from_string("987654321987654321");
+    n = bigint_addmul_inplace(n, a, b);
+    s = bigint_to_string(n);
+    cr_assert_str_eq(s, "-121932631355500531347203169112635269", "bigint_addmul_inplace");
+    free(s);
+    n = bigint_submul_inplace(n, a, b);
+    s = bigint_to_string(n);
+    cr_assert_str_eq(s, "1000000000000000000000000", "bigint_submul_inplace");
+    free(s);
+    n = bigint_addmul_inplace(n, n, n);
+    s = bigint_to_string(n);
+    cr_assert_str_eq(s, "1000000000000000000000001000000000000000000000000", "bigint_addmul_inplace with n as a factor");
+    free(s);
+
+    // a short factor times a long one goes row by row, two long ones don't
+    bigint_tp big = bigint_shift(bigint_from_int(-3), 2000);
+    big = bigint_add32_inplace(big, 12345);
+    bigint_tp factors[2] = { a, big };
+    for (int i = 0; i < 2; ++i) {
+        bigint_tp expected = bigint_rsub_inplace(bigint_mul(factors[i], big), n);
+        bigint_tp r = bigint_submul_inplace(bigint_dup(n), factors[i], big);
+        cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_submul_inplace with long factors");
+        r = bigint_addmul_inplace(r, big, factors[i]);
+        cr_assert_eq(bigint_cmp(r, n), 0, "bigint_addmul_inplace with long factors");
+        bigint_free(r);
+        bigint_free(expected);
+    }
+    bigint_free(big);
+
+    bigint_free(n);
+    bigint_free(a);
+    bigint_free(b);
+}
+
 Test(bigint_test, test_div32) {
     char *s;
     bigint_tp n, r;
@@ -190,6 +375,9 @@ Test(bigint_test, test_div32) {
     cr_assert_str_eq(s, "2173913043478260869565217391304347826086956521739", "bigint_div32 negative over negative is positive");
     free(s);
 
+    bigint_tp q = bigint_div32(r, -7, &rem);
+    cr_assert_eq(rem, 6, "bigint_div32 remainder has the sign of the numerator");
+    bigint_free(q);
     bigint_free(r);
 
     r = bigint_div32_inplace(n, 0, NULL);
@@ -199,6 +387,36 @@ Test(bigint_test, test_div32) {
 }
 
 
+Test(bigint_test, test_divrem_1) {
+    char *s;
+    uint32_t rems[3];
+    bigint_tp n = bigint_from_string("-123456789012345678901234567890123456789");
+
+    bigint_tp q = bigint_divrem_1(n, 1000000000, 3, rems);
+    s = bigint_to_string(q);
+    cr_assert_str_eq(s, "-123456789012", "bigint_divrem_1 divides by d^k");
+    free(s);
+    cr_assert(rems[0] == 123456789 && rems[1] == 234567890 && rems[2] == 345678901,
+              "bigint_divrem_1 gives the remainder digits");
+    bigint_free(q);
+
+    q = bigint_divrem_1(n, 7, 1, rems);
+    s = bigint_to_string(q);
+    cr_assert_str_eq(s, "-17636684144620811271604938270017636684", "bigint_divrem_1 by a small number");
+    free(s);
+    cr_assert_eq(rems[0], 1, "bigint_divrem_1 by a small number");
+    bigint_free(q);
+
+    n = bigint_divrem_1_inplace(n, 0xFFFFFFFF, 2, rems);
+    s = bigint_to_string(n);
+    cr_assert_str_eq(s, "-6692605945879974417", "bigint_divrem_1_inplace by the largest digit");
+    free(s);
+    cr_assert(rems[0] == 370150569 && rems[1] == 2175688101u, "bigint_divrem_1_inplace by the largest digit");
+
+    cr_assert_eq(bigint_divrem_1(n, 0, 1, rems), NULL, "bigint_divrem_1 refuses to divide by zero");
+    bigint_free(n);
+}
+
 Test(bigint_test, test_div) {
     char *s;
     bigint_tp n, d, r;
@@ -251,6 +469,39 @@ Test(bigint_test, test_div) {
     bigint_free(d);
 }
 
+Test(bigint_test, test_mod) {
+    char *s;
+    bigint_tp n, d, r;
+
+    n = bigint_from_string("74927340823023480293740928340923740234890");
+    d = bigint_from_string("-9237492374060912834");
+    r = bigint_mod(n, d);
+    s = bigint_to_string(r);
+    cr_assert_str_eq(s, "8470211167361394468", "bigint_mod has the sign of the numerator");
+    free(s);
+    bigint_free(r);
+
+    n = bigint_flipsign(n);
+    r = bigint_mod(n, d);
+    s = bigint_to_string(r);
+    cr_assert_str_eq(s, "-8470211167361394468", "bigint_mod of a negative number");
+    free(s);
+    bigint_free(r);
+
+    n = bigint_mod_inplace(n, d);
+    s = bigint_to_string(n);
+    cr_assert_str_eq(s, "-8470211167361394468", "bigint_mod_inplace");
+    free(s);
+    bigint_free(d);
+
+    d = bigint_from_int(0);
+    r = bigint_mod(n, d);
+    cr_assert_eq(r, NULL, "bigint_mod refuses to divide by zero");
+
+    bigint_free(n);
+    bigint_free(d);
+}
+
 Test(bigint_test, test_sqrt) {
     char *s;
     bigint_tp n = bigint_from_string("23232328323215435345345345343458098856756556809400840980980980980809092343243243243243098799634");
@@ -269,3 +520,839 @@ Test(bigint_test, test_sqrt) {
 
     bigint_free(n);
 }
+
+Test(bigint_test, test_powmod) {
+    char *s;
+    bigint_tp b = bigint_from_string("-74927340823023480293740928340923740234891");
+    bigint_tp e = bigint_from_int(65537);
+    bigint_tp m = bigint_from_string("170141183460469231731687303715884105727");
+
+    bigint_tp r = bigint_powmod(b, e, m);
+    s = bigint_to_string(r);
+    cr_assert_str_eq(s, "163334139787989459126589369973765710229", "bigint_powmod with an odd modulus");
+    free(s);
+    bigint_free(r);
+    bigint_free(m);
+
+    m = bigint_from_string("1000000000000000000000000000000");
+    r = bigint_powmod(b, e, m);
+    s = bigint_to_string(r);
+    cr_assert_str_eq(s, "337603070009928261135749700469", "bigint_powmod with an even modulus");
+    free(s);
+    bigint_free(r);
+
+    e = bigint_flipsign(e);
+    cr_assert_eq(bigint_powmod(b, e, m), NULL, "bigint_powmod refuses negative exponents");
+
+    bigint_free(b);
+    bigint_free(e);
+    bigint_free(m);
+}
+
+Test(bigint_test, test_fixed_base) {
+    bigint_tp g = bigint_from_int(3);
+    bigint_tp m = bigint_from_string("170141183460469231731687303715884105727");
+    bigint_fixed_base_tp fb = bigint_fixed_base_new(g, m, 128, 4, 2);
+    cr_assert_neq(fb, NULL, "bigint_fixed_base_new");
+
+    size_t size;
+    unsigned char *buf = bigint_fixed_base_to_bytes(fb, &size);
+    bigint_fixed_base_tp fb2 = bigint_fixed_base_from_bytes(buf, size);
+    cr_assert_neq(fb2, NULL, "bigint_fixed_base_from_bytes reads what bigint_fixed_base_to_bytes wrote");
+    cr_assert_eq(bigint_fixed_base_from_bytes(buf, size - 1), NULL, "bigint_fixed_base_from_bytes checks the size");
+    free(buf);
+
+    const char *exponents[] = { "0", "1", "65537", "170141183460469231731687303715884105726",
+                                "340282366920938463463374607431768211457" };
+    for (int i = 0; i < 5; ++i) {
+        bigint_tp e = bigint_from_string(exponents[i]);
+        bigint_tp expected = bigint_powmod(g, e, m);
+        bigint_tp r = bigint_fixed_base_pow(fb, e);
+        cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_fixed_base_pow");
+        bigint_free(r);
+        r = bigint_fixed_base_pow(fb2, e);
+        cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_fixed_base_pow after loading");
+        bigint_free(r);
+        bigint_free(expected);
+        bigint_free(e);
+    }
+
+    bigint_fixed_base_free(fb);
+    bigint_fixed_base_free(fb2);
+
+    // v doesn't divide a = 10 rows: blocks of 2 bits, so 5 tables, not 6
+    fb = bigint_fixed_base_new(g, m, 40, 4, 6);
+    fb2 = bigint_fixed_base_new(g, m, 40, 4, 6);
+    cr_assert_eq(fb->v, 5, "bigint_fixed_base_new only keeps the tables it fills");
+    buf = bigint_fixed_base_to_bytes(fb, &size);
+    size_t size2;
+    unsigned char *buf2 = bigint_fixed_base_to_bytes(fb2, &size2);
+    cr_assert(size == size2 && memcmp(buf, buf2, size) == 0, "the same tables serialise the same way");
+    bigint_fixed_base_free(fb2);
+    fb2 = bigint_fixed_base_from_bytes(buf, size);
+    cr_assert_neq(fb2, NULL, "bigint_fixed_base_from_bytes with v that doesn't divide a");
+    free(buf);
+    free(buf2);
+    for (int i = 0; i < 3; ++i) {
+        bigint_tp e = bigint_from_string(exponents[i]);
+        e = bigint_add32_inplace(e, 1000000000 * i);
+        bigint_tp expected = bigint_powmod(g, e, m);
+        bigint_tp r = bigint_fixed_base_pow(fb2, e);
+        cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_fixed_base_pow with v that doesn't divide a");
+        bigint_free(r);
+        bigint_free(expected);
+        bigint_free(e);
+    }
+    bigint_fixed_base_free(fb);
+    bigint_fixed_base_free(fb2);
+
+    m = bigint_add32_inplace(m, 1);
+    cr_assert_eq(bigint_fixed_base_new(g, m, 128, 4, 2), NULL, "bigint_fixed_base_new needs an odd modulus");
+    bigint_free(g);
+    bigint_free(m);
+}
+
+Test(bigint_test, test_mod_many) {
+    uint32_t moduli[2100], out[2100];
+    for (uint32_t i = 0; i < 2100; ++i)
+        moduli[i] = i < 500 ? i + 1 : 0xFFFFFFFFu - 2 * i;
+
+    // a short number, one long enough for the remainder tree, and one
+    // longer than the product of the moduli
+    bigint_tp n = bigint_from_string("-1234567890123456789012345678901234567890");
+    for (int round = 0; round < 3; ++round) {
+        for (int j = 0; j < 5 && round > 0; ++j) {
+            bigint_tp sq = bigint_mul(n, n);
+            bigint_free(n);
+            n = bigint_flipsign(sq);
+        }
+        cr_assert_eq(bigint_mod_many(n, moduli, 2100, out), 0, "bigint_mod_many");
+        for (uint32_t i = 0; i < 2100; ++i) {
+            bigint_tp m = bigint_from_int(moduli[i]);
+            bigint_tp r = bigint_mod(n, m);
+            if (bigint_sgn(r) < 0) r = bigint_add_inplace(r, m);
+            bigint_tp expected = bigint_from_int(out[i]);
+            cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_mod_many agrees with bigint_mod");
+            bigint_free(expected);
+            bigint_free(r);
+            bigint_free(m);
+        }
+    }
+
+    moduli[7] = 0;
+    cr_assert_eq(bigint_mod_many(n, moduli, 2100, out), -1, "bigint_mod_many refuses a zero modulus");
+    bigint_free(n);
+
+    // divisors this long go through a Newton reciprocal
+    uint32_t k = BIGINT_DIV_NEWTON_THRESHOLD + 100, xn = 2 * k + 1000, seed = 12345;
+    bigint_tp d = _bigint_new(k + 1), x = _bigint_new(xn + 1);
+    for (uint32_t i = 0; i < xn; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        x->num[i] = seed;
+        if (i < k) d->num[i] = seed ^ 0x5a5a5a5au;
+    }
+    d->num[k] = x->num[xn] = 0;
+    _bigint_crop(d);
+    _bigint_crop(x);
+    uint32_t *r = (uint32_t *)malloc((k + 1) * sizeof(uint32_t));
+    _bigint_mod_mag(r, x->num, xn, d);
+    r[k] = 0;
+    bigint_tp expected = bigint_mod(x, d);
+    cr_assert_eq(_bigint_mag_digits(expected) <= k, 1, "bigint_mod");
+    cr_assert_eq(memcmp(r, expected->num, _bigint_mag_digits(expected) * sizeof(uint32_t)), 0,
+                 "_bigint_mod_mag agrees with bigint_mod");
+    for (uint32_t i = _bigint_mag_digits(expected); i < k; ++i)
+        cr_assert_eq(r[i], 0, "_bigint_mod_mag agrees with bigint_mod");
+    free(r);
+    bigint_free(expected);
+    bigint_free(x);
+    bigint_free(d);
+}
+
+Test(bigint_test, test_hash) {
+    bigint_tp a = bigint_from_string("-23749238409823046709104012831203709123");
+    bigint_tp b = bigint_from_string("-23749238409823046709104012831203709123");
+    cr_assert_eq(bigint_hash(a), bigint_hash(b), "equal numbers have equal hashes");
+    b = bigint_add32_inplace(b, 1);
+    cr_assert_neq(bigint_hash(a), bigint_hash(b), "different numbers have different hashes");
+    cr_assert_neq(bigint_hash_seed(a, 1), bigint_hash(a), "the seed changes the hash");
+
+    // leading sign digits don't change the value, so they don't change the hash
+    bigint_tp c = _bigint_new(3);
+    c->num[0] = -5;
+    c->num[1] = -1;
+    c->num[2] = -1;
+    bigint_tp d = bigint_from_int(-5);
+    cr_assert_eq(bigint_hash(c), bigint_hash(d), "the hash ignores redundant digits");
+
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(c);
+    bigint_free(d);
+}
+
+Test(bigint_test, test_intern) {
+    bigint_intern_tp t = bigint_intern_new();
+    bigint_tp a = bigint_intern(t, bigint_from_string("1000000000000000000000000000000000000000000000000000000"));
+    bigint_tp b = bigint_intern(t, bigint_from_string("1000000000000000000000000000000000000000000000000000000"));
+    bigint_tp c = bigint_intern(t, bigint_from_string("1000000000000000000000000000000000000000000000000000001"));
+    cr_assert_eq(a, b, "equal numbers are interned to the same pointer");
+    cr_assert_neq(a, c, "different numbers are interned to different pointers");
+    cr_assert_eq(bigint_intern(t, a), a, "interning a canonical number returns it");
+
+    bigint_tp n = _bigint_new(2);
+    n->num[0] = 7;
+    n->num[1] = 0;
+    n = bigint_intern(t, n);
+    cr_assert_eq(n->digits, 1, "interned numbers are cropped");
+
+    // plenty of numbers, so the table has to grow
+    bigint_tp first[2000];
+    for (int i = 0; i < 2000; ++i)
+        first[i] = bigint_intern(t, bigint_mul32(a, i));
+    for (int i = 0; i < 2000; ++i)
+        cr_assert_eq(bigint_intern(t, bigint_mul32(a, i)), first[i], "interning after the table has grown");
+
+    bigint_intern_free(t);
+}
+
+Test(bigint_test, test_str_base) {
+    char *s;
+    bigint_tp n, m;
+
+    n = bigint_from_str_base("-DeadBeef0123456789abcdef", 16);
+    s = bigint_to_str_base(n, 16);
+    cr_assert_str_eq(s, "-deadbeef0123456789abcdef", "hex round trip");
+    free(s);
+    m = bigint_from_string("-68915718005617500482515488239");
+    cr_assert_eq(bigint_cmp(n, m), 0, "bigint_from_str_base reads hex");
+    s = bigint_to_str_base(m, 2);
+    cr_assert_eq(strlen(s), 97, "binary digits");
+    free(s);
+    s = bigint_to_str_base(m, 36);
+    bigint_free(m);
+    m = bigint_from_str_base(s, 36);
+    cr_assert_eq(bigint_cmp(n, m), 0, "base 36 round trip");
+    free(s);
+    bigint_free(m);
+    bigint_free(n);
+
+    n = bigint_from_str_base("0", 7);
+    s = bigint_to_str_base(n, 7);
+    cr_assert_str_eq(s, "0", "zero");
+    free(s);
+    bigint_free(n);
+
+    cr_assert_null(bigint_from_str_base("12g4", 16), "invalid digit");
+    cr_assert_null(bigint_from_str_base("102", 2), "digit too large for the base");
+    n = bigint_from_int(10);
+    cr_assert_null(bigint_to_str_base(n, 1), "base too small");
+    cr_assert_null(bigint_to_str_base(n, 37), "base too large");
+    bigint_free(n);
+
+    // long hex numbers go 32 or 64 characters at a time
+    char hex[204], lower[205];
+    const char *hex_chars = "0123456789abcdefABCDEF";
+    m = bigint_from_int(0);
+    for (int i = 0; i < 203; ++i) {
+        hex[i] = hex_chars[(i * 7 + 3) % 22];
+        lower[i + 1] = hex[i] | 0x20;
+        m = bigint_add32_inplace(bigint_shift(m, 4), _bigint_char_value(hex[i]));
+    }
+    hex[203] = lower[204] = '\0';
+    lower[0] = '-';
+    m = bigint_flipsign(m);
+    n = bigint_from_str_base(lower, 16);
+    cr_assert_eq(bigint_cmp(n, m), 0, "bigint_from_str_base reads long hex");
+    s = bigint_to_str_base(n, 16);
+    cr_assert_str_eq(s, lower, "long hex round trip");
+    free(s);
+    bigint_free(n);
+    n = bigint_from_str_base(hex, 16);
+    m = bigint_flipsign(m);
+    cr_assert_eq(bigint_cmp(n, m), 0, "bigint_from_str_base reads long hex in either case");
+    bigint_free(n);
+    bigint_free(m);
+    const char bad[] = { 'g', 'G', '/', ':', '@', '`', ' ', (char)0xb0 };
+    for (int i = 0; i < 8; ++i) {
+        char c = hex[i * 25];
+        hex[i * 25] = bad[i];
+        cr_assert_null(bigint_from_str_base(hex, 16), "invalid digit in long hex");
+        hex[i * 25] = c;
+    }
+    memset(hex, '0', 202);
+    n = bigint_from_str_base(hex, 16);
+    s = bigint_to_str_base(n, 16);
+    cr_assert_str_eq(s, hex + 202, "leading zeros");
+    free(s);
+    bigint_free(n);
+
+    // long enough to be split up: 3^2000 in base 3 and base 10
+    char digits[2002];
+    digits[0] = '1';
+    memset(digits + 1, '0', 2000);
+    digits[2001] = '\0';
+    n = bigint_from_str_base(digits, 3);
+    s = bigint_to_str_base(n, 3);
+    cr_assert_str_eq(s, digits, "long base 3 round trip");
+    free(s);
+    m = bigint_from_int(1);
+    for (int i = 0; i < 2000; ++i)
+        m = bigint_mul32_inplace(m, 3);
+    cr_assert_eq(bigint_cmp(n, m), 0, "bigint_from_str_base reads long numbers");
+    char *expected = bigint_to_string(m);
+    s = bigint_to_str_base(n, 10);
+    cr_assert_str_eq(s, expected, "long numbers in base 10");
+    free(s);
+    free(expected);
+    bigint_free(m);
+    bigint_free(n);
+}
+
+Test(bigdec_test, test_string) {
+    char *s;
+    bigdec_tp n;
+    const char *cases[] = {"0", "7", "-7", "999999999", "1000000000", "-1000000000000000000",
+                           "123456789012345678901234567890123456789"};
+    for (int i = 0; i < 7; ++i) {
+        n = bigdec_from_string(cases[i]);
+        s = bigdec_to_string(n);
+        cr_assert_str_eq(s, cases[i], "bigdec string round trip");
+        free(s);
+        bigdec_free(n);
+    }
+
+    n = bigdec_from_string("-0000000000000000000000000");
+    s = bigdec_to_string(n);
+    cr_assert_str_eq(s, "0", "bigdec strips leading zeros and negative zero");
+    cr_assert_eq(n->digits, 1, "bigdec strips leading zeros");
+    free(s);
+    bigdec_free(n);
+
+    cr_assert_eq(bigdec_from_string("12a3"), NULL, "bigdec_from_string rejects invalid strings");
+
+    n = bigdec_from_int(INT64_MIN);
+    s = bigdec_to_string(n);
+    cr_assert_str_eq(s, "-9223372036854775808", "bigdec_from_int");
+    free(s);
+    bigdec_free(n);
+}
+
+Test(bigdec_test, test_arithmetic) {
+    char *s;
+    bigdec_tp a = bigdec_from_string("1000000000000000000000000000");
+    bigdec_tp b = bigdec_from_string("-1");
+    bigdec_tp c = bigdec_from_string("-999999999999999999999999999999");
+    bigdec_tp r;
+
+    r = bigdec_add(a, b);
+    s = bigdec_to_string(r);
+    cr_assert_str_eq(s, "999999999999999999999999999", "bigdec_add borrows across digits");
+    free(s);
+    r = bigdec_sub_inplace(r, c);
+    s = bigdec_to_string(r);
+    cr_assert_str_eq(s, "1000999999999999999999999999998", "bigdec_sub_inplace");
+    free(s);
+    r = bigdec_add_inplace(r, c);
+    r = bigdec_add_inplace(r, c);
+    s = bigdec_to_string(r);
+    cr_assert_str_eq(s, "-999000000000000000000000000000", "bigdec_add_inplace changes sign");
+    free(s);
+    r = bigdec_add_inplace(r, r);
+    s = bigdec_to_string(r);
+    cr_assert_str_eq(s, "-1998000000000000000000000000000", "bigdec_add_inplace with itself");
+    free(s);
+    bigdec_free(r);
+
+    r = bigdec_sub(a, a);
+    cr_assert(bigdec_sgn(r) == 1 && r->digits == 1 && r->num[0] == 0, "bigdec_sub to zero");
+    bigdec_free(r);
+
+    cr_assert(bigdec_cmp(a, c) > 0 && bigdec_cmp(c, b) < 0 && bigdec_cmp(b, b) == 0, "bigdec_cmp");
+
+    r = bigdec_mul32(c, INT32_MIN);
+    s = bigdec_to_string(r);
+    cr_assert_str_eq(s, "2147483647999999999999999999997852516352", "bigdec_mul32");
+    free(s);
+    bigdec_free(r);
+
+    r = bigdec_mul(a, c);
+    s = bigdec_to_string(r);
+    cr_assert_str_eq(s, "-999999999999999999999999999999000000000000000000000000000", "bigdec_mul");
+    free(s);
+    bigdec_free(r);
+
+    bigdec_free(a);
+    bigdec_free(b);
+    bigdec_free(c);
+}
+
+Test(bigdec_test, test_large) {
+    // big enough for Karatsuba and the divide-and-conquer conversions
+    char digits[3001];
+    for (int i = 0; i < 3000; ++i)
+        digits[i] = '1' + (i * 7) % 9;
+    digits[3000] = '\0';
+    char *s, *s2;
+
+    bigdec_tp a = bigdec_from_string(digits);
+    bigint_tp ai = bigint_from_string(digits);
+    bigint_tp conv = bigdec_to_bigint(a);
+    cr_assert_eq(bigint_cmp(conv, ai), 0, "bigdec_to_bigint");
+    bigint_free(conv);
+
+    ai = bigint_flipsign(ai);
+    bigdec_tp b = bigdec_from_bigint(ai);
+    s = bigdec_to_string(b);
+    cr_assert(s[0] == '-' && strcmp(s + 1, digits) == 0, "bigdec_from_bigint");
+    free(s);
+
+    bigdec_tp r = bigdec_mul(a, b);
+    bigint_tp ri = bigint_mul(ai, ai);
+    ri = bigint_flipsign(ri);
+    s = bigdec_to_string(r);
+    s2 = bigint_to_string(ri);
+    cr_assert_str_eq(s, s2, "bigdec_mul agrees with bigint_mul");
+    free(s);
+    free(s2);
+
+    bigdec_free(a);
+    bigdec_free(b);
+    bigdec_free(r);
+    bigint_free(ai);
+    bigint_free(ri);
+}
+
+Test(bigq_test, test_string) {
+    char *s;
+    bigq_tp q = bigq_from_string("-84/-36");
+    s = bigq_to_string(q);
+    cr_assert_str_eq(s, "7/3", "bigq_from_string and bigq_to_string reduce");
+    free(s);
+    bigq_free(q);
+
+    q = bigq_from_string("-1000000000000000000000000");
+    s = bigq_to_string(q);
+    cr_assert_str_eq(s, "-1000000000000000000000000", "integers are printed without a denominator");
+    free(s);
+    bigq_free(q);
+
+    cr_assert_eq(bigq_from_string("1/0"), NULL, "bigq_from_string refuses a zero denominator");
+    cr_assert_eq(bigq_from_string("1/x"), NULL, "bigq_from_string rejects invalid strings");
+    cr_assert_eq(bigq_from_int(1, 0), NULL, "bigq_from_int refuses a zero denominator");
+}
+
+Test(bigq_test, test_arithmetic) {
+    char *s;
+    bigq_tp a = bigq_from_int(-3, 4);
+    bigq_tp b = bigq_from_int(5, 6);
+    bigq_tp c = bigq_from_int(8, -9);
+    bigq_tp r;
+
+    r = bigq_sub(a, b);
+    s = bigq_to_string(r);
+    cr_assert_str_eq(s, "-19/12", "bigq_sub");
+    free(s);
+    bigq_free(r);
+
+    r = bigq_mul(a, c);
+    s = bigq_to_string(r);
+    cr_assert_str_eq(s, "2/3", "bigq_mul");
+    free(s);
+    bigq_free(r);
+
+    a = bigq_div_inplace(a, b);
+    s = bigq_to_string(a);
+    cr_assert_str_eq(s, "-9/10", "bigq_div_inplace");
+    free(s);
+    a = bigq_add_inplace(a, a);
+    s = bigq_to_string(a);
+    cr_assert_str_eq(s, "-9/5", "bigq_add_inplace with itself");
+    free(s);
+
+    r = bigq_from_int(0, 1);
+    cr_assert_eq(bigq_div(b, r), NULL, "bigq_div refuses to divide by zero");
+    cr_assert(bigq_cmp(a, c) < 0 && bigq_cmp(b, r) > 0 && bigq_cmp(c, c) == 0, "bigq_cmp");
+    bigq_free(r);
+
+    // the harmonic series grows past the threshold and gets reduced on the way
+    bigq_tp h = bigq_from_int(0, 1);
+    for (int k = 1; k <= 100; ++k) {
+        r = bigq_from_int(1, k);
+        h = bigq_add_inplace(h, r);
+        bigq_free(r);
+    }
+    cr_assert_leq(_bigq_digits(h), h->limit, "bigq stays below its limit");
+    s = bigq_to_string(h);
+    cr_assert_str_eq(s, "14466636279520351160221518043104131447711/2788815009188499086581352357412492142272",
+                     "sum of 1/k");
+    free(s);
+
+    bigq_free(a);
+    bigq_free(b);
+    bigq_free(c);
+    bigq_free(h);
+}
+
+Test(bigfloat_test, test_arithmetic) {
+    char *s;
+    bigfloat_tp two = bigfloat_from_int(2, 200);
+    bigfloat_tp three = bigfloat_from_int(3, 200);
+    bigfloat_tp r;
+
+    r = bigfloat_sqrt(two);
+    s = bigfloat_to_string(r, 50);
+    cr_assert_str_eq(s, "1.41421356237309504880168872420969807856967187537695", "bigfloat_sqrt");
+    free(s);
+    bigfloat_free(r);
+
+    r = bigfloat_div(two, three);
+    s = bigfloat_to_string(r, 30);
+    cr_assert_str_eq(s, "0.666666666666666666666666666667", "bigfloat_div");
+    free(s);
+    bigfloat_free(r);
+
+    r = bigfloat_recip(three);
+    r = bigfloat_flipsign(r);
+    s = bigfloat_to_string(r, 10);
+    cr_assert_str_eq(s, "-0.3333333333", "bigfloat_recip");
+    free(s);
+    bigfloat_free(r);
+
+    // 1 + 2^-1000 rounds to 1 at 200 bits
+    bigfloat_tp one = bigfloat_from_int(1, 200);
+    bigint_tp m = bigint_from_int(1);
+    bigfloat_tp tiny = bigfloat_from_bigint(m, -1000, 200);
+    bigint_free(m);
+    r = bigfloat_add(one, tiny);
+    cr_assert_eq(bigfloat_cmp(r, one), 0, "bigfloat_add rounds away a tiny operand");
+    bigfloat_free(r);
+    r = bigfloat_sub(one, tiny);
+    cr_assert_eq(bigfloat_cmp(r, one), 0, "bigfloat_sub rounds away a tiny operand");
+    cr_assert(bigfloat_cmp(tiny, one) < 0 && bigfloat_cmp(three, two) > 0, "bigfloat_cmp");
+    bigfloat_free(r);
+
+    r = bigfloat_mul(three, three);
+    s = bigfloat_to_string(r, 0);
+    cr_assert_str_eq(s, "9", "bigfloat_mul");
+    free(s);
+    r = bigfloat_flipsign(r);
+    cr_assert_eq(bigfloat_sqrt(r), NULL, "bigfloat_sqrt refuses negative numbers");
+    bigfloat_free(r);
+
+    r = bigfloat_from_int(0, 200);
+    cr_assert_eq(bigfloat_div(one, r), NULL, "bigfloat_div refuses to divide by zero");
+    bigfloat_free(r);
+
+    // exponents that don't fit in an int32_t
+    m = bigint_from_int(1);
+    r = bigfloat_from_bigint(m, -4294967297, 53);
+    s = bigfloat_to_string(r, 3);
+    cr_assert_str_eq(s, "0.000", "bigfloat_to_string with a very small exponent");
+    free(s);
+    bigfloat_free(r);
+    r = bigfloat_from_bigint(m, -2147483648, 53);
+    s = bigfloat_to_string(r, 3);
+    cr_assert_str_eq(s, "0.000", "bigfloat_to_string with an exponent of -2^31");
+    free(s);
+    bigfloat_free(r);
+    bigint_free(m);
+
+    bigfloat_free(one);
+    bigfloat_free(tiny);
+    bigfloat_free(two);
+    bigfloat_free(three);
+}
+
+Test(bigint_prime_test, test_probab_prime) {
+    bigint_tp n;
+    n = bigint_from_int(97);
+    cr_assert_eq(bigint_probab_prime(n, 1), 2, "small primes are certain");
+    bigint_free(n);
+    n = bigint_from_int(1);
+    cr_assert_eq(bigint_probab_prime(n, 1), 0, "1 isn't prime");
+    bigint_free(n);
+    n = bigint_from_int(1194649);
+    cr_assert_eq(bigint_probab_prime(n, 1), 0, "1093^2 is a base 2 strong pseudoprime, but a square");
+    bigint_free(n);
+    n = bigint_from_string("3825123056546413051");
+    cr_assert_eq(bigint_probab_prime(n, 1), 0, "strong pseudoprime to the bases up to 23");
+    bigint_free(n);
+    n = bigint_from_string("170141183460469231731687303715884105727");
+    cr_assert_eq(bigint_probab_prime(n, 10), 1, "2^127 - 1 is prime");
+    n = bigint_add32_inplace(n, 2);
+    cr_assert_eq(bigint_probab_prime(n, 10), 0, "2^127 + 1 isn't");
+    bigint_free(n);
+}
+
+Test(bigint_prime_test, test_nextprime) {
+    char *s;
+    bigint_tp n = bigint_from_string("1000000000000000000000000000000");
+    bigint_tp p = bigint_nextprime(n);
+    s = bigint_to_string(p);
+    cr_assert_str_eq(s, "1000000000000000000000000000057", "bigint_nextprime");
+    free(s);
+    bigint_free(p);
+    bigint_free(n);
+
+    n = bigint_from_int(7);
+    p = bigint_nextprime(n);
+    cr_assert_eq(bigint_cmp32(p, 11), 0, "bigint_nextprime of a prime is the next one");
+    bigint_free(p);
+    bigint_free(n);
+
+    bigint_tp ns[40];
+    int results[40];
+    n = bigint_from_string("170141183460469231731687303715884105727");
+    for (int i = 0; i < 40; ++i)
+        ns[i] = bigint_add32(n, 2 * i);
+    bigint_probab_prime_batch(ns, 40, 1, results, 4);
+    for (int i = 0; i < 40; ++i) {
+        // the primes are 2^127 - 1, 2^127 + 29, 2^127 + 45 and 2^127 + 65
+        cr_assert_eq(results[i] != 0, i == 0 || i == 15 || i == 23 || i == 33, "bigint_probab_prime_batch");
+        bigint_free(ns[i]);
+    }
+    bigint_free(n);
+}
+
+Test(bigrns_test, test_arithmetic) {
+    char *s;
+    bigrns_base_tp base = bigrns_base_new(8);
+    bigint_tp a = bigint_from_string("-98765432109876543210987654321");
+    bigint_tp b = bigint_from_string("12345678901234567890123");
+    bigint_tp c = bigint_shift(bigint_from_int(1), 100);
+    bigrns_tp x = bigrns_from_bigint(base, a);
+    bigrns_tp y = bigrns_from_bigint(base, b);
+    bigrns_tp z = bigrns_from_bigint(base, c);
+
+    bigint_tp r = bigrns_to_bigint(x);
+    cr_assert_eq(bigint_cmp(r, a), 0, "bigrns_to_bigint undoes bigrns_from_bigint");
+    bigint_free(r);
+
+    bigrns_tp res = bigrns_mul(x, y);
+    res = bigrns_sub_inplace(res, z);
+    res = bigrns_add_inplace(res, x);
+    r = bigrns_to_bigint(res);
+    s = bigint_to_string(r);
+    cr_assert_str_eq(s, "-1219326311370217952263171628405599300870785525031180", "bigrns arithmetic");
+    free(s);
+    bigint_free(r);
+
+    // 8 moduli hold 246 bits
+    res = bigrns_mul_inplace(res, res);
+    cr_assert_eq(bigrns_to_bigint(res), NULL, "bigrns_to_bigint refuses numbers that may have overflowed");
+    r = bigint_shift(bigint_from_int(1), 250);
+    cr_assert_eq(bigrns_from_bigint(base, r), NULL, "bigrns_from_bigint refuses numbers that don't fit");
+    bigint_free(r);
+
+    uint32_t moduli[] = { 3, 5, 9 };
+    cr_assert_eq(bigrns_base_from_moduli(moduli, 3), NULL, "bigrns_base_from_moduli needs coprime moduli");
+
+    bigrns_free(x);
+    bigrns_free(y);
+    bigrns_free(z);
+    bigrns_free(res);
+    bigint_free(a);
+    bigint_free(b);
+    bigint_free(c);
+    bigrns_base_free(base);
+}
+
+Test(bigint_dag_test, test_eval) {
+    // 64! by binary splitting, then a few operations on it
+    bigint_dag_tp dag = bigint_dag_new();
+    uint32_t nodes[64];
+    for (int i = 0; i < 64; ++i) {
+        bigint_tp n = bigint_from_int(i + 1);
+        nodes[i] = bigint_dag_input(dag, n);
+        bigint_free(n);
+    }
+    for (int step = 1; step < 64; step *= 2)
+        for (int i = 0; i + step < 64; i += 2 * step)
+            nodes[i] = bigint_dag_mul(dag, nodes[i], nodes[i + step]);
+    uint32_t f = nodes[0];
+    uint32_t s = bigint_dag_sqrt(dag, f);
+    uint32_t rem = bigint_dag_sub(dag, f, bigint_dag_mul(dag, s, s));
+    uint32_t q = bigint_dag_div(dag, bigint_dag_shift(dag, f, 10), s);
+    bigint_dag_keep(dag, s);
+    cr_assert_eq(bigint_dag_eval(dag, 4), 0, "bigint_dag_eval");
+    cr_assert_eq(bigint_dag_value(dag, f), NULL, "intermediate results are freed");
+
+    bigint_tp fact = bigint_from_int(1);
+    for (int i = 2; i <= 64; ++i)
+        fact = bigint_mul32_inplace(fact, i);
+    bigint_tp expected = bigint_sqrt(fact);
+    bigint_tp r = bigint_dag_value(dag, s);
+    cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_dag_sqrt");
+    bigint_free(r);
+
+    bigint_tp sq = bigint_flipsign(bigint_mul(expected, expected));
+    bigint_tp diff = bigint_add(fact, sq);
+    r = bigint_dag_value(dag, rem);
+    cr_assert_eq(bigint_cmp(r, diff), 0, "bigint_dag_sub, bigint_dag_mul");
+    bigint_free(r);
+    bigint_free(diff);
+    bigint_free(sq);
+
+    bigint_tp shifted = bigint_shift(bigint_dup(fact), 10);
+    bigint_tp quot = bigint_div(shifted, expected);
+    r = bigint_dag_value(dag, q);
+    cr_assert_eq(bigint_cmp(r, quot), 0, "bigint_dag_shift, bigint_dag_div");
+    bigint_free(r);
+    bigint_free(quot);
+    bigint_free(shifted);
+    bigint_free(expected);
+    bigint_dag_free(dag);
+
+    // errors propagate to everything that depends on them
+    dag = bigint_dag_new();
+    bigint_tp zero = bigint_from_int(0);
+    uint32_t a = bigint_dag_input(dag, fact), b = bigint_dag_input(dag, zero);
+    uint32_t c = bigint_dag_add(dag, bigint_dag_div(dag, a, b), a);
+    cr_assert_eq(bigint_dag_eval(dag, 2), -1, "bigint_dag_eval reports division by zero");
+    cr_assert_eq(bigint_dag_value(dag, c), NULL, "bigint_dag_eval reports division by zero");
+    cr_assert_eq(bigint_dag_add(dag, a, b), BIGINT_DAG_NONE, "a dag is only evaluated once");
+    bigint_dag_free(dag);
+    bigint_free(zero);
+    bigint_free(fact);
+}
+
+Test(bigint_dag_test, test_profile) {
+    // x*y has only one consumer, so the add overwrites it in place
+    bigint_tp x = bigint_from_string("123456789123456789123456789");
+    bigint_tp y = bigint_from_string("-987654321987654321");
+    bigint_tp z = bigint_from_string("555555555555555555555555555555555555");
+    bigint_dag_tp dag = bigint_dag_new();
+    uint32_t a = bigint_dag_input(dag, x), b = bigint_dag_input(dag, y), c = bigint_dag_input(dag, z);
+    uint32_t sum = bigint_dag_add(dag, bigint_dag_mul(dag, a, b), c);
+    uint32_t diff = bigint_dag_sub(dag, bigint_dag_shift(dag, c, -7), a);
+    cr_assert_eq(bigint_dag_eval(dag, 2), 0, "bigint_dag_eval");
+
+    bigint_tp expected = bigint_add_inplace(bigint_mul(x, y), z);
+    bigint_tp r = bigint_dag_value(dag, sum);
+    cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_dag_add in place");
+    bigint_free(r);
+    bigint_free(expected);
+    expected = bigint_sub_inplace(bigint_shift(bigint_dup(z), -7), x);
+    r = bigint_dag_value(dag, diff);
+    cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_dag_sub in place");
+    bigint_free(r);
+    bigint_free(expected);
+
+    // a header and one line of 8 columns for each of the 4 operations
+    FILE *f = tmpfile();
+    cr_assert_neq(f, NULL, "tmpfile");
+    bigint_dag_profile(dag, f);
+    rewind(f);
+    int lines = 0, tabs = 0, ch;
+    while ((ch = fgetc(f)) != EOF) {
+        if (ch == '\t') {
+            ++tabs;
+        } else if (ch == '\n') {
+            cr_assert_eq(tabs, 7, "bigint_dag_profile columns");
+            ++lines;
+            tabs = 0;
+        }
+    }
+    cr_assert_eq(lines, 5, "bigint_dag_profile lines");
+    fclose(f);
+
+    bigint_dag_free(dag);
+    bigint_free(x);
+    bigint_free(y);
+    bigint_free(z);
+}
+
+Test(bigint_disk_test, test_mul) {
+    // numbers of 60 and 30 kB, with only 16 kB of memory to multiply them
+    const size_t budget = 16384;
+    bigint_tp a = bigint_from_string("123456789123456789"), b = bigint_from_string("-987654321987654321");
+    for (int i = 0; i < 13; ++i) {
+        bigint_tp sq = bigint_mul(a, a);
+        bigint_free(a);
+        a = sq;
+        if (i < 12) {
+            sq = bigint_mul(b, b);
+            bigint_free(b);
+            b = sq;
+        }
+    }
+    b = bigint_add32_inplace(b, 1);
+    bigint_tp neg = bigint_neg_into(NULL, b);
+    cr_assert_eq(bigint_disk_from_bigint("bigint_disk_test_x", neg), NULL,
+                 "bigint_disk_from_bigint refuses negative numbers");
+    bigint_free(neg);
+    bigint_disk_tp da = bigint_disk_from_bigint("bigint_disk_test_a", a);
+    bigint_disk_tp db = bigint_disk_from_bigint("bigint_disk_test_b", b);
+    cr_assert_eq(da->digits, _bigint_mag_digits(a), "bigint_disk_from_bigint");
+
+    bigint_disk_tp dr = bigint_disk_mul("bigint_disk_test_r", da, db, budget);
+    bigint_tp r = bigint_disk_to_bigint(dr), expected = bigint_mul(a, b);
+    cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_disk_mul");
+    bigint_free(r);
+    bigint_free(expected);
+    bigint_disk_free(dr);
+
+    dr = bigint_disk_mul("bigint_disk_test_r", da, da, budget);
+    r = bigint_disk_to_bigint(dr);
+    expected = bigint_mul(a, a);
+    cr_assert_eq(bigint_cmp(r, expected), 0, "bigint_disk_mul squares");
+    bigint_free(r);
+    bigint_free(expected);
+    bigint_disk_free(dr);
+    cr_assert_eq(bigint_disk_mul("bigint_disk_test_r", da, db, 1024), NULL,
+                 "bigint_disk_mul needs some memory");
+
+    // reopening the file, and the streaming formats
+    bigint_disk_free(da);
+    da = bigint_disk_open("bigint_disk_test_a");
+    r = bigint_disk_to_bigint(da);
+    cr_assert_eq(bigint_cmp(r, a), 0, "bigint_disk_open");
+    bigint_free(r);
+
+    FILE *f = tmpfile();
+    cr_assert_eq(bigint_disk_write(da, f), 0, "bigint_disk_write");
+    rewind(f);
+    bigint_disk_tp dc = bigint_disk_read("bigint_disk_test_c", f);
+    r = bigint_disk_to_bigint(dc);
+    cr_assert_eq(bigint_cmp(r, a), 0, "bigint_disk_read");
+    bigint_free(r);
+    bigint_disk_free(dc);
+    fclose(f);
+
+    f = tmpfile();
+    cr_assert_eq(bigint_disk_write_decimal(da, f, budget), 0, "bigint_disk_write_decimal");
+    char *s = bigint_to_string(a);
+    size_t len = strlen(s);
+    char *written = (char *)malloc(len + 2);
+    rewind(f);
+    cr_assert_eq(fread(written, 1, len + 2, f), len, "bigint_disk_write_decimal");
+    cr_assert_eq(memcmp(written, s, len), 0, "bigint_disk_write_decimal");
+    fputs("\n", f);
+    rewind(f);
+    dc = bigint_disk_read_decimal("bigint_disk_test_c", f, budget);
+    r = bigint_disk_to_bigint(dc);
+    cr_assert_eq(bigint_cmp(r, a), 0, "bigint_disk_read_decimal");
+    bigint_free(r);
+    bigint_disk_free(dc);
+    fclose(f);
+    free(written);
+    free(s);
+
+    f = tmpfile();
+    fputs("12 34", f);
+    rewind(f);
+    cr_assert_eq(bigint_disk_read_decimal("bigint_disk_test_c", f, budget), NULL,
+                 "bigint_disk_read_decimal refuses garbage");
+    fclose(f);
+
+    bigint_disk_free(da);
+    bigint_disk_free(db);
+    bigint_free(a);
+    bigint_free(b);
+    remove("bigint_disk_test_a");
+    remove("bigint_disk_test_b");
+    remove("bigint_disk_test_c");
+    remove("bigint_disk_test_r");
+    remove("bigint_disk_test_x");
+}
@@ -0,0 +1,170 @@
+/* bigint library - unit tests for the C++ interface
+   Copyright 2020 Thomas Jollans - see COPYING */
+
+#include <criterion/criterion.h>
+#include "bigint.hpp"
+#include "bigint_fixed.hpp"
+
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+Test(bigint_hpp_test, test_construct) {
+    bigint a;
+    cr_assert(a == 0, "default constructed bigint is zero");
+    bigint b(-1234567890123456789LL);
+    cr_assert_eq(b.to_string(), "-1234567890123456789", "bigint from int64_t");
+    bigint c("23749238409823046709104012831203709123");
+    cr_assert_eq(c.to_string(), "23749238409823046709104012831203709123", "bigint from string");
+    cr_assert_throw(bigint("12x"), std::invalid_argument, "invalid strings throw");
+
+    bigint d(c);
+    cr_assert(d == c, "copy");
+#ifdef BIGINT_REFCOUNT
+    cr_assert_eq(d.get(), c.get(), "copies share storage");
+#else
+    cr_assert_neq(d.get(), c.get(), "copies don't share storage");
+#endif
+
+    bigint_tp p = c.get();
+    bigint e(std::move(c));
+    cr_assert_eq(e.get(), p, "move constructor takes the storage");
+    bigint f;
+    f = std::move(e);
+    cr_assert_eq(f.get(), p, "move assignment takes the storage");
+
+    bigint g = bigint::adopt(bigint_from_int(42));
+    cr_assert(g == 42, "adopting a bigint_tp");
+    bigint h(UINT64_MAX);
+    cr_assert_eq(h.to_string(), "18446744073709551615", "bigint from uint64_t");
+}
+
+Test(bigint_hpp_test, test_arithmetic) {
+    bigint a("23497230472037409182301740983214");
+    bigint b("948593479263471208");
+    bigint c("-1000000000000000000000");
+
+    bigint r = a * b;
+    cr_assert_eq(r.to_string(), "22289319606525621891508260125475180778856500302512", "multiplication");
+    r = a * b + c;
+    cr_assert_eq(r.to_string(), "22289319606525621891508260124475180778856500302512", "a*b + c");
+    r = c + a * b;
+    cr_assert_eq(r.to_string(), "22289319606525621891508260124475180778856500302512", "c + a*b");
+    r = c - a * b;
+    cr_assert_eq(r.to_string(), "-22289319606525621891508260126475180778856500302512", "c - a*b");
+    r = a * b - c;
+    cr_assert_eq(r.to_string(), "22289319606525621891508260126475180778856500302512", "a*b - c");
+    r = (a * b) % c;
+    cr_assert_eq(r.to_string(), "475180778856500302512", "(a*b) %% c");
+    r = (a * b) / c;
+    cr_assert_eq(r.to_string(), "-22289319606525621891508260125", "(a*b) / c");
+    r = a - (b - c);
+    cr_assert_eq(r.to_string(), "23497230471036460588822477512006", "a - (b - c)");
+    r = -(a + c);
+    cr_assert_eq(r.to_string(), "-23497230471037409182301740983214", "-(a + c)");
+    r = (a + 1) * 2 - 3;
+    cr_assert_eq(r.to_string(), "46994460944074818364603481966427", "arithmetic with machine integers");
+    cr_assert(a % 1000 == 214, "remainder by a machine integer");
+    cr_assert(-a % 1000 == -214 && -a % -99991 == -42941 && a % -99991 == 42941 &&
+              -a % 2147483647 == -48092008 && -(bigint(1) << 96) % 7 == -1,
+              "remainder by a machine integer has the sign of the dividend");
+    cr_assert((bigint(1) << 100) >> 99 == 2, "shifts");
+    cr_assert_throw(r = a / bigint(0), std::domain_error, "division by zero throws");
+}
+
+Test(bigint_hpp_test, test_compound) {
+    bigint x("1000000000000000000000000");
+    bigint y("-123456789123456789");
+    bigint z("987654321987654321");
+
+    x += y * z;
+    cr_assert_eq(x.to_string(), "-121932631355500531347203169112635269", "x += y*z");
+    x -= y * z;
+    cr_assert_eq(x.to_string(), "1000000000000000000000000", "x -= y*z");
+    x += y + z;
+    cr_assert_eq(x.to_string(), "1000000864197532864197532", "x += y + z");
+    x -= y - z;
+    cr_assert_eq(x.to_string(), "1000001975308643975308642", "x -= y - z");
+
+    // expressions that refer to the target
+    bigint w(7);
+    w += w * w;
+    cr_assert(w == 56, "w += w*w");
+    w += z - w;
+    cr_assert(w == z, "w += z - w");
+    w = w * w + w;
+    cr_assert_eq(w.to_string(), "975461059740893158543057461777625362", "w = w*w + w");
+    w -= w;
+    cr_assert(w == 0, "w -= w");
+}
+
+Test(bigint_hpp_test, test_rvalues) {
+    bigint a("123456789012345678901234567890");
+    bigint b("-98765432109876543210");
+
+    bigint t(a.to_string());
+    bigint_tp p = t.get();
+    bigint r = std::move(t) + b;
+    cr_assert_eq(r.get(), p, "rvalue + reuses the left operand");
+    cr_assert_eq(r.to_string(), "123456788913580246791358024680", "rvalue + is correct");
+
+    r = b - bigint(a);
+    cr_assert_eq(r.to_string(), "-123456789111111111011111111100", "lvalue - rvalue");
+    r = bigint(a) * bigint(b);
+    cr_assert_eq(r.to_string(), "-12193263113702179522496570642237463801111263526900", "rvalue * rvalue");
+    r = 5 + a;
+    cr_assert_eq(r.to_string(), "123456789012345678901234567895", "int + bigint");
+}
+
+Test(bigint_hpp_test, test_compare) {
+    bigint a("123456789012345678901234567890");
+    bigint b("-98765432109876543210");
+    cr_assert(a > b && b < a && a != b && a >= a && b <= b, "comparison");
+    cr_assert(a + b < a && a * b < b, "comparing expressions");
+    cr_assert(b < 0 && a > 1 && bigint(5) == 5, "comparing with machine integers");
+    cr_assert(a > 10000000000000LL, "comparing with big machine integers");
+}
+
+Test(bigint_hpp_test, test_hash) {
+    std::unordered_set<bigint> s;
+    s.insert(bigint("123456789012345678901234567890"));
+    s.insert(bigint(5) * 7);
+    cr_assert_eq(s.count(bigint(35)), 1, "bigint works as a hash key");
+    cr_assert_eq(s.count(bigint("123456789012345678901234567890")), 1, "bigint works as a hash key");
+    cr_assert_eq(s.count(bigint(36)), 0, "bigint works as a hash key");
+}
+
+// bigint_fixed works in constant expressions
+constexpr bigint256_t fixed_a = bigint256_t::from_string("340282366920938463463374607431768211457");
+constexpr bigint256_t fixed_b = bigint256_t::from_string("18446744073709551629");
+constexpr bigint256_t fixed_ab = fixed_a * fixed_b;
+static_assert(fixed_ab == bigint256_t::from_string("6277101735386680768259460193179866441144672085150730813453"),
+              "constexpr multiplication");
+static_assert((fixed_ab + 5) / fixed_b == fixed_a && (fixed_ab + 5) % fixed_b == 5, "constexpr division");
+static_assert(-(fixed_ab + 5) / fixed_b == -fixed_a && -(fixed_ab + 5) % fixed_b == -5,
+              "constexpr division rounds to zero");
+static_assert((bigint128_t(1) << 127) < 0 && (bigint128_t(-8) >> 2) == -2, "constexpr shifts");
+static_assert(bigint128_t(-1) - bigint128_t(INT64_MAX) * 4 == bigint128_t::from_string("-36893488147419103229"),
+              "constexpr subtraction");
+
+Test(bigint_fixed_test, test_fixed) {
+    bigint_tp n = bigint_from_string("-6277101735386680768259460193179866441144672085150730813453");
+    bigint512_t a(n);
+    cr_assert(a == -bigint512_t(fixed_ab), "bigint_fixed from bigint_tp");
+    a = a * a;
+    bigint_tp sq = a.to_bigint();
+    bigint_tp expected = bigint_mul(n, n);
+    cr_assert(bigint_cmp(sq, expected) == 0, "bigint_fixed to bigint_tp");
+    bigint_free(sq);
+    bigint_free(expected);
+
+    // wraps around like the built-in types
+    bigint_fixed<64> b(n);
+    bigint_fixed<64> c(INT64_MIN);
+    cr_assert(c - 1 == bigint_fixed<64>(INT64_MAX), "bigint_fixed wraps around");
+    cr_assert_eq(b.num[0], n->num[0], "bigint_fixed keeps the low digits");
+    cr_assert_eq(b.num[1], n->num[1], "bigint_fixed keeps the low digits");
+    bigint_free(n);
+
+    cr_assert_throw(a / bigint512_t(), std::domain_error, "bigint_fixed division by zero throws");
+}